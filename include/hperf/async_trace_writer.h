@@ -0,0 +1,99 @@
+#pragma once
+
+#include <condition_variable>  // for std::condition_variable
+#include <cstddef>             // for size_t
+#include <cstdint>             // for uint64_t
+#include <memory>              // for std::unique_ptr
+#include <mutex>               // for std::mutex
+#include <thread>              // for std::thread
+#include <vector>              // for std::vector
+
+#include "pmu_config.h"    // for PMUConfig
+#include "reporter.h"      // for Record
+#include "trace_writer.h"  // for TraceWriter
+
+/**
+ * @brief Asynchronous output: a decorator that moves the (blocking) I/O of another TraceWriter to a writer thread.
+ *
+ * The sampling thread only copies the records into a batch taken from a preallocated ring of batches, and hands over a batch when the
+ * next group read does not fit. The writer thread formats and writes the batches through the wrapped TraceWriter.
+ * A group read (the records of a group of a CPU in an interval) is never split across batches: if the writer falls behind and no
+ * free batch is left, whole group reads are dropped instead of blocking the sampling thread.
+ * The backpressure (high-water mark of the ring) and the dropped group reads are reported by finish().
+ */
+class AsyncTraceWriter : public TraceWriter {
+ public:
+  /**
+   * @brief Construct a new AsyncTraceWriter object and start the writer thread
+   *
+   * @param inner The TraceWriter doing the actual output
+   * @param pmu_config Used to look up the number of records of a group read
+   * @param batch_num The number of preallocated batches in the ring
+   * @param batch_size The number of records in a batch, at least the records of the largest group read
+   */
+  AsyncTraceWriter(std::unique_ptr<TraceWriter> inner, const PMUConfig &pmu_config, size_t batch_num, size_t batch_size);
+
+  ~AsyncTraceWriter() override;
+
+  AsyncTraceWriter(const AsyncTraceWriter &) = delete;
+  AsyncTraceWriter &operator=(const AsyncTraceWriter &) = delete;
+
+  /**
+   * @brief Write the header synchronously, before any batch is handed over
+   */
+  void write_header() override;
+
+  void write_record(const Record &record) override;
+
+  /**
+   * @brief Hand over the partially filled batch, wait for the writer thread to write everything, and report the statistics
+   */
+  void finish() override;
+
+ private:
+  struct Batch {
+    std::vector<Record> records;  // Preallocated, never resized
+    size_t size;                  // The number of valid records
+  };
+
+  std::unique_ptr<TraceWriter> inner_;
+
+  std::vector<size_t> read_sizes_;  // The number of records of a read of each group
+  std::vector<Batch> ring_;
+  size_t batch_size_;
+
+  // Ring state, protected by mutex_: batches [head_, head_ + filled_num_) are waiting for the writer thread
+  std::mutex mutex_;
+  std::condition_variable filled_cv_;
+  size_t head_;
+  size_t filled_num_;
+  bool stopping_;
+
+  // Owned by the sampling thread
+  size_t current_;        // The index of the batch being filled, or ring_.size() if no free batch is available
+  bool current_dropped_;  // The records of the current group read are dropped
+
+  // Statistics
+  uint64_t submitted_batch_num_;
+  uint64_t dropped_read_num_;
+  uint64_t dropped_record_num_;
+  size_t max_filled_num_;  // The high-water mark of the ring
+
+  bool finished_;
+  std::thread writer_thread_;
+
+  /**
+   * @brief Hand over the current batch to the writer thread and acquire a free one
+   */
+  void submit_current();
+
+  /**
+   * @brief The number of records of the group read beginning with `record`
+   */
+  size_t get_read_size(const Record &record) const;
+
+  /**
+   * @brief The body of the writer thread
+   */
+  void write_batches();
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>  // for std::string
+
+/**
+ * @brief Get the private cache directory of the user, `$XDG_CACHE_HOME/hperf` or `~/.cache/hperf`, created if missing.
+ * The cached files (probe results, resolved event files, symbol tables) are trusted when they are loaded, so the directory
+ * is only used if it is a real directory owned by the effective user and not writable by others.
+ *
+ * @return std::string The directory, or empty if there is no such directory (nothing is cached then)
+ */
+std::string get_cache_dir();
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>  // for std::string
+
+/**
+ * @brief Find the mount point of the cgroup hierarchy of perf: the cgroup v1 hierarchy with the perf_event controller if mounted,
+ * otherwise the cgroup v2 unified hierarchy (where perf_event is always enabled)
+ *
+ * @param mounts_file
+ * @return std::string Empty if neither is mounted
+ */
+std::string find_perf_cgroup_mount(const std::string &mounts_file = "/proc/mounts");
+
+/**
+ * @brief Open a cgroup for PERF_FLAG_PID_CGROUP.
+ *
+ * The path is relative to the mount point of find_perf_cgroup_mount() (e.g., "system.slice/docker-<id>.scope" or "/top-app"),
+ * or an absolute path in that hierarchy (e.g., "/sys/fs/cgroup/system.slice"). The directory must be on cgroup v2, or in the
+ * cgroup v1 hierarchy with the perf_event controller (checked by statfs()).
+ *
+ * @param path
+ * @return int The fd of the cgroup directory, or -1 (the error is printed)
+ */
+int open_cgroup(const std::string &path);
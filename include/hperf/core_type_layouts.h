@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>     // for size_t
+#include <functional>  // for std::function
+#include <vector>      // for std::vector
+
+#include "pmu_config.h"  // for PMUConfig
+
+/**
+ * @brief The event groups of each core type, for heterogeneous CPUs (e.g., big and little cores with different numbers of programmable counters).
+ *
+ * The measured CPUs with the same number of detected counters are a core type, and the events are grouped for each core type,
+ * so the cores with more counters need fewer groups and complete a rotation in fewer intervals.
+ *
+ * The groups of all core types are also merged into a single PMUConfig with a global group id space: the groups of core type k
+ * are [group_id_base, group_id_base + group_num). The EventScheduler of a CPU counts the groups of its core type with local indices,
+ * and the records carry the global group ids, so the Reporter and the trace writers see a single set of groups.
+ * Every core type counts the same events, so the event indices of the merged config are valid for all CPUs.
+ */
+class CoreTypeLayouts {
+ public:
+  struct CoreType {
+    int counter_num;           // The detected programmable counters (including the ones taken by the fixed events), 0 if not detected
+    std::vector<int> cpu_ids;  // The measured CPUs of this core type
+    PMUConfig pmu_config;      // The event groups of this core type
+    size_t group_id_base;      // The global id of its first group
+  };
+
+  using GroupingFunction = std::function<void(PMUConfig &pmu_config, size_t programmable_counters_num, const std::vector<int> &cpu_ids)>;
+
+  /**
+   * @brief Construct a new CoreTypeLayouts object with a single core type using the given event groups on all CPUs
+   *
+   * @param pmu_config
+   */
+  explicit CoreTypeLayouts(const PMUConfig &pmu_config);
+
+  /**
+   * @brief Group the events again for each core type of the measured CPUs. The core types are ordered by the number of counters,
+   * the first one (fewest counters) is also used for the CPUs not listed, e.g., per-process measurement.
+   *
+   * @param cpu_ids The measured CPUs
+   * @param counter_nums The detected number of programmable counters of each CPU in `cpu_ids`
+   * @param grouping Called on a copy of the original config of each core type, with the number of counters left by the fixed events and its CPUs
+   */
+  void regroup(const std::vector<int> &cpu_ids, const std::vector<int> &counter_nums, const GroupingFunction &grouping);
+
+  const std::vector<CoreType> &get_core_types() const { return core_types_; }
+
+  /**
+   * @brief Get the core type of a CPU, the first core type for a CPU not listed (or -1)
+   *
+   * @param cpu_id
+   * @return size_t The index in get_core_types()
+   */
+  size_t get_core_type_idx(int cpu_id) const;
+
+  const CoreType &get_core_type(int cpu_id) const { return core_types_[get_core_type_idx(cpu_id)]; }
+
+  /**
+   * @brief Get the groups of all core types with the global group ids, for the Reporter and the trace writers
+   */
+  const PMUConfig &get_merged_config() const { return merged_config_; }
+
+  /**
+   * @brief Print the event groups of each core type with their global indices
+   */
+  void print_event_groups() const;
+
+ private:
+  std::vector<CoreType> core_types_;
+  PMUConfig merged_config_;
+};
@@ -13,37 +13,42 @@ class CounterDetector {
 
   /**
    * @brief Detect the number of available progammable counters on each CPU.
-   * Then the detected result can be obtained by `get_detected_general_counter_num()`
+   * All CPUs are probed concurrently, one thread per CPU, and the number of counters is searched by bisection,
+   * so the detection takes a few probe windows whatever the number of CPUs.
+   * Then the detected result can be obtained by `get_detected_general_counter_num()`.
+   * The result is not cached here, see PMUProbe for the cached capabilities of each CPU.
    * 
    */
   void detect();
 
+  /**
+   * @brief Search the number of counters of a CPU by bisection over the number of events
+   *
+   * @param cpu_id CPU ID
+   * @return int The number of counters, or -1 if undetected (a probe failed, or all the events of the list fit)
+   */
+  static int detect_on_cpu(uint64_t cpu_id);
+
   int get_detected_general_counter_num(uint64_t cpu_id) const;
 
   int get_detected_general_counter_num() const; 
 
   void print_result() const;
 
-  /**
-   * @brief Save detected counter numbers to /tmp/.hperf file
-   */
-  void save_detected_result() const;
-
-  /**
-   * @brief Load detected counter numbers from /tmp/.hperf file
-   * @return true if file exists and load succeeded, false otherwise
-   */
-  bool load_detected_result();
-
  private:
   bool detected_;
 
-  std::vector<int> fds_;
-
   uint64_t cpu_num_;
 
   std::vector<int> detected_general_counter_nums_;
 
+  /**
+   * @brief The result of a probe
+   */
+  enum class ProbeResult { FIT,          // No multiplexing: the events fit in the counters
+                           MULTIPLEXED,  // Multiplexing is triggered
+                           FAILED };     // An event cannot be created, enabled or read
+
   static void configure_event(struct perf_event_attr *pe,
                               uint64_t encoding);
 
@@ -54,17 +59,16 @@ class CounterDetector {
    * @brief Test on a specified CPU: try to measure multiple events simultaneously and determine whether the multiplexing is triggered.  
    * 
    * @param cpu_id CPU ID
-   * @param event_num The number of events for this test
-   * @return true Multiplexing is triggered
-   * @return false Multiplexing is not triggered
+   * @param event_num The number of events for this test, the first ones of `event_list`
+   * @return ProbeResult
    */
-  bool test(uint64_t cpu_id, uint64_t event_num);
+  static ProbeResult test(uint64_t cpu_id, uint64_t event_num);
 
-  bool enable_all_events();
+  static bool enable_all_events(const std::vector<int> &fds);
 
-  bool disable_all_events();
+  static bool disable_all_events(const std::vector<int> &fds);
 
-  void close_all_events();
+  static void close_all_events(const std::vector<int> &fds);
 
   inline static const std::vector<std::pair<std::string, uint64_t>> event_list = {
       {"l1i_cache_refill", 0x0001},
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>              // for std::atomic
+#include <condition_variable>  // for std::condition_variable
+#include <cstdint>             // for uint64_t
+#include <memory>              // for std::unique_ptr
+#include <mutex>               // for std::mutex
+#include <thread>              // for std::thread
+#include <vector>              // for std::vector
+
+#include "core_type_layouts.h"  // for CoreTypeLayouts
+#include "interval_timer.h"     // for IntervalTimer
+#include "profile_config.h"     // for ProfileConfig
+#include "reporter.h"           // for Record, Reporter
+#include "spsc_queue.h"         // for SPSCQueue
+#include "trace_writer.h"       // for TraceWriter
+
+/**
+ * @brief System-wide collector with one thread pinned to each target CPU.
+ *
+ * Each collector thread owns the EventScheduler of its CPU, so that the read() and the ioctl()s for switching are always issued locally (no cross-CPU IPI).
+ * All threads are released by a common start barrier, and the records are passed to the main thread through a lock-free SPSC queue per CPU.
+ * The main thread is the only one that touches the Reporter and the TraceWriter.
+ */
+class PerCpuCollector {
+ public:
+  /**
+   * @brief Construct a new PerCpuCollector object
+   *
+   * @param core_type_layouts The event groups of each core type, shared (read-only) by all collector threads
+   * @param config Profiling config, `cpu_id_list`, `test_duration` and `switch_group_interval` are used
+   */
+  PerCpuCollector(const CoreTypeLayouts &core_type_layouts, const ProfileConfig &config);
+
+  ~PerCpuCollector();
+
+  PerCpuCollector(const PerCpuCollector &) = delete;
+  PerCpuCollector &operator=(const PerCpuCollector &) = delete;
+
+  /**
+   * @brief Start the collector threads, drain their records into the reporter until the measurement ends.
+   *
+   * @param reporter Reference to the Reporter, only accessed on the calling thread
+   * @param trace_writer The raw data output, only accessed on the calling thread
+   * @return true On success
+   * @return false If any collector thread failed to initialize its event groups
+   */
+  bool run(Reporter &reporter, TraceWriter &trace_writer);
+
+ private:
+  /**
+   * @brief Per-CPU state shared between a collector thread and the main thread
+   */
+  struct Worker {
+    int cpu_id;
+    SPSCQueue<Record> queue;
+    std::atomic<bool> finished;
+    uint64_t queue_full_spins;     // Written by the collector thread, read after join()
+    IntervalTimer interval_timer;  // Used by the collector thread, its jitter stats are read after join()
+    std::thread thread;
+
+    explicit Worker(int cpu, size_t queue_capacity, uint64_t period_in_ns)
+        : cpu_id(cpu), queue(queue_capacity), finished(false), queue_full_spins(0), interval_timer(period_in_ns) {}
+  };
+
+  const CoreTypeLayouts &core_type_layouts_;
+  const ProfileConfig &config_;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  // Start barrier: all collector threads report readiness, then wait for the main thread to release them
+  std::mutex barrier_mutex_;
+  std::condition_variable barrier_cv_;
+  size_t ready_num_;
+  size_t failed_num_;
+  bool released_;
+  bool aborted_;
+  uint64_t start_timestamp_;  // Written by the main thread before the release
+
+  /**
+   * @brief The body of a collector thread
+   *
+   * @param worker The state of the CPU this thread is pinned to
+   */
+  void collect(Worker &worker);
+
+  /**
+   * @brief Pin the calling thread to the specified CPU
+   *
+   * @param cpu_id CPU ID
+   * @return true On success
+   * @return false On failure
+   */
+  static bool pin_to_cpu(int cpu_id);
+
+  /**
+   * @brief Called by a collector thread: report its readiness and block until all threads are released.
+   *
+   * @param ok false if the thread failed to initialize
+   * @return true The measurement starts
+   * @return false The measurement is aborted because some thread failed
+   */
+  bool arrive_and_wait(bool ok);
+
+  /**
+   * @brief Called by a collector thread: push a record into its queue, waiting while the queue is full
+   */
+  static void push_record(Worker &worker, const Record &record);
+
+  /**
+   * @brief Move all available records out of each worker queue into the reporter
+   *
+   * @return size_t The number of records drained
+   */
+  size_t drain(Reporter &reporter, TraceWriter &trace_writer);
+};
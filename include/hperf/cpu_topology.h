@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>  // for std::string
+
+/**
+ * @brief The position of a logical CPU in the topology, read from /sys/devices/system/cpu/cpu<N>/topology/
+ */
+struct CpuTopology {
+  int cpu_id;
+  int core_id;     // core_id, unique within the package
+  int cluster_id;  // cluster_id (since Linux 5.16), -1 if not available
+  int package_id;  // physical_package_id
+};
+
+/**
+ * @brief Read the topology of a logical CPU from sysfs.
+ * Missing files (e.g., cluster_id on older kernels, or no sysfs at all) are reported as -1.
+ *
+ * @param cpu_id
+ * @return CpuTopology
+ */
+CpuTopology read_cpu_topology(int cpu_id);
+
+/**
+ * @brief Roll-up levels of per-CPU statistics
+ */
+enum class TopologyLevel { CPU,
+                           CORE,
+                           CLUSTER,
+                           PACKAGE };
+
+/**
+ * @brief Parse a level name ("cpu", "core", "cluster", "package")
+ *
+ * @param name
+ * @param[out] level
+ * @return true On success
+ * @return false Unknown name
+ */
+bool parse_topology_level(const std::string &name, TopologyLevel &level);
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <map>     // for std::map
+#include <set>     // for std::set
+#include <string>  // for std::string
+#include <vector>  // for std::vector
+
+#include "json_parser.h"  // for JsonValue
+#include "pmu_event.h"    // for struct PMUEvent
+
+// The PMU drivers registered to perf, each with a `type` file, and `format` and `events` directories
+#define SYSFS_EVENT_SOURCE_DIR "/sys/bus/event_source/devices"
+
+/**
+ * @brief Parse an entry of the Linux pmu-events JSON files (tools/perf/pmu-events/arch): "EventName", "EventCode" and "UMask"
+ * (x86, shifted left by 8) as numbers or strings, "BriefDescription" or "PublicDescription", and "Counter", the list of the allowed
+ * programmable counters (e.g., "0,1,2,3"). The other fields are ignored, the type is PERF_TYPE_RAW.
+ *
+ * @param entry
+ * @param event
+ * @param error The error message if the entry has no name or no valid code
+ * @return true Success
+ * @return false Not an event entry
+ */
+bool parse_pmu_event(const JsonValue &entry, PMUEvent &event, std::string &error);
+
+/**
+ * @brief Read the dynamic perf_event_attr.type of a PMU from sysfs, e.g., "armv8_pmuv3_0", "cpu", "arm_cmn_0"
+ *
+ * @param pmu The PMU name
+ * @param sysfs_root
+ * @return int The type, or -1 if there is no such PMU
+ */
+int read_pmu_type(const std::string &pmu, const std::string &sysfs_root = SYSFS_EVENT_SOURCE_DIR);
+
+/**
+ * @brief Read the events of the core PMUs exported by the kernel in sysfs, keyed by lowercase name.
+ *
+ * A core PMU has a `cpus` file (Arm PMUs, x86 hybrid "cpu_core" / "cpu_atom") or is named "cpu" (x86).
+ * An event file (e.g., "event=0x3c,umask=0x01") is encoded into perf_event_attr.config by the `format` files of its PMU
+ * (e.g., "config:0-7"); the events with a term outside `config` or with a parameter to fill in ("?") are skipped.
+ * An event of several core PMUs (big.LITTLE) with the same encoding uses PERF_TYPE_RAW, so the kernel counts it on the PMU of each CPU.
+ * A name exported with different encodings by several core PMUs (e.g., "cpu_core" and "cpu_atom" of x86 hybrid) is left out.
+ *
+ * @param sysfs_root
+ * @param ambiguous_events The names left out for their different encodings, if not nullptr
+ * @return std::map<std::string, PMUEvent> Empty if sysfs is not available
+ */
+std::map<std::string, PMUEvent> read_sysfs_events(const std::string &sysfs_root = SYSFS_EVENT_SOURCE_DIR,
+                                                  std::set<std::string> *ambiguous_events = nullptr);
+
+/**
+ * @brief The events and event groups loaded from an event file
+ */
+struct EventFileConfig {
+  std::vector<PMUEvent> fixed_events;
+  std::vector<std::vector<PMUEvent>> event_groups;
+  std::string metric_definitions;  // Empty if the file has no metrics
+};
+
+/**
+ * @brief Load the events and event groups from a JSON event file, so that a single binary picks the events of each machine at startup.
+ *
+ *   {
+ *     "events": [
+ *       {"EventName": "CNT_CYCLES", "EventCode": "0x4004", "BriefDescription": "Constant frequency cycles"},
+ *       {"EventName": "LD_RETIRED", "EventCode": "0xd0", "UMask": "0x81", "Counter": "0,1,2,3"},
+ *       {"EventName": "LITTLE_L2D_CACHE", "EventCode": "0x16", "PMU": "armv8_cortex_a520"}
+ *     ],
+ *     "fixed_events": ["cpu_cycles", "cnt_cycles", "inst_retired"],
+ *     "event_groups": [["inst_spec", "ld_spec", "st_spec"], ["l1d_cache", "l1d_cache_refill"]],
+ *     "metrics": ["section Pipeline basic metrics", "CPI = cpu_cycles / inst_retired"]
+ *   }
+ *
+ * The names in "fixed_events" and "event_groups" are looked up (case-insensitively) in "events" first, then in the events of
+ * the core PMUs in sysfs (see read_sysfs_events()), so a file of names only works on every machine whose kernel knows them.
+ * "events" takes the fields of the Linux pmu-events JSON files (see parse_pmu_event()), and "PMU", a core PMU in sysfs
+ * for the events of one core type only (PERF_TYPE_RAW if absent), or a PMU of the kernel such as "software". The events of
+ * an uncore PMU (one with a `cpumask` file, e.g., "arm_cmn_0") may be defined, but not used in "fixed_events" or "event_groups":
+ * the groups are opened per task or per CPU and led by a core event, while the kernel rejects a group mixing hardware PMUs
+ * and an uncore PMU cannot count a task.
+ * "metrics" is optional, a string or an array of lines in the metric definition language (see metric_engine.h).
+ *
+ * The resolved result is cached in the private cache directory (see get_cache_dir()), keyed by the hardware fingerprint
+ * (see read_hardware_fingerprint()) and the content of the file, so the next run reads neither the JSON nor sysfs.
+ *
+ * @param filename
+ * @param config The loaded events and event groups
+ * @param sysfs_root
+ * @return true Success
+ * @return false The file cannot be read or parsed, or an event cannot be resolved (the error is printed)
+ */
+bool load_event_file(const std::string &filename, EventFileConfig &config, const std::string &sysfs_root = SYSFS_EVENT_SOURCE_DIR);
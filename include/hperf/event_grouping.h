@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+#include <utility>  // for std::pair
+#include <vector>   // for std::vector
+
+#include "pmu_event.h"  // for struct PMUEvent, EventKey
+
+/**
+ * @brief Pack the schedulable events into the minimum number of event groups (bin packing) by branch-and-bound.
+ *
+ * Every group is counted together with the fixed events, on `counter_num` programmable counters.
+ * A group is feasible if its events and the fixed events can be assigned to distinct counters allowed by their `counter_mask`
+ * (a bipartite matching, so an event restricted to a few counters never takes the place of a less constrained one),
+ * and if no two of its events are a known conflicting pair (see set_conflicts()).
+ *
+ * Affinity sets (e.g., the operands of a metric) are packed as units, so their events are counted in a common group.
+ * A group holds the union of its units: the events shared by several units (e.g., a common denominator) are counted once per group,
+ * and in several groups if that is needed to keep every unit whole. A set that does not fit in a group alone is packed event by event.
+ *
+ * The search starts from first-fit decreasing, and stops when the lower bound is reached or after `node_limit` search nodes.
+ * The limit is counted in nodes rather than in wall-clock time, so that the result only depends on the input and is the same on every run and every machine.
+ */
+class EventGroupingSolver {
+ public:
+  /**
+   * @brief Construct a new EventGroupingSolver object
+   *
+   * @param fixed_events The events counted in every group
+   * @param counter_num The number of programmable counters, including the ones taken by the fixed events
+   * @param node_limit The maximum number of search nodes
+   */
+  EventGroupingSolver(const std::vector<PMUEvent> &fixed_events, size_t counter_num, uint64_t node_limit = 1000000);
+
+  /**
+   * @brief Set the pairs of events that cannot be counted in the same group, e.g., found by PMUProbe
+   *
+   * @param conflicts Pairs of events
+   */
+  void set_conflicts(const std::vector<std::pair<EventKey, EventKey>> &conflicts) { conflicts_ = conflicts; }
+
+  /**
+   * @brief Solve the grouping. Events with the same type and encoding are the same event.
+   * The events of a group keep their order in `events`, and the groups are ordered by their first event.
+   * Without affinity sets, every event is in exactly one group.
+   *
+   * @param events The schedulable events
+   * @param affinity_sets Sets of indices into `events` that should be counted in a common group, may be empty
+   * @param[out] groups The event groups
+   * @return true On success
+   * @return false If some event cannot be counted together with the fixed events at all
+   */
+  bool solve(const std::vector<PMUEvent> &events, const std::vector<std::vector<size_t>> &affinity_sets,
+             std::vector<std::vector<PMUEvent>> &groups);
+
+  bool solve(const std::vector<PMUEvent> &events, std::vector<std::vector<PMUEvent>> &groups) {
+    return solve(events, {}, groups);
+  }
+
+  /**
+   * @brief Whether the last solution is proven to be optimal (the search was not stopped by the node limit)
+   */
+  bool is_optimal() const { return optimal_; }
+
+  size_t get_lower_bound() const { return lower_bound_; }
+
+  uint64_t get_node_num() const { return node_num_; }
+
+  /**
+   * @brief Get the indices of the affinity sets whose events are split across groups in the last solution
+   */
+  const std::vector<size_t> &get_split_sets() const { return split_sets_; }
+
+ private:
+  std::vector<PMUEvent> fixed_events_;
+  size_t counter_num_;
+  uint64_t node_limit_;
+  std::vector<std::pair<EventKey, EventKey>> conflicts_;
+
+  std::vector<PMUEvent> events_;            // The distinct events
+  std::vector<std::vector<bool>> conflicting_;  // [i][j]: events_[i] and events_[j] cannot be in the same group
+  std::vector<std::vector<size_t>> items_;  // The units of packing, in the order of visiting (indices into events_)
+
+  std::vector<std::vector<size_t>> bins_;       // The groups of the current search node, indices into events_
+  std::vector<std::vector<size_t>> best_bins_;  // The best grouping found so far
+  std::vector<size_t> placed_num_;              // The number of groups of the current search node containing each event
+
+  size_t lower_bound_;
+  uint64_t node_num_;
+  bool optimal_;
+  std::vector<size_t> split_sets_;
+
+  /**
+   * @brief The mask of the counters an event can use, with 0 replaced by all counters
+   */
+  uint64_t allowed_counters(const PMUEvent &event) const;
+
+  /**
+   * @brief Check if the fixed events, the events of `bin` and the events of `extra` fit on distinct allowed counters,
+   * and no conflicting pair is introduced by `extra`
+   */
+  bool fits(const std::vector<size_t> &bin, const std::vector<size_t> &extra) const;
+
+  /**
+   * @brief Get the events of `item` that are not in `bin`
+   */
+  std::vector<size_t> missing_events(const std::vector<size_t> &bin, const std::vector<size_t> &item) const;
+
+  void search(size_t k);
+};
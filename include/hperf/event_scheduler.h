@@ -7,11 +7,14 @@
 #include <unistd.h>
 
 #include <cstring>  // For strerror
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "pmu_config.h"
 #include "read_buffer.h"
+#include "ring_buffer.h"
+#include "scheduling_policy.h"
 
 /**
  * @brief Control hardware counter multiplexing. It creates file descriptors (fds) using perf_event_open system call and read buffers for each event group. It is also responsible for controlling scheduling during measurement.
@@ -27,7 +30,7 @@ class EventScheduler {
    * @param target_pid Process PID to be monitored, -1 for system-wide measurement
    * @param target_cpu A single CPU ID to be monitored, -1 for per-process measurement. If multiple CPUs are specified for system-wide measurement, each specified CPU has an EventGroups. 
    */
-  EventScheduler(PMUConfig &pmu_config, pid_t target_pid, int target_cpu);
+  EventScheduler(const PMUConfig &pmu_config, pid_t target_pid, int target_cpu);
 
   /**
    * @brief Move constructor
@@ -54,6 +57,67 @@ class EventScheduler {
    */
   ~EventScheduler();
 
+  /**
+   * @brief Enable or disable the delta-based group accounting. It should be called before initialize().
+   *
+   * In delta mode, the event counts are never reset: the cumulative counts of each group are kept, and the read buffer holds the difference from the previous read of the same group.
+   * Thus switching only takes DISABLE and ENABLE (no RESET), and no event is lost between reset and enable.
+   *
+   * @param enable
+   */
+  void set_delta_mode(bool enable);
+
+  /**
+   * @brief Let the events of a per-process scheduler also count the child tasks created after initialize(). It should be called before initialize().
+   * The kernel sums the counts and times of the children into the group reads (PERF_FORMAT_GROUP with inherit), which needs a recent kernel,
+   * see TaskFollower::inherit_group_read_supported().
+   * It also turns on the delta mode (see set_delta_mode()): PERF_EVENT_IOC_RESET only clears the counts of the task itself,
+   * not the counts of the exited children, so the group reads are only meaningful as differences of cumulative values.
+   *
+   * @param enable
+   */
+  void set_inherit(bool enable);
+
+  /**
+   * @brief Let the events of a system-wide scheduler only count the tasks of a cgroup on its CPU (PERF_FLAG_PID_CGROUP).
+   * It should be called before initialize().
+   *
+   * @param cgroup_fd An open directory of the perf_event cgroup hierarchy (see open_cgroup()), owned by the caller, or -1 for all tasks
+   */
+  void set_cgroup(int cgroup_fd);
+
+  /**
+   * @brief Let an event of the groups sample on overflow every `period` counts. It should be called before initialize().
+   * Every instance of the event (a fixed event is in each group) writes PERF_RECORD_SAMPLE with the IP and the PID/TID, and the
+   * callchain if asked, into one ring buffer of this scheduler (PERF_EVENT_IOC_SET_OUTPUT), drained by drain_samples().
+   * The first instance also reports the executable mappings (PERF_RECORD_MMAP) for the symbolization.
+   * A scheduled event only samples while its group is active.
+   *
+   * @param event_name The name of the sampled event, which must be in the PMUConfig
+   * @param period The number of counts between two samples
+   * @param callchain Record the callchain of each sample
+   */
+  void set_sampling(const std::string &event_name, uint64_t period, bool callchain);
+
+  /**
+   * @brief Visit the records of the sample ring buffer (see set_sampling()) in place, then give their space back to the kernel
+   *
+   * @tparam Visitor void(const struct perf_event_header *record), the record is only valid during the call
+   * @param visitor
+   * @return size_t The number of records
+   */
+  template <typename Visitor>
+  size_t drain_samples(Visitor visitor) {
+    return sample_ring_.drain(visitor);
+  }
+
+  /**
+   * @brief Set the policy that selects the next event group in switch_to_next_group(). Without a policy, the groups are switched in round-robin.
+   *
+   * @param policy
+   */
+  void set_scheduling_policy(std::unique_ptr<SchedulingPolicy> policy);
+
   /**
    * @brief Initializes file descriptors and read format for each event group. 
    *
@@ -97,14 +161,25 @@ class EventScheduler {
   bool disable_active_group();
 
   /**
-   * @brief Switch to the next event group during the measurement. 
-   * It disables the current active event group, enables the next, and resets the event count of the new active event group.
+   * @brief Switch to the next event group during the measurement, selected by the scheduling policy.
+   * It disables the current active event group, enables the next, and resets the event count of the new active event group (except in delta mode).
    *
    * @return true On success
    * @return false On failure
    */
   bool switch_to_next_group();
 
+  /**
+   * @brief Switch to the given event group, e.g., the active group of another scheduler, without consulting the scheduling policy.
+   * It disables the current active event group, enables the given one, and resets its event count (except in delta mode).
+   * If the given group is already active, it is only reset, as switch_to_next_group() does when it picks the same group.
+   *
+   * @param group_idx
+   * @return true On success
+   * @return false On failure
+   */
+  bool switch_to_group(int group_idx);
+
   /**
    * @brief Reads data from the currently active group.
    * The caller is responsible for providing a buffer of appropriate size.
@@ -116,6 +191,12 @@ class EventScheduler {
    */
   ssize_t read_active_group_data();
 
+  /**
+   * @brief Get the read buffer of the active group, which holds the values of the last interval:
+   * the event counts since the group was switched in, and time_enabled / time_running of the last interval (rather than the cumulative times kept by the kernel).
+   *
+   * @return GroupReadBuffer&
+   */
   GroupReadBuffer& get_active_group_read_buffer();
   int get_active_group_idx() const;
   bool is_initialized() const;
@@ -124,9 +205,11 @@ class EventScheduler {
 
  private:
   std::vector<std::vector<int>> fds_;
-  std::vector<GroupReadBuffer> read_buffers_;  // One Group Read Buffer per event group
+  std::vector<GroupReadBuffer> read_buffers_;   // One Group Read Buffer per event group, the cumulative values read from the kernel
+  std::vector<GroupReadBuffer> prev_buffers_;   // The cumulative values of the previous read of each event group
+  std::vector<GroupReadBuffer> delta_buffers_;  // The values of the last interval of each event group
 
-  PMUConfig &pmu_config_;
+  const PMUConfig *pmu_config_;  // A pointer, so that a move assignment rebinds it to the config of the other scheduler
   pid_t target_pid_;  // -1 for any CPU if target_pid_ is set, or specific CPU for system-wide
   int target_cpu_;
 
@@ -134,6 +217,19 @@ class EventScheduler {
 
   bool initialized_;  // true if it has been initialized
 
+  bool delta_mode_;  // true if the event counts are never reset (see set_delta_mode())
+
+  bool inherit_;  // true if the events also count the child tasks (see set_inherit())
+
+  int cgroup_fd_;  // -1, or the cgroup whose tasks are counted (see set_cgroup())
+
+  std::string sample_event_;  // Empty, or the event sampling on overflow (see set_sampling())
+  uint64_t sample_period_;
+  bool sample_callchain_;
+  PerfRingBuffer sample_ring_;  // Mapped on the first instance of the sampled event, the output of all the others
+
+  std::unique_ptr<SchedulingPolicy> scheduling_policy_;  // nullptr for round-robin
+
   /**
    * @brief Clear the already-created event file descriptors. 
    * 
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>  // for uint64_t
+#include <string>   // for std::string
+
+/**
+ * @brief Read the first line of a file without the trailing whitespace, e.g., a sysfs or procfs attribute
+ *
+ * @param path
+ * @return std::string Empty if the file cannot be read
+ */
+std::string read_first_line(const std::string &path);
+
+/**
+ * @brief The 64-bit FNV-1a hash of a text, e.g., for the names of the cached files (see get_cache_dir())
+ */
+uint64_t fnv1a(const std::string &text);
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>        // for size_t
+#include <cstdint>        // for uint64_t
+#include <map>            // for std::map
+#include <ostream>        // for std::ostream
+#include <unordered_map>  // for std::unordered_map
+#include <vector>         // for std::vector
+
+#include "core_type_layouts.h"  // for CoreTypeLayouts
+#include "metric_engine.h"      // for MetricEngine
+#include "pmu_config.h"         // for PMUConfig
+#include "reporter.h"           // for Record
+
+/**
+ * @brief Time series of the derived metrics (`--interval-metrics`), one row per completed group rotation per CPU.
+ *
+ * A rotation of a CPU is complete when every event group (of its core type) has been read on it since the last row, in any order.
+ * The counts of the rotation are estimated like Reporter::estimation(), but over the time of the rotation only:
+ * fixed events are summed, a schedulable event is scaled by (rotation time / running time of the groups containing it).
+ * For system-wide measurement, a row with CPU "all" is written once every CPU has completed the same rotation, from the sum of the per-CPU estimates.
+ *
+ * CSV layout: `timestamp,cpu,<metric 1>,<metric 2>,...`, percentages are written as in the report (x 100).
+ */
+class IntervalMetricWriter {
+ public:
+  /**
+   * @brief Construct a new IntervalMetricWriter object
+   *
+   * @param pmu_config
+   * @param metric_engine The compiled metrics, must outlive this object
+   * @param out The output stream
+   * @param cpu_num The number of measured CPUs; with 1 CPU (or per-process) no system-wide row is written
+   */
+  IntervalMetricWriter(const PMUConfig &pmu_config, const MetricEngine &metric_engine, std::ostream &out, size_t cpu_num);
+
+  /**
+   * @brief Write the line of column names
+   */
+  void write_header();
+
+  void process_a_record(const Record &record);
+
+  /**
+   * @brief Set the core types of the measured CPUs, the PMU config of the writer must be their merged config
+   *
+   * @param core_type_layouts The core types, or nullptr for the same groups on all CPUs
+   */
+  void set_core_type_layouts(const CoreTypeLayouts *core_type_layouts) { core_type_layouts_ = core_type_layouts; }
+
+ private:
+  struct RotationState {
+    std::vector<uint64_t> raw_sum;      // The raw counts in this rotation, indexed by event index
+    std::vector<uint64_t> running_sum;  // The running time of the groups counting each event
+    uint64_t duration;                  // The sum of time_enabled of the groups, i.e., the time of the rotation
+    std::vector<bool> group_seen;       // The groups read in this rotation, indexed by group id
+    size_t seen_group_num;
+  };
+
+  struct SystemState {
+    std::vector<double> event_values;
+    uint64_t duration_sum;
+    uint64_t timestamp;
+    size_t cpu_count;
+  };
+
+  const PMUConfig &pmu_config_;
+  const MetricEngine &metric_engine_;
+  std::ostream &out_;
+  size_t cpu_num_;
+  uint64_t cnt_freq_;
+  const CoreTypeLayouts *core_type_layouts_;
+
+  size_t fixed_event_num_;
+  size_t event_num_;
+  std::vector<std::vector<size_t>> event_slots_;  // [group_id][event_id] -> event index
+
+  std::unordered_map<int, RotationState> cpu_states_;  // cpu_id -> the rotation in progress
+  std::unordered_map<int, uint64_t> rotation_counts_;  // cpu_id -> the number of completed rotations
+  std::map<uint64_t, SystemState> system_states_;      // rotation index -> the sum of the CPUs completed so far
+
+  std::vector<double> event_values_;  // Scratch buffer of the estimated values
+
+  void write_row(uint64_t timestamp, int cpu_id, const std::vector<double> &event_values, uint64_t duration);
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+#include <ostream>  // for std::ostream
+#include <vector>   // for std::vector
+
+/**
+ * @brief Drift-free interval timer based on absolute deadlines.
+ *
+ * The switch boundaries are kept on a fixed grid `start + k * period` (CLOCK_MONOTONIC, the clock of std::chrono::steady_clock),
+ * and the thread sleeps by clock_nanosleep(TIMER_ABSTIME), so the cost of reading, writing and switching in each interval does not accumulate.
+ * The wakeup jitter (actual wakeup time - deadline) of every interval is recorded.
+ */
+class IntervalTimer {
+ public:
+  /**
+   * @brief Construct a new IntervalTimer object
+   *
+   * @param period_in_ns The interval between two boundaries in nanoseconds
+   */
+  explicit IntervalTimer(uint64_t period_in_ns);
+
+  /**
+   * @brief Start the grid. The first boundary is `start_timestamp + period`.
+   *
+   * @param start_timestamp Timestamp in nanoseconds of CLOCK_MONOTONIC (see now())
+   */
+  void start(uint64_t start_timestamp);
+
+  /**
+   * @brief Sleep until the next boundary on the grid.
+   * If the caller has already overrun one or more boundaries, they are skipped (and counted) so that the grid is kept.
+   *
+   * @return uint64_t The actual wakeup timestamp in nanoseconds
+   */
+  uint64_t wait_for_next_boundary();
+
+  /**
+   * @brief Change the period. The grid is restarted from the last boundary.
+   *
+   * @param period_in_ns The new period in nanoseconds
+   */
+  void set_period(uint64_t period_in_ns);
+
+  uint64_t get_period() const { return period_; }
+
+  /**
+   * @brief Get the deadline of the last boundary that has been waited for
+   */
+  uint64_t get_last_deadline() const { return last_deadline_; }
+
+  /**
+   * @brief Get the recorded wakeup jitter of each interval in nanoseconds
+   */
+  const std::vector<uint64_t> &get_jitters() const { return jitters_; }
+
+  size_t get_missed_boundary_num() const { return missed_boundary_num_; }
+
+  /**
+   * @brief Merge the recorded jitter of another timer into this one, e.g., to summarize the timers of all collector threads
+   *
+   * @param other
+   */
+  void merge_stats(const IntervalTimer &other);
+
+  /**
+   * @brief Print the summary of the wakeup jitter (mean, p99, max) and the number of missed boundaries
+   *
+   * @param out
+   */
+  void print_jitter_stats(std::ostream &out) const;
+
+  /**
+   * @brief Get the current timestamp of CLOCK_MONOTONIC in nanoseconds
+   */
+  static uint64_t now();
+
+ private:
+  uint64_t period_;
+  uint64_t last_deadline_;
+
+  std::vector<uint64_t> jitters_;
+  size_t missed_boundary_num_;
+};
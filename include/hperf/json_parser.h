@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>  // for std::string
+#include <vector>  // for std::vector
+
+/**
+ * @brief A parsed JSON value. Only the member of its type is meaningful.
+ */
+struct JsonValue {
+  enum class Type { NUL,
+                    BOOL,
+                    NUMBER,
+                    STRING,
+                    ARRAY,
+                    OBJECT };
+
+  Type type = Type::NUL;
+  bool boolean = false;
+  double number = 0;
+  std::string string;
+
+  std::vector<JsonValue> elements;  // The elements of an array, or the member values of an object
+  std::vector<std::string> keys;    // The member names of an object, in the file order
+
+  /**
+   * @brief Find the member of an object by name
+   *
+   * @param key
+   * @return const JsonValue* nullptr if this is not an object or it has no such member
+   */
+  const JsonValue *find(const std::string &key) const;
+};
+
+/**
+ * @brief A minimal JSON parser (RFC 8259) for the event files, without any dependency.
+ * The \uXXXX escapes are decoded to UTF-8, and the numbers are parsed as double.
+ *
+ * @param text
+ * @param value The parsed value
+ * @param error The error message with the line number if parsing fails
+ * @return true Success
+ * @return false Syntax error
+ */
+bool parse_json(const std::string &text, JsonValue &value, std::string &error);
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>     // for size_t
+#include <functional>  // for std::function
+#include <string>      // for std::string
+#include <vector>      // for std::vector
+
+/**
+ * @brief The unit of a metric, which decides how it is printed
+ */
+enum class MetricUnit { NONE,      // decimal, e.g., CPI, MPKI
+                        PERCENT,   // ratio printed as percentage
+                        CYCLES,    // latency in cycles
+                        GHZ };     // frequency in GHz
+
+/**
+ * @brief A metric compiled into bytecode over resolved event indices
+ */
+struct CompiledMetric {
+  /**
+   * @brief A bytecode instruction of the stack machine
+   */
+  struct Instruction {
+    enum Op { PUSH_CONST,  // push `constant`
+              PUSH_EVENT,  // push event_values[index]
+              PUSH_VAR,    // push variables[index]
+              ADD,
+              SUB,
+              MUL,
+              DIV,  // division by zero yields 0
+              NEG };
+    Op op;
+    size_t index;
+    double constant;
+  };
+
+  std::string name;
+  std::string section;     // e.g., "Breakdown based on misses"
+  std::string subsection;  // e.g., "Cache", may be empty
+  MetricUnit unit;
+
+  std::vector<Instruction> code;
+  size_t max_stack_depth;
+
+  std::vector<size_t> event_operands;  // The distinct event indices referenced by the expression
+};
+
+/**
+ * @brief Metric definition language, compiled once and evaluated cheaply on every interval.
+ *
+ * A definition is a text file (or an embedded string), one statement per line:
+ *
+ *   # comment
+ *   section Pipeline basic metrics
+ *   subsection Cache
+ *   CPI = cpu_cycles / inst_retired
+ *   Load [%] = ld_spec / inst_spec
+ *   Memory read latency [cycles] = mem_access_rd_percyc / mem_access_rd
+ *
+ * Expressions support + - * / unary minus, parentheses, numbers (e.g., 1e9), event names and the built-in variables
+ * `$cnt_freq` (frequency of the constant counter in Hz) and `$duration_ns` (measured time in ns).
+ * Units are `%`, `cycles` and `GHz`; without a unit the value is printed as a decimal.
+ * Event names are resolved to indices once at compile time, a metric referencing an unknown event is skipped with a warning.
+ */
+class MetricEngine {
+ public:
+  /**
+   * @brief Built-in variables, the index into the `variables` array of evaluate()
+   */
+  enum Variable { CNT_FREQ,
+                  DURATION_NS,
+                  VARIABLE_NUM };
+
+  /**
+   * @brief Map an event name to its index in the `event_values` array of evaluate(), or -1 if unknown
+   */
+  using EventResolver = std::function<int(const std::string &)>;
+
+  /**
+   * @brief Compile the metric definitions and append the compiled metrics
+   *
+   * @param text The metric definitions
+   * @param resolver Resolves event names to indices
+   * @param[out] error The error message with the line number on failure
+   * @return true On success
+   * @return false On syntax error, no metric is appended
+   */
+  bool compile(const std::string &text, const EventResolver &resolver, std::string &error);
+
+  /**
+   * @brief Load the metric definitions from a file and compile them
+   *
+   * @param filename
+   * @param resolver Resolves event names to indices
+   * @param[out] error The error message on failure
+   * @return true On success
+   * @return false On failure
+   */
+  bool load_file(const std::string &filename, const EventResolver &resolver, std::string &error);
+
+  /**
+   * @brief Evaluate a compiled metric
+   *
+   * @param metric The compiled metric
+   * @param event_values The values of events, indexed by the resolved event index
+   * @param variables The values of the built-in variables, VARIABLE_NUM elements
+   * @return double
+   */
+  static double evaluate(const CompiledMetric &metric, const std::vector<double> &event_values, const double *variables);
+
+  const std::vector<CompiledMetric> &get_metrics() const { return metrics_; }
+
+  void clear() { metrics_.clear(); }
+
+ private:
+  std::vector<CompiledMetric> metrics_;
+};
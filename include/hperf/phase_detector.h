@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+#include <vector>   // for std::vector
+
+#include "interval_timer.h"  // for IntervalTimer
+#include "read_buffer.h"     // for GroupReadBuffer
+
+/**
+ * @brief Online detection of workload phase changes (`--phase-detect`), from the fixed events that are counted in every interval whatever the active group.
+ *
+ * The watched signals are the ratios of the other fixed events to the first one, e.g., inst_retired / cpu_cycles (IPC) and cnt_cycles / cpu_cycles.
+ * Each ratio is tracked by an exponentially weighted mean and variance. A phase change is reported when any ratio deviates from its mean
+ * by more than both `threshold` (relative) and 3 standard deviations; the baseline then restarts from the new values.
+ * Intervals with too few cycles (e.g., an idle CPU) are ignored.
+ */
+class PhaseDetector {
+ public:
+  /**
+   * @brief Construct a new PhaseDetector object
+   *
+   * @param fixed_event_num The number of fixed events, the first entries of every group read buffer
+   * @param threshold The relative deviation of a ratio that is considered as a phase change
+   */
+  explicit PhaseDetector(size_t fixed_event_num, double threshold = 0.25);
+
+  /**
+   * @brief Feed the read buffer of an interval
+   *
+   * @param buffer The delta read buffer of the active group (see EventScheduler::get_active_group_read_buffer())
+   * @return true A phase change is detected in this interval
+   * @return false Otherwise
+   */
+  bool observe(const GroupReadBuffer &buffer);
+
+ private:
+  size_t fixed_event_num_;
+  double threshold_;
+
+  uint64_t n_;                 // The number of intervals since the baseline was (re)started
+  std::vector<double> means_;  // The exponentially weighted mean of each ratio
+  std::vector<double> vars_;   // The exponentially weighted variance of each ratio
+};
+
+/**
+ * @brief Temporarily shorten the switching interval after a phase change, so that every event group samples the new phase.
+ *
+ * After a phase change, the interval is set to `period / group_num` (at least 10 ms, never longer than the period) until every reader
+ * (e.g., the event scheduler of each CPU) has read each of its groups once (see mark_read()), whatever the order of the scheduling policy.
+ * If no reader is marked, the fast rotation lasts `group_num` intervals, i.e., one round-robin rotation.
+ * With round-robin, one fast rotation takes about one normal interval. A phase change during the fast rotation restarts it.
+ */
+class FastRotationWindow {
+ public:
+  /**
+   * @brief Construct a new FastRotationWindow object
+   *
+   * @param timer The interval timer to be controlled
+   * @param group_num The number of event groups, no fast rotation with a single group
+   */
+  FastRotationWindow(IntervalTimer &timer, size_t group_num);
+
+  /**
+   * @brief Record the group read by a reader in this interval, called before update()
+   *
+   * @param reader The index of the reader, e.g., of the CPU
+   * @param group_idx The index of the group within the groups of the reader
+   * @param group_num The number of event groups of the reader
+   */
+  void mark_read(size_t reader, size_t group_idx, size_t group_num);
+
+  /**
+   * @brief Called once per interval, after the detection
+   *
+   * @param phase_changed Whether a phase change has been detected in this interval (on any CPU)
+   */
+  void update(bool phase_changed);
+
+  /**
+   * @brief Get the period from the next boundary on
+   */
+  uint64_t get_period() const { return timer_.get_period(); }
+
+  bool is_fast() const { return fast_; }
+
+ private:
+  IntervalTimer &timer_;
+  size_t group_num_;
+  uint64_t normal_period_;
+  uint64_t fast_period_;
+  bool fast_;
+  std::vector<std::vector<bool>> read_;  // [reader][group] read since the fast rotation started
+  size_t unread_num_;                    // The number of (reader, group) not read yet in the fast rotation
+  size_t fast_interval_num_;             // The number of intervals since the fast rotation (re)started
+};
@@ -2,9 +2,13 @@
 
 #include <linux/perf_event.h>  // for PERF_TYPE_* marcos
 
-#include "pmu_event.h"  // for struct PMUEvent
+#include "metric_engine.h"  // for CompiledMetric
+#include "pmu_event.h"      // for struct PMUEvent
 
 #include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
 #include <vector>
 
 /**
@@ -20,6 +24,26 @@ class PMUConfig {
    */
   PMUConfig();
 
+  /**
+   * @brief Construct a new PMUConfig object from the given events, e.g., of a PMU model (see make_pmu_config() in pmu_model.h)
+   *
+   * @param fixed_events
+   * @param event_groups
+   * @param metric_definitions
+   */
+  PMUConfig(std::vector<PMUEvent> fixed_events, std::vector<std::vector<PMUEvent>> event_groups, std::string metric_definitions);
+
+  /**
+   * @brief Replace the compiled-in events and event groups with the ones of a JSON event file, resolved against the events
+   * exported by the PMU drivers in sysfs (see load_event_file() in event_discovery.h). The embedded metric definitions
+   * are kept if the file has none.
+   *
+   * @param filename
+   * @return true Success
+   * @return false The file cannot be loaded, the config is unchanged
+   */
+  bool load_event_file(const std::string& filename);
+
   /**
    * @brief Check whether the fixed events and the event groups are empty
    * 
@@ -54,6 +78,29 @@ class PMUConfig {
    */
   const std::vector<PMUEvent>& get_event_group_by_idx(size_t idx) const;
 
+  /**
+   * @brief Get all distinct events: the fixed events first, then the schedulable events in the order of event groups.
+   * An event appearing in multiple event groups is listed once. The position in this vector is the event index used by metrics.
+   *
+   * @return std::vector<PMUEvent>
+   */
+  std::vector<PMUEvent> get_all_events() const;
+
+  /**
+   * @brief Get the index of an event in get_all_events() by name
+   *
+   * @param name The event name
+   * @return int The event index, or -1 if the event is not configured
+   */
+  int get_event_index(const std::string& name) const;
+
+  /**
+   * @brief Get the embedded metric definitions of the CPU, see metric_engine.h for the syntax
+   *
+   * @return const std::string&
+   */
+  const std::string& get_metric_definitions() const;
+
   /**
    * @brief Get the number of event groups
    * 
@@ -75,8 +122,38 @@ class PMUConfig {
    * The optimization will modified the original event groups. 
    * 
    * @param programmable_counter_num The number of the detected programmable counters
+   * @param conflicts The pairs of events that cannot be counted in the same group (see PMUProbe)
    */
-  void adaptive_grouping(size_t programmable_counters_num); 
+  void adaptive_grouping(size_t programmable_counters_num, const std::vector<std::pair<EventKey, EventKey>>& conflicts = {});
+
+  /**
+   * @brief Optimize event groups for a metric set: only the schedulable events referenced by the metrics are kept,
+   * and the operands of each metric are pinned into a common group where possible (see EventGroupingSolver).
+   * The metrics whose operands end up in different groups are reported.
+   *
+   * @param programmable_counter_num The number of the detected programmable counters
+   * @param metrics The metrics compiled against this PMU config (before the optimization)
+   * @param conflicts The pairs of events that cannot be counted in the same group (see PMUProbe)
+   */
+  void metric_aware_grouping(size_t programmable_counters_num, const std::vector<CompiledMetric>& metrics,
+                             const std::vector<std::pair<EventKey, EventKey>>& conflicts = {});
+
+  /**
+   * @brief Remove the given schedulable events (by type and encoding) from all event groups, e.g., the events a CPU does not implement.
+   * The groups left empty are removed.
+   *
+   * @param events
+   * @return std::vector<std::string> The names of the removed events
+   */
+  std::vector<std::string> remove_events(const std::vector<EventKey>& events);
+
+  /**
+   * @brief Append the event groups of another PMU config with the same fixed events, e.g., the groups of another core type.
+   * The appended groups keep their order after the existing ones.
+   *
+   * @param other
+   */
+  void append_event_groups(const PMUConfig& other);
 
  private:
   /**
@@ -91,4 +168,6 @@ class PMUConfig {
    * Each inner vector represents an event group, and its inner vector represent an event config in this event group.
    */
   std::vector<std::vector<PMUEvent>> event_groups_;
+
+  std::string metric_definitions_;
 };
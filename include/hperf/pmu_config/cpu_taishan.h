@@ -45,4 +45,8 @@ const std::vector<std::vector<PMUEvent>> event_groups = {
      {"dtlb_walk_percyc", "Total cycles, dtlb_walk", 0x8128},
      {"itlb_walk_percyc", "Total cycles, itlb_walk", 0x8129}}};
 
+
+// Metric definitions, embedded from metrics/default.metrics at build time
+#include "hperf/pmu_config/default_metrics.h"
+
 #endif  // CPU_ORYON_CONFIG_H
\ No newline at end of file
@@ -0,0 +1,95 @@
+// Generated by tools/pmu_events_gen.cpp, do not edit.
+//   pmu_events_gen --name cortex_x4 --counters 12 --fixed cpu_cycles,cnt_cycles,inst_retired --group inst_spec,ld_spec,st_spec,dp_spec,vfp_spec,ase_spec,br_immed_spec,br_indirect_spec,br_return_spec --group l1d_cache_refill,l1i_cache_refill,l2d_cache_refill,l3d_cache_refill,l1d_tlb_refill,l1i_tlb_refill,br_mis_pred_retired --group bus_access_rd,bus_access_wr,mem_access_rd,mem_access_rd_percyc,dtlb_walk,itlb_walk,dtlb_walk_percyc,itlb_walk_percyc --metrics metrics/default.metrics -o include/hperf/pmu_config/model_cortex_x4.h tools/pmu-events/arm64/cortex-x4.json
+// 12 programmable counters, 3 fixed events, 3 event groups
+
+#ifndef PMU_MODEL_CORTEX_X4_H
+#define PMU_MODEL_CORTEX_X4_H
+
+#include "hperf/pmu_model.h"
+
+struct PMUModelCortexX4 {
+  static constexpr std::string_view name = "cortex_x4";
+  static constexpr size_t counter_num = 12;
+
+  static constexpr std::array<ModelEvent, 27> events = {{
+      {"cpu_cycles", "Cycle", 0x11, 0x0},
+      {"cnt_cycles", "Constant frequency cycles", 0x4004, 0x0},
+      {"inst_retired", "Instruction architecturally executed", 0x8, 0x0},
+      {"inst_spec", "Operation speculatively executed", 0x1b, 0x0},
+      {"ld_spec", "Operation speculatively executed, load", 0x70, 0x0},
+      {"st_spec", "Operation speculatively executed, store", 0x71, 0x0},
+      {"dp_spec", "Operation speculatively executed, integer data processing", 0x73, 0x0},
+      {"vfp_spec", "Operation speculatively executed, scalar floating-point", 0x75, 0x0},
+      {"ase_spec", "Operation speculatively executed, Advanced SIMD", 0x74, 0x0},
+      {"br_immed_spec", "Branch Speculatively executed, immediate branch", 0x78, 0x0},
+      {"br_indirect_spec", "Branch Speculatively executed, indirect branch", 0x7a, 0x0},
+      {"br_return_spec", "Branch Speculatively executed, procedure return", 0x79, 0x0},
+      {"l1d_cache_refill", "Level 1 data cache refill", 0x3, 0x0},
+      {"l1i_cache_refill", "Level 1 instruction cache refill", 0x1, 0x0},
+      {"l2d_cache_refill", "Level 2 data cache refill", 0x17, 0x0},
+      {"l3d_cache_refill", "Attributable level 3 cache refill", 0x2a, 0x0},
+      {"l1d_tlb_refill", "Level 1 data TLB refill", 0x5, 0x0},
+      {"l1i_tlb_refill", "Level 1 instruction TLB refill", 0x2, 0x0},
+      {"br_mis_pred_retired", "Branch Instruction architecturally executed, mispredicted", 0x22, 0x0},
+      {"bus_access_rd", "Bus access, read", 0x60, 0x0},
+      {"bus_access_wr", "Bus access, write", 0x61, 0x0},
+      {"mem_access_rd", "Data memory access, read", 0x66, 0x0},
+      {"mem_access_rd_percyc", "Total cycles, mem_access_rd", 0x8121, 0x0},
+      {"dtlb_walk", "Data TLB access with at least one translation table walk", 0x34, 0x0},
+      {"itlb_walk", "Instruction TLB access with at least one translation table walk", 0x35, 0x0},
+      {"dtlb_walk_percyc", "Total cycles, dtlb_walk", 0x8128, 0x0},
+      {"itlb_walk_percyc", "Total cycles, itlb_walk", 0x8129, 0x0},
+  }};
+
+  static constexpr std::array<uint16_t, 3> fixed_events = {0, 1, 2};
+  static constexpr std::array<uint16_t, 24> group_events = {3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26};
+
+  // {first, size}
+  static constexpr std::array<ModelGroup, 3> groups = {{
+      {0, 9},
+      {9, 7},
+      {16, 8},
+  }};
+
+  static constexpr std::string_view metric_definitions = R"(# The default metrics of the CPU configurations (include/hperf/pmu_config/cpu_*.h, embedded at build time)
+# and of the Cortex-X4 model (embedded in include/hperf/pmu_config/model_cortex_x4.h by tools/pmu_events_gen.cpp)
+# Syntax: see include/hperf/metric_engine.h
+section Pipeline basic metrics
+CPI = cpu_cycles / inst_retired
+CPU utilization [%] = cnt_cycles * 1e9 / ($cnt_freq * $duration_ns)
+Average frequency [GHz] = cpu_cycles * $cnt_freq / (cnt_cycles * 1e9)
+
+section Breakdown based on instruction mix
+Load [%] = ld_spec / inst_spec
+Store [%] = st_spec / inst_spec
+Integer data processing [%] = dp_spec / inst_spec
+Floating point [%] = vfp_spec / inst_spec
+Advanced SIMD [%] = ase_spec / inst_spec
+Immediate branch [%] = br_immed_spec / inst_spec
+Indirect branch [%] = br_indirect_spec / inst_spec
+Return branch [%] = br_return_spec / inst_spec
+
+section Breakdown based on misses
+subsection Cache
+L1D cache MPKI = l1d_cache_refill * 1000 / inst_retired
+L1I cache MPKI = l1i_cache_refill * 1000 / inst_retired
+L2 cache MPKI = l2d_cache_refill * 1000 / inst_retired
+L3 cache MPKI = l3d_cache_refill * 1000 / inst_retired
+subsection TLB
+L1D TLB MPKI = l1d_tlb_refill * 1000 / inst_retired
+L1I TLB MPKI = l1i_tlb_refill * 1000 / inst_retired
+DTLB walk PKI = dtlb_walk * 1000 / inst_retired
+ITLB walk PKI = itlb_walk * 1000 / inst_retired
+subsection Branch predictor
+Branch MPKI = br_mis_pred_retired * 1000 / inst_retired
+
+section Memory access latency
+Memory read latency [cycles] = mem_access_rd_percyc / mem_access_rd
+DTLB walk latency [cycles] = dtlb_walk_percyc / dtlb_walk
+ITLB walk latency [cycles] = itlb_walk_percyc / itlb_walk
+)";
+};
+
+static_assert(pmu_model_is_valid<PMUModelCortexX4>(), "Invalid PMU model layout");
+
+#endif
@@ -1,10 +1,22 @@
 #pragma once
 
+#include <linux/perf_event.h>  // for PERF_TYPE_RAW
+
 #include <string>
 #include <cstdint>
+#include <utility>
 
 struct PMUEvent {
   std::string name;
   std::string description;
   uint64_t encoding;
+  uint64_t counter_mask = 0;    // Bit i is set if the event can be counted on programmable counter i, 0 for any counter
+  uint32_t type = PERF_TYPE_RAW;  // perf_event_attr.type, the dynamic type of a PMU in sysfs for the events of another PMU
 };
+
+// An event is identified by (perf_event_attr.type, encoding): the same encoding is another event on another PMU
+using EventKey = std::pair<uint32_t, uint64_t>;
+
+inline EventKey get_event_key(const PMUEvent &event) {
+  return {event.type, event.encoding};
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>        // for std::array
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint16_t, uint64_t
+#include <string>       // for std::string
+#include <string_view>  // for std::string_view
+#include <vector>       // for std::vector
+
+#include "pmu_config.h"  // for PMUConfig
+#include "pmu_event.h"   // for struct PMUEvent
+
+/**
+ * @brief An event of a PMU model, a constant expression without any allocation
+ */
+struct ModelEvent {
+  std::string_view name;
+  std::string_view description;
+  uint64_t encoding;
+  uint64_t counter_mask;  // See PMUEvent::counter_mask
+};
+
+/**
+ * @brief The precomputed layout of an event group of a PMU model
+ */
+struct ModelGroup {
+  uint16_t first;  // The position of its first event in Model::group_events
+  uint16_t size;   // The number of schedulable events
+};
+
+/**
+ * @brief Check the layout of a PMU model at compile time, e.g., `static_assert(pmu_model_is_valid<PMUModelCortexX4>())`.
+ *
+ * A model (generated by tools/pmu_events_gen.cpp from the Linux pmu-events JSON files) is a struct of constants:
+ *   name                The core name
+ *   counter_num         The number of programmable counters, including the ones taken by the fixed events
+ *   events              std::array<ModelEvent, N>, the distinct events
+ *   fixed_events        std::array<uint16_t, F>, indices into `events`
+ *   group_events        std::array<uint16_t, M>, indices into `events`, the schedulable events of all groups in order
+ *   groups              std::array<ModelGroup, G>, each a range of `group_events`
+ *   metric_definitions  std::string_view, see metric_engine.h
+ *
+ * @return true Every index is in range, and the groups are contiguous and fit in the counters
+ */
+template <class Model>
+constexpr bool pmu_model_is_valid() {
+  if (Model::fixed_events.size() == 0 || Model::groups.size() == 0) return false;
+  for (uint16_t idx : Model::fixed_events) {
+    if (idx >= Model::events.size()) return false;
+  }
+  for (uint16_t idx : Model::group_events) {
+    if (idx >= Model::events.size()) return false;
+  }
+  size_t next = 0;
+  for (const ModelGroup &group : Model::groups) {
+    if (group.first != next || group.size == 0 || Model::fixed_events.size() + group.size > Model::counter_num) return false;
+    next += group.size;
+  }
+  return next == Model::group_events.size();
+}
+
+/**
+ * @brief Build a PMUConfig of a PMU model. Only the owning strings and vectors of PMUConfig are allocated here,
+ * the model itself is constant data.
+ */
+template <class Model>
+PMUConfig make_pmu_config() {
+  static_assert(pmu_model_is_valid<Model>(), "Invalid PMU model layout");
+  auto to_pmu_event = [](uint16_t idx) {
+    const ModelEvent &event = Model::events[idx];
+    PMUEvent pmu_event{std::string(event.name), std::string(event.description), event.encoding};
+    pmu_event.counter_mask = event.counter_mask;
+    return pmu_event;
+  };
+
+  std::vector<PMUEvent> fixed_events;
+  fixed_events.reserve(Model::fixed_events.size());
+  for (uint16_t idx : Model::fixed_events) fixed_events.push_back(to_pmu_event(idx));
+
+  std::vector<std::vector<PMUEvent>> event_groups(Model::groups.size());
+  for (size_t i = 0; i < Model::groups.size(); ++i) {
+    event_groups[i].reserve(Model::groups[i].size);
+    for (size_t j = 0; j < Model::groups[i].size; ++j) {
+      event_groups[i].push_back(to_pmu_event(Model::group_events[Model::groups[i].first + j]));
+    }
+  }
+  return PMUConfig(std::move(fixed_events), std::move(event_groups), std::string(Model::metric_definitions));
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>  // for uint64_t
+#include <string>   // for std::string
+#include <utility>  // for std::pair
+#include <vector>   // for std::vector
+
+#include "pmu_config.h"  // for PMUConfig
+
+/**
+ * @brief The PMU capabilities of a CPU for the configured events
+ */
+struct CpuCapability {
+  int counter_num = -1;                                  // The number of programmable counters, -1 if undetected
+  std::vector<EventKey> unsupported_events;              // The configured events that cannot be opened
+  std::vector<std::pair<EventKey, EventKey>> conflicts;  // The pairs of configured events that cannot be counted in the same group
+};
+
+/**
+ * @brief Read the fingerprint of what the capabilities depend on: the MIDR_EL1 (Arm) or the vendor, family, model and stepping (x86) of each CPU,
+ * the kernel release, and the NMI watchdog state (the watchdog takes a counter)
+ *
+ * @return std::string
+ */
+std::string read_hardware_fingerprint();
+
+/**
+ * @brief Probe the PMU capabilities of each CPU for the configured events, cached in a database keyed by the hardware fingerprint.
+ *
+ * On each CPU (all CPUs concurrently, one thread per CPU):
+ * - the number of programmable counters, see CounterDetector::detect_on_cpu()
+ * - the configured schedulable events that can be opened, each on its own
+ * - the pairs of events that cannot be counted in the same group although they fit in the counters (e.g., events restricted to the same counter).
+ *   A set of events is counted as a group with the fixed events: if it is scheduled, none of its pairs conflict; otherwise it is split in halves,
+ *   and the halves and the pairs across them are tested in the same way. So only a few probes are needed when the conflicts are rare.
+ *
+ * The database has a file per fingerprint in the private cache directory (see get_cache_dir()). A cached entry is only used if its
+ * fingerprint is the same and it covers all the configured events, so another CPU, kernel or watchdog setting, or new events, lead
+ * to a new probe. A malformed entry (e.g., a truncated file) is ignored and probed again.
+ */
+class PMUProbe {
+ public:
+  /**
+   * @brief Construct a new PMUProbe object
+   *
+   * @param pmu_config The configured events to be probed
+   */
+  explicit PMUProbe(const PMUConfig &pmu_config);
+
+  /**
+   * @brief Load the cached capabilities of this machine, without probing
+   *
+   * @return true A matching entry covering all the configured events is found
+   * @return false Otherwise
+   */
+  bool load();
+
+  /**
+   * @brief Load the cached capabilities, or probe all CPUs and save the result to the database
+   */
+  void run();
+
+  /**
+   * @brief Whether the capabilities are loaded or probed
+   */
+  bool is_valid() const { return valid_; }
+
+  /**
+   * @brief Get the capabilities of a CPU, with an undetected counter number for an unknown CPU
+   *
+   * @param cpu_id
+   * @return const CpuCapability&
+   */
+  const CpuCapability &get_capability(int cpu_id) const;
+
+  /**
+   * @brief Get the events that cannot be opened on any of the CPUs
+   *
+   * @param cpu_ids
+   * @return std::vector<EventKey>
+   */
+  std::vector<EventKey> get_unsupported_events(const std::vector<int> &cpu_ids) const;
+
+  /**
+   * @brief Get the pairs of events that conflict on any of the CPUs
+   *
+   * @param cpu_ids
+   * @return std::vector<std::pair<EventKey, EventKey>>
+   */
+  std::vector<std::pair<EventKey, EventKey>> get_conflicts(const std::vector<int> &cpu_ids) const;
+
+  /**
+   * @brief Get all the CPUs
+   */
+  std::vector<int> get_cpu_ids() const;
+
+  void print_result() const;
+
+ private:
+  const PMUConfig &pmu_config_;
+  std::string fingerprint_;
+  std::vector<EventKey> events_;             // The distinct schedulable events
+  std::vector<CpuCapability> capabilities_;  // Indexed by cpu_id
+  bool valid_;
+
+  /**
+   * @brief The path of the database file of the fingerprint
+   */
+  std::string get_db_path() const;
+
+  bool save() const;
+
+  /**
+   * @brief Probe a CPU, called on a thread per CPU
+   */
+  CpuCapability probe_cpu(int cpu_id) const;
+
+  /**
+   * @brief Check if the events are scheduled when counted as a group with the fixed events on a CPU
+   */
+  bool test_group(int cpu_id, const std::vector<EventKey> &events) const;
+
+  /**
+   * @brief Find the conflicting pairs in `events`
+   */
+  void find_conflicts(int cpu_id, size_t capacity, const std::vector<EventKey> &events, CpuCapability &capability) const;
+
+  /**
+   * @brief Find the conflicting pairs with one event in `a` and the other in `b`
+   */
+  void find_cross_conflicts(int cpu_id, size_t capacity, const std::vector<EventKey> &a, const std::vector<EventKey> &b,
+                            CpuCapability &capability) const;
+};
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstdint>  // for uint64_t
 #include <fstream>  // for std::ofstream
 #include <string>   // for std::string
 #include <vector>   // for std::vector
 
+#include "cpu_topology.h"  // for TopologyLevel
+
 enum ProfileMode { SYSTEM_WIDE,
                    TRACK_PID,
                    SUBPROCESS };
@@ -19,7 +22,16 @@ struct ProfileConfig {
   int switch_group_interval = 1000;  // 'i': event group switching interval
   std::vector<int> cpu_id_list;      // 'c': CPU list
   pid_t target_pid = -1;             // 'p': target PID
+  std::vector<std::string> cgroups;  // 'G': for system-wide, count the tasks of each cgroup separately
   std::string output_filename = "";  // 'o': output file name
+  std::string output_format = "csv";  // 'format': raw data output format (csv, bin, cbin)
+  bool async_output = false;          // 'async-output': write the raw data on a separate writer thread
+  std::string event_filename = "";    // 'event-file': JSON file of the events and event groups, replacing the compiled-in ones
+  std::string metrics_filename = "";  // 'metrics': metric definition file, replacing the embedded metrics
+  std::string interval_metrics_filename = "";  // 'interval-metrics': CSV file of the metrics of every group rotation
+  std::vector<TopologyLevel> rollup_levels;    // 'rollup': also report per CPU / core / cluster / package
+  std::string estimator = "wallclock";         // 'estimator': how to extrapolate multiplexed counts (wallclock, kernel, ref:<fixed event>)
+  std::string schedule = "rr";                 // 'schedule': event group scheduling policy (rr, weights:w1,w2,..., variance)
 
   std::ofstream *output_file_ptr = nullptr;  // file stream for the output file
 
@@ -28,4 +40,20 @@ struct ProfileConfig {
   bool detect_counters = false;  // 'detect-counters': detect the number of programmable counters
 
   bool optimize_event_groups = false;  // 'optimize-event-groups': detect the number of programmable counters, and use the result to optimize the default event groups
+
+  bool metric_aware_grouping = false;  // 'metric-aware-grouping': like 'optimize-event-groups', but only keep the events used by the metrics and co-schedule the operands of each metric
+
+  bool per_cpu_threads = false;  // 'per-cpu-threads': for system-wide, collect on each CPU by a thread pinned to it
+
+  bool delta_counting = false;  // 'delta-counting': never reset the counters when switching event groups, take the difference of cumulative counts instead
+
+  bool per_thread = false;  // 'per-thread': for per-process, measure each thread of the process on its own, and report the threads
+
+  bool follow_children = false;  // 'follow-children': for per-process, also count the child tasks created during the measurement
+
+  std::string sample_event = "";  // 'sample': the event sampling on overflow, for the hot spots of the measured code
+  uint64_t sample_period = 0;     // 'sample': the number of counts between two samples
+  bool call_graph = false;        // 'call-graph': record the callchain of each sample
+
+  bool phase_detect = false;  // 'phase-detect': detect phase changes from the fixed events, and shorten the interval for a fast rotation of all groups
 };
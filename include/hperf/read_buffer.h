@@ -68,6 +68,47 @@ class GroupReadBuffer {
     return base[idx];
   }
 
+  /**
+   * @brief Add the times and the event counts of another buffer of the same event group, e.g., of a child task.
+   *
+   * @param other
+   */
+  void add(const GroupReadBuffer& other) {
+    Header* h = mutable_header();
+    h->time_enabled += other.time_enabled();
+    h->time_running += other.time_running();
+
+    const Entry* other_base = reinterpret_cast<const Entry*>(other.buf_.data() + header_size());
+    Entry* base = reinterpret_cast<Entry*>(buf_.data() + header_size());
+    for (size_t i = 0; i < h->nr && i < other.nr(); ++i) {
+      base[i].value += other_base[i].value;
+    }
+  }
+
+  /**
+   * @brief Store the difference `cur - prev` into this buffer.
+   * time_enabled and time_running are always subtracted, while the event counts are only subtracted if `count_delta` is true (otherwise copied from `cur`).
+   * All three buffers must belong to the same event group (i.e., have the same size).
+   *
+   * @param cur The buffer holding the latest cumulative values
+   * @param prev The buffer holding the cumulative values of the previous read
+   * @param count_delta Whether the event counts are cumulative and should be subtracted
+   */
+  void assign_delta(const GroupReadBuffer& cur, const GroupReadBuffer& prev, bool count_delta) {
+    Header* h = mutable_header();
+    h->nr = cur.nr();
+    h->time_enabled = cur.time_enabled() - prev.time_enabled();
+    h->time_running = cur.time_running() - prev.time_running();
+
+    const Entry* cur_base = reinterpret_cast<const Entry*>(cur.buf_.data() + header_size());
+    const Entry* prev_base = reinterpret_cast<const Entry*>(prev.buf_.data() + header_size());
+    Entry* base = reinterpret_cast<Entry*>(buf_.data() + header_size());
+    for (size_t i = 0; i < h->nr; ++i) {
+      base[i].value = count_delta ? cur_base[i].value - prev_base[i].value : cur_base[i].value;
+      base[i].id = cur_base[i].id;
+    }
+  }
+
  private:
   /**
    * @brief The buffer to store the data read from perf_event_open fd
@@ -87,6 +128,10 @@ class GroupReadBuffer {
   const Header* header() const {
     return reinterpret_cast<const Header*>(buf_.data());
   }
+
+  Header* mutable_header() {
+    return reinterpret_cast<Header*>(buf_.data());
+  }
 };
 
 class SingleReadBuffer {
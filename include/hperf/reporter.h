@@ -3,9 +3,13 @@
 #include <csignal>
 #include <cstddef>
 #include <cstdint>
+#include <map>
 #include <string>
 #include <vector>
 
+#include "core_type_layouts.h"
+#include "cpu_topology.h"
+#include "metric_engine.h"
 #include "pmu_config.h"
 
 /**
@@ -13,10 +17,47 @@
  */
 struct Record {
   uint64_t timestamp;
-  int cpu_id;  // -1 for per-process mode
-  int group_id;
+  int cpu_id;  // -1 for per-process mode, the TID for per-thread mode
+  int group_id;  // PHASE_BOUNDARY_GROUP_ID for a phase boundary marker (event_id 0, value = the interval in ns from then on)
   uint64_t event_id;
   uint64_t value;
+  uint64_t time_enabled;  // time_enabled of the group in this interval
+  uint64_t time_running;  // time_running of the group in this interval
+};
+
+// The group ID of the marker record written when a phase change is detected (`--phase-detect`)
+#define PHASE_BOUNDARY_GROUP_ID -1
+
+/**
+ * @brief Read the frequency of the constant counter (CNTFRQ_EL0) in Hz, 0 on architectures other than AArch64
+ */
+uint64_t read_cntfrq_el0(void);
+
+/**
+ * @brief Streaming mean and variance (Welford's algorithm), mergeable (Chan et al.)
+ */
+struct RunningStats {
+  uint64_t n = 0;
+  double mean = 0.0;
+  double m2 = 0.0;  // The sum of squared differences from the mean
+
+  void push(double x) {
+    ++n;
+    double delta = x - mean;
+    mean += delta / n;
+    m2 += delta * (x - mean);
+  }
+
+  void merge(const RunningStats &other) {
+    if (other.n == 0) return;
+    uint64_t total = n + other.n;
+    double delta = other.mean - mean;
+    mean += delta * other.n / total;
+    m2 += other.m2 + delta * delta * n * other.n / total;
+    n = total;
+  }
+
+  double variance() const { return n > 1 ? m2 / (n - 1) : 0.0; }
 };
 
 /**
@@ -25,53 +66,197 @@ struct Record {
 struct EventStats {
   uint64_t total_value;
   uint64_t estimated_value;
+  double scaled_value;  // The sum of value * time_enabled / time_running over the intervals
 
-  EventStats() : total_value(0), estimated_value(0) {}
+  RunningStats rate;     // The rate (count / time_running) of each interval in which the group ran
+  double coverage;       // The share of the measurement in which the event was counted, [0, 1]
+  double ci_half_width;  // The half-width of the 95% confidence interval of estimated_value, negative if unknown
+
+  EventStats() : total_value(0), estimated_value(0), scaled_value(0.0), coverage(0.0), ci_half_width(0.0) {}
 };
 
+/**
+ * @brief How the count of an event is extrapolated from the time its group was scheduled
+ */
+enum class EstimatorType { WALL_CLOCK,        // scale by the residency of each group derived from Record::timestamp
+                           KERNEL_TIME,       // scale by time_enabled / time_running reported by the kernel, per CPU and per interval
+                           REFERENCE_EVENT };  // scale by the share of a fixed event (e.g., inst_retired) counted while the group was scheduled
+
+class IntervalMetricWriter;
+
 /**
  * @brief Class for processing raw count and aggregate
  */
 class Reporter {
  public:
+  /**
+   * @brief Construct a new Reporter object, and compile the metric definitions embedded in the PMU config
+   *
+   * @param pmu_config
+   */
   Reporter(const PMUConfig &pmu_config);
   ~Reporter();
   void process_a_record(const Record &record);
-  void print_a_record(const Record &record, std::ostream &out);
   void estimation();
   void print_stats();
   void print_metrics();
 
+  /**
+   * @brief Replace the embedded metric definitions by the ones loaded from a file
+   *
+   * @param filename The metric definition file
+   * @return true On success
+   * @return false Failed to open or compile the file, the embedded metrics are kept
+   */
+  bool load_metrics(const std::string &filename);
+
+  const MetricEngine &get_metric_engine() const { return metric_engine_; }
+
+  /**
+   * @brief Also feed every processed record to the time series of metrics
+   *
+   * @param interval_metric_writer The writer, or nullptr to disable
+   */
+  void set_interval_metric_writer(IntervalMetricWriter *interval_metric_writer) { interval_metric_writer_ = interval_metric_writer; }
+
+  /**
+   * @brief Set the core types of the measured CPUs, the PMU config of the Reporter must be their merged config.
+   * With several core types, each CPU only counts the groups of its core type, so the overall counts are the sum of the per-CPU estimates
+   * and the groups are listed by core type.
+   *
+   * @param core_type_layouts The core types, or nullptr for the same groups on all CPUs
+   */
+  void set_core_type_layouts(const CoreTypeLayouts *core_type_layouts) { core_type_layouts_ = core_type_layouts; }
+
+  /**
+   * @brief Print the estimated counts and the metrics of each CPU, or rolled up by core, cluster or package.
+   * Only CPUs with records (i.e., system-wide measurement) are reported, call after estimation().
+   *
+   * @param level The roll-up level
+   */
+  void print_rollup(TopologyLevel level);
+
+  /**
+   * @brief Per-thread measurement: the cpu_id of the records is the TID of a thread, and each thread is estimated on its own.
+   * The threads rotate their groups independently, so the counts of the process are the sum of the per-thread estimates.
+   *
+   * @param thread_names The name of each TID, filled during the measurement and read by print_threads(), or nullptr
+   */
+  void set_thread_names(const std::map<int, std::string> *thread_names) { thread_names_ = thread_names; }
+
+  /**
+   * @brief Per-thread measurement: the number of threads not measured (see ThreadMonitor::get_unmeasured_thread_num()).
+   * If any, print_stats() marks the counts and metrics of the process as partial, as they only sum the measured threads.
+   *
+   * @param num
+   */
+  void set_unmeasured_thread_num(size_t num) { unmeasured_thread_num_ = num; }
+
+  /**
+   * @brief Print the estimated counts and the metrics of each thread, the busiest (by the first fixed event) first.
+   * Only for per-thread measurement, call after estimation().
+   */
+  void print_threads();
+
+  /**
+   * @brief Print the metrics of the whole measurement of several reporters side by side, e.g., of the cgroups of a measurement
+   * (`-G`). The reporters must share the metric definitions, call after their estimation().
+   *
+   * @param labels The column title of each reporter
+   * @param reporters
+   */
+  static void print_metric_comparison(const std::vector<std::string> &labels, const std::vector<const Reporter *> &reporters);
+
+  /**
+   * @brief Select how the multiplexed counts are extrapolated
+   *
+   * @param estimator
+   * @param reference_event For REFERENCE_EVENT, the name of a fixed event
+   * @return true On success
+   * @return false The reference event is not a fixed event
+   */
+  bool set_estimator(EstimatorType estimator, const std::string &reference_event = "");
+
  private:
   const PMUConfig &pmu_config_;
 
-  std::vector<std::vector<EventStats>> stat_;
-  std::vector<uint64_t> enabled_time_in_ns_;
-  uint64_t total_time_in_ns_;
+  int fixed_event_num_;
 
-  uint64_t prev_timestamp_;
+  std::vector<std::vector<size_t>> event_slots_;  // [group_id][event_id] -> the event index of PMUConfig::get_all_events()
 
-  int fixed_event_num_;
+  MetricEngine metric_engine_;
 
-  EventStats get_event_stat_by_name(std::string name, size_t group_id);
+  IntervalMetricWriter *interval_metric_writer_;
 
-  EventStats get_schedulable_event_stat_by_name(std::string name, size_t &group_id);
+  const CoreTypeLayouts *core_type_layouts_;
 
-  EventStats get_fixed_event_stat_by_name(std::string name, size_t group_id);
+  const std::map<int, std::string> *thread_names_;
+  size_t unmeasured_thread_num_;
 
-  void print_event_count_(uint64_t c, std::string event_name);
+  EstimatorType estimator_;
+  size_t reference_event_id_;  // The position of the reference event in the fixed events
 
-  std::string format_with_commas_(uint64_t value);
+  std::vector<uint64_t> phase_boundaries_;  // The timestamps of the phase boundary markers, the markers of several CPUs at the same timestamp count once
+
+  /**
+   * @brief The statistics of all CPUs or a single CPU
+   */
+  struct StatTable {
+    std::vector<std::vector<EventStats>> stat;  // [group_id][event_id]
+    std::vector<uint64_t> enabled_time_in_ns;   // The wall-clock residency of each group
+    uint64_t total_time_in_ns = 0;              // The wall-clock time
+    uint64_t prev_timestamp = 0;
+    std::vector<uint64_t> kernel_time_in_ns;  // The sum of time_enabled of each group (intervals with time_running > 0)
+    std::vector<double> event_values;         // The estimated value of each event, indexed by the event index
+    std::vector<double> event_ci_half_widths;  // The half-width of the 95% confidence interval of each event value, negative if unknown
+    std::vector<double> event_coverages;       // The share of the measurement in which each event was counted
+  };
+
+  StatTable overall_;
+  std::vector<StatTable> cpu_stats_;  // Indexed by cpu_id, `stat` is empty for the CPUs without records
+  std::map<int, StatTable> thread_stats_;  // Per-thread measurement, by TID
+  uint64_t interval_start_timestamp_;     // The timestamp of the previous interval, where a thread first seen in this one starts
+
+  void init_stats_(StatTable &table);
 
-  void print_percentage_(uint64_t a, uint64_t b, std::string metric_name);
+  bool has_core_types_() const { return core_type_layouts_ && core_type_layouts_->get_core_types().size() > 1; }
 
-  void print_decimal_(uint64_t a, uint64_t b, std::string metric_name);
+  void account_record_(StatTable &table, const Record &record);
 
-  void print_cycles_(uint64_t a, uint64_t b, std::string metric_name);
+  void estimate_(StatTable &table);
 
-  void print_GHz_(uint64_t a, uint64_t b, std::string metric_name);
+  uint64_t get_kernel_covered_time_(const StatTable &table) const;
 
-  void print_metrics_oryon_();
+  void print_uncovered_time_();
+
+  /**
+   * @brief Whether a CPU counts a group, i.e., the group belongs to the core type of the CPU
+   */
+  bool counts_group_(int cpu_id, size_t group_id) const;
+
+  /**
+   * @brief Sum the estimates of several CPUs or threads, call after their estimate_()
+   *
+   * @param unit_ids The CPU (or the TID) of each table
+   * @param tables
+   * @param sum
+   */
+  void sum_stat_tables_(const std::vector<int> &unit_ids, const std::vector<const StatTable *> &tables, StatTable &sum);
+
+  std::vector<const StatTable *> get_cpu_stat_tables_(const std::vector<int> &cpu_ids) const;
+
+  /**
+   * @brief Print all the events and the metrics of a CPU, a roll-up unit or a thread
+   */
+  void print_stat_table_(const StatTable &table, uint64_t duration_in_ns);
+
+  void print_metric_list_(const StatTable &table, uint64_t duration_in_ns);
+
+  void print_event_count_(uint64_t c, std::string event_name);
+
+  void print_event_count_(uint64_t c, std::string event_name, double ci_half_width, double coverage, uint64_t interval_num);
+
+  std::string format_with_commas_(uint64_t value);
 
-  void print_metrics_cortex_x4_();
+  void print_metric_(const CompiledMetric &metric, double value, double ci_half_width);
 };
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <linux/perf_event.h>  // for struct perf_event_mmap_page, struct perf_event_header
+#include <sys/mman.h>          // for mmap, munmap
+#include <unistd.h>            // for sysconf
+
+#include <cerrno>    // for errno
+#include <cstddef>   // for size_t
+#include <cstdint>   // for uint8_t, uint64_t
+#include <cstring>   // for strerror, memcpy
+#include <iostream>  // for std::cerr
+#include <vector>    // for std::vector
+
+/**
+ * @brief The mmap'ed ring buffer of a perf event: a metadata page followed by 2^n data pages, written by the kernel at data_head
+ * and given back by the reader at data_tail. It does not own the fd of the event.
+ *
+ * The records are visited in place, only a record that wraps around the end of the data pages is copied out.
+ */
+class PerfRingBuffer {
+ public:
+  PerfRingBuffer() : fd_(-1), base_(nullptr), size_(0), page_size_(sysconf(_SC_PAGESIZE)) {}
+
+  ~PerfRingBuffer() { unmap(); }
+
+  PerfRingBuffer(PerfRingBuffer &&other) noexcept
+      : fd_(other.fd_), base_(other.base_), size_(other.size_), page_size_(other.page_size_), scratch_(std::move(other.scratch_)) {
+    other.fd_ = -1;
+    other.base_ = nullptr;
+    other.size_ = 0;
+  }
+
+  PerfRingBuffer &operator=(PerfRingBuffer &&other) noexcept {
+    if (this != &other) {
+      unmap();
+      fd_ = other.fd_;
+      base_ = other.base_;
+      size_ = other.size_;
+      page_size_ = other.page_size_;
+      scratch_ = std::move(other.scratch_);
+      other.fd_ = -1;
+      other.base_ = nullptr;
+      other.size_ = 0;
+    }
+    return *this;
+  }
+
+  PerfRingBuffer(const PerfRingBuffer &) = delete;
+  PerfRingBuffer &operator=(const PerfRingBuffer &) = delete;
+
+  /**
+   * @brief Map the ring buffer of an event
+   *
+   * @param fd
+   * @param data_pages The number of data pages, a power of 2
+   * @return true On success
+   * @return false On failure (the error is printed)
+   */
+  bool map(int fd, size_t data_pages) {
+    unmap();
+    size_t size = (1 + data_pages) * page_size_;
+    void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+      std::cerr << "Failed to map the ring buffer of FD " << fd << ": " << strerror(errno) << std::endl;
+      return false;
+    }
+    fd_ = fd;
+    base_ = base;
+    size_ = size;
+    return true;
+  }
+
+  void unmap() {
+    if (base_) munmap(base_, size_);
+    fd_ = -1;
+    base_ = nullptr;
+    size_ = 0;
+  }
+
+  bool is_mapped() const { return base_ != nullptr; }
+
+  /**
+   * @brief The fd of the mapped event, e.g., the target of PERF_EVENT_IOC_SET_OUTPUT for the other events on the same CPU
+   */
+  int get_fd() const { return fd_; }
+
+  /**
+   * @brief Visit all the complete records, then give their space back to the kernel
+   *
+   * @tparam Visitor void(const struct perf_event_header *record), the record is only valid during the call
+   * @param visitor
+   * @return size_t The number of records
+   */
+  template <typename Visitor>
+  size_t drain(Visitor visitor) {
+    if (!base_) return 0;
+    auto *metadata = static_cast<struct perf_event_mmap_page *>(base_);
+    const uint8_t *data = static_cast<const uint8_t *>(base_) + page_size_;
+    const uint64_t data_size = size_ - page_size_;
+
+    // The kernel writes at data_head, the records before it are complete once it is read (acquire)
+    uint64_t head = __atomic_load_n(&metadata->data_head, __ATOMIC_ACQUIRE);
+    uint64_t tail = metadata->data_tail;
+    size_t record_num = 0;
+    while (tail + sizeof(struct perf_event_header) <= head) {
+      const uint64_t offset = tail % data_size;
+      struct perf_event_header header;
+      copy_out(data, data_size, offset, sizeof(header), reinterpret_cast<uint8_t *>(&header));
+      if (header.size < sizeof(header) || tail + header.size > head) break;
+
+      if (offset + header.size <= data_size) {
+        visitor(reinterpret_cast<const struct perf_event_header *>(data + offset));
+      } else {
+        // A record wrapping around the end of the data pages
+        scratch_.resize(header.size);
+        copy_out(data, data_size, offset, header.size, scratch_.data());
+        visitor(reinterpret_cast<const struct perf_event_header *>(scratch_.data()));
+      }
+      tail += header.size;
+      ++record_num;
+    }
+    __atomic_store_n(&metadata->data_tail, tail, __ATOMIC_RELEASE);  // Give the space back to the kernel
+    return record_num;
+  }
+
+ private:
+  int fd_;
+  void *base_;
+  size_t size_;
+  size_t page_size_;
+  std::vector<uint8_t> scratch_;  // 8-byte aligned storage for a wrapped record
+
+  static void copy_out(const uint8_t *data, uint64_t data_size, uint64_t offset, size_t len, uint8_t *out) {
+    size_t first = (offset + len <= data_size) ? len : data_size - offset;
+    memcpy(out, data + offset, first);
+    memcpy(out + first, data, len - first);
+  }
+};
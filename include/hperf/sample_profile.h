@@ -0,0 +1,73 @@
+#pragma once
+
+#include <linux/perf_event.h>  // for struct perf_event_header
+#include <sys/types.h>         // for pid_t
+
+#include <cstdint>  // for uint64_t
+#include <map>      // for std::map
+#include <string>   // for std::string
+#include <utility>  // for std::pair
+
+#include "symbol_index.h"  // for SymbolResolver, CodeLocation
+
+/**
+ * @brief The hot spots of an overflow sampling measurement (`--sample`): the records drained from the sample ring buffers of the
+ * event schedulers (see EventScheduler::set_sampling()) are attributed to functions, counting the samples of each function (self),
+ * and with callchains, the samples with the function anywhere on the stack (total).
+ */
+class SampleProfile {
+ public:
+  /**
+   * @brief Construct a new SampleProfile object
+   *
+   * @param event_name The sampled event
+   * @param period
+   * @param callchain The samples carry callchains (PERF_SAMPLE_CALLCHAIN)
+   */
+  SampleProfile(const std::string &event_name, uint64_t period, bool callchain);
+
+  /**
+   * @brief Read the mappings of a process now, so that its samples are resolved even if it exits before they are drained
+   *
+   * @param pid
+   */
+  void add_process(pid_t pid);
+
+  /**
+   * @brief Take a record of a sample ring buffer: PERF_RECORD_SAMPLE, PERF_RECORD_MMAP, PERF_RECORD_LOST or PERF_RECORD_THROTTLE
+   *
+   * @param record
+   */
+  void add_record(const struct perf_event_header *record);
+
+  /**
+   * @brief Print the number of samples and lost records, and the functions with the most samples
+   */
+  void print() const;
+
+  uint64_t get_sample_num() const { return sample_num_; }
+
+  /**
+   * @brief The number of samples lost because a ring buffer was full when the kernel wrote them
+   */
+  uint64_t get_lost_sample_num() const { return lost_sample_num_; }
+
+ private:
+  using Key = std::pair<const std::string *, const std::string *>;  // The binary and the symbol (nullptr if unknown)
+
+  struct Count {
+    uint64_t self;
+    uint64_t total;
+  };
+
+  std::string event_name_;
+  uint64_t period_;
+  bool callchain_;
+  SymbolResolver resolver_;
+  std::map<Key, Count> counts_;
+  uint64_t sample_num_;
+  uint64_t lost_sample_num_;
+  uint64_t throttle_num_;
+
+  void add_sample(const struct perf_event_header *record);
+};
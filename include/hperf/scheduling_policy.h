@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+#include <memory>   // for std::unique_ptr
+#include <string>   // for std::string
+#include <vector>   // for std::vector
+
+#include "pmu_config.h"   // for PMUConfig
+#include "read_buffer.h"  // for GroupReadBuffer
+
+/**
+ * @brief Decide which event group is counted in the next interval (`--schedule`).
+ *
+ * Each EventScheduler owns its own policy instance, so a policy only sees the groups of one CPU (or one process).
+ * The estimation of the Reporter scales every group by its own enabled time, so any residency is accounted correctly
+ * as long as every group is counted at least once.
+ */
+class SchedulingPolicy {
+ public:
+  virtual ~SchedulingPolicy() = default;
+
+  /**
+   * @brief Called after each read of a group with the values of the last interval
+   *
+   * @param group_idx The event group that was read
+   * @param buffer The delta read buffer of the group (see EventScheduler::get_active_group_read_buffer())
+   */
+  virtual void observe(size_t group_idx, const GroupReadBuffer &buffer) {}
+
+  /**
+   * @brief Select the group to be counted in the next interval
+   *
+   * @param current_group The group that has just been counted
+   * @return size_t The next group, in [0, group_num)
+   */
+  virtual size_t next_group(size_t current_group) = 0;
+};
+
+/**
+ * @brief Every group in turn, with the same residency (the default)
+ */
+class RoundRobinPolicy : public SchedulingPolicy {
+ public:
+  explicit RoundRobinPolicy(size_t group_num);
+
+  size_t next_group(size_t current_group) override;
+
+ private:
+  size_t group_num_;
+};
+
+/**
+ * @brief Residency proportional to user-given weights (`--schedule=weights:w1,w2,...`).
+ *
+ * It uses the smooth weighted round-robin: the selections of a group are spread over the cycle instead of being consecutive,
+ * e.g., weights 2,1,1 give the sequence 0 1 2 0 0 1 2 0 ...
+ */
+class StaticWeightPolicy : public SchedulingPolicy {
+ public:
+  explicit StaticWeightPolicy(const std::vector<unsigned> &weights);
+
+  size_t next_group(size_t current_group) override;
+
+ private:
+  std::vector<unsigned> weights_;
+  std::vector<int64_t> current_weights_;
+  int64_t total_weight_;
+};
+
+/**
+ * @brief Give more time to the groups with the highest estimation error so far (`--schedule=variance`).
+ *
+ * For each schedulable event, the rate (count / time_running) of every interval is accumulated (Welford).
+ * The relative variance of the estimated count of an event after n intervals is cv^2 / n, with cv the coefficient of variation of the rate,
+ * so counting its group once more reduces it by cv^2 / (n * (n + 1)). The group with the largest reduction (the maximum over its events) is selected,
+ * which greedily minimizes the sum of the relative variances for the same total time.
+ *
+ * To keep the estimates unbiased when the workload changes, all groups are first counted `warmup_rounds` times in turn,
+ * and a group that has not been counted for `max_age` intervals is selected regardless of its error.
+ */
+class VarianceDrivenPolicy : public SchedulingPolicy {
+ public:
+  /**
+   * @brief Construct a new VarianceDrivenPolicy object
+   *
+   * @param pmu_config The event groups
+   * @param warmup_rounds The number of round-robin rotations before the selection is driven by the variance
+   * @param max_age A group is counted at least once every `max_age` intervals, 0 for group_num * 4
+   */
+  explicit VarianceDrivenPolicy(const PMUConfig &pmu_config, size_t warmup_rounds = 2, size_t max_age = 0);
+
+  void observe(size_t group_idx, const GroupReadBuffer &buffer) override;
+  size_t next_group(size_t current_group) override;
+
+ private:
+  struct RateStats {
+    uint64_t n;
+    double mean;
+    double m2;
+  };
+
+  size_t group_num_;
+  size_t fixed_event_num_;
+  size_t warmup_intervals_;  // warmup_rounds * group_num
+  size_t max_age_;
+
+  uint64_t interval_count_;                 // The number of intervals scheduled so far
+  std::vector<uint64_t> last_counted_;      // The interval when each group was last counted
+  std::vector<std::vector<RateStats>> stats_;  // [group][schedulable event]
+
+  /**
+   * @brief The reduction of the relative variance by counting the group once more, the maximum over its events
+   */
+  double variance_reduction(size_t group_idx) const;
+};
+
+/**
+ * @brief Create the scheduling policy from the `--schedule` option
+ *
+ * @param spec "rr", "weights:w1,w2,..." (one positive weight per event group) or "variance"
+ * @param pmu_config The event groups
+ * @return std::unique_ptr<SchedulingPolicy> nullptr with an error message if the spec is invalid for the event groups
+ */
+std::unique_ptr<SchedulingPolicy> create_scheduling_policy(const std::string &spec, const PMUConfig &pmu_config);
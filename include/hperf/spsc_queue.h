@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>   // for std::atomic
+#include <cstddef>  // for size_t
+#include <vector>   // for std::vector
+
+/**
+ * @brief Bounded lock-free single-producer single-consumer queue.
+ *
+ * Exactly one thread may call try_push() and exactly one (other) thread may call try_pop().
+ * The capacity is rounded up to a power of two so that the ring index can be computed by masking.
+ *
+ * @tparam T Element type, should be trivially copyable (e.g., struct Record)
+ */
+template <typename T>
+class SPSCQueue {
+ public:
+  /**
+   * @brief Construct a new SPSCQueue object
+   *
+   * @param capacity The minimum number of elements the queue can hold
+   */
+  explicit SPSCQueue(size_t capacity)
+      : buf_(round_up_pow2(capacity)),
+        mask_(buf_.size() - 1),
+        head_(0),
+        tail_(0) {}
+
+  // The atomics can not be moved or copied
+  SPSCQueue(const SPSCQueue &) = delete;
+  SPSCQueue &operator=(const SPSCQueue &) = delete;
+
+  /**
+   * @brief Push an element into the queue (producer side)
+   *
+   * @param item The element to be pushed
+   * @return true On success
+   * @return false The queue is full
+   */
+  bool try_push(const T &item) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == buf_.size()) {
+      return false;
+    }
+    buf_[tail & mask_] = item;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Pop an element from the queue (consumer side)
+   *
+   * @param[out] item The popped element
+   * @return true On success
+   * @return false The queue is empty
+   */
+  bool try_pop(T &item) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = buf_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Check whether the queue is empty. Only reliable on the consumer side.
+   */
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+  size_t capacity() const { return buf_.size(); }
+
+ private:
+  std::vector<T> buf_;
+  const size_t mask_;
+
+  // Keep the producer index and the consumer index in different cache lines to avoid false sharing
+  alignas(64) std::atomic<size_t> head_;  // Next slot to be read, written by the consumer
+  alignas(64) std::atomic<size_t> tail_;  // Next slot to be written, written by the producer
+
+  static size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+  }
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <sys/types.h>  // for pid_t
+
+#include <cstdint>  // for uint64_t
+#include <map>      // for std::map
+#include <memory>   // for std::unique_ptr
+#include <set>      // for std::set
+#include <string>   // for std::string
+#include <vector>   // for std::vector
+
+/**
+ * @brief A function symbol, `address` is the virtual address in the ELF file (or in the kernel)
+ */
+struct Symbol {
+  uint64_t address;
+  uint64_t size;
+  std::string name;
+};
+
+/**
+ * @brief The function symbols of an ELF file (.symtab and .dynsym) sorted by address, and its loadable segments which map the
+ * file offsets of the mapped pages to the virtual addresses of the symbols.
+ *
+ * Parsing and demangling the symbols of a large binary takes a while, so the result is cached in the private cache directory
+ * (see get_cache_dir()), keyed by the path, the size and the modification time of the file.
+ */
+class SymbolTable {
+ public:
+  /**
+   * @brief Load the symbols of an ELF file, from the cache if the file has not changed
+   *
+   * @param path
+   * @return true On success
+   * @return false Not a readable 64-bit ELF file
+   */
+  bool load_elf(const std::string &path);
+
+  /**
+   * @brief Load the kernel symbols from /proc/kallsyms
+   *
+   * @param path
+   * @return false Not readable, or the addresses are hidden (kptr_restrict)
+   */
+  bool load_kallsyms(const std::string &path = "/proc/kallsyms");
+
+  /**
+   * @brief Find the symbol containing an address, a symbol without size ends at the next one
+   *
+   * @param address
+   * @return const Symbol* nullptr if not found
+   */
+  const Symbol *find(uint64_t address) const;
+
+  /**
+   * @brief Find the symbol at an offset of the ELF file, e.g., of an address in a file-backed mapping
+   *
+   * @param offset
+   * @return const Symbol* nullptr if not found
+   */
+  const Symbol *find_by_file_offset(uint64_t offset) const;
+
+  size_t get_symbol_num() const { return symbols_.size(); }
+
+ private:
+  struct Segment {
+    uint64_t offset;   // p_offset
+    uint64_t address;  // p_vaddr
+    uint64_t size;     // p_filesz
+  };
+
+  std::vector<Segment> segments_;
+  std::vector<Symbol> symbols_;
+
+  bool parse_elf(const std::string &path);
+  bool load_cache(const std::string &path, const std::string &key);
+  void save_cache(const std::string &path, const std::string &key) const;
+
+  /**
+   * @brief Sort the symbols, drop the duplicates of an address (the .symtab entry is kept), and give each symbol without size
+   * the space up to the next one
+   */
+  void finalize();
+};
+
+/**
+ * @brief Where a sampled IP is: the function symbol, if known, and the binary (or "[kernel]", "[anon]", ...)
+ * The strings are owned by the SymbolResolver and live as long as it.
+ */
+struct CodeLocation {
+  const std::string *symbol;  // nullptr if unknown
+  const std::string *binary;
+};
+
+/**
+ * @brief Attribute the IPs of the samples to functions. The executable mappings of a process are read from /proc/<pid>/maps
+ * when the process is first seen, and updated by the PERF_RECORD_MMAP records of the sampled events (see add_mapping()).
+ * The symbols of each binary are loaded once (see SymbolTable), the kernel ones from /proc/kallsyms when it is readable.
+ */
+class SymbolResolver {
+ public:
+  SymbolResolver();
+
+  SymbolResolver(const SymbolResolver &) = delete;
+  SymbolResolver &operator=(const SymbolResolver &) = delete;
+
+  /**
+   * @brief Read the executable mappings of a process from /proc/<pid>/maps, if not known yet
+   */
+  void add_process(pid_t pid) { get_mappings(pid); }
+
+  /**
+   * @brief Add an executable mapping of a process, replacing the overlapped ones (e.g., after exec)
+   */
+  void add_mapping(pid_t pid, uint64_t start, uint64_t length, uint64_t file_offset, const std::string &path);
+
+  /**
+   * @brief Resolve an IP of a process
+   *
+   * @param pid
+   * @param ip
+   * @param kernel The IP is in the kernel
+   * @return CodeLocation
+   */
+  CodeLocation resolve(pid_t pid, uint64_t ip, bool kernel);
+
+ private:
+  struct Mapping {
+    uint64_t end;
+    uint64_t file_offset;
+    const std::string *binary;
+    const SymbolTable *symbols;  // nullptr if the binary has no symbols (e.g., an anonymous mapping)
+  };
+
+  std::map<std::string, std::unique_ptr<SymbolTable>> binaries_;  // By path, nullptr if it cannot be loaded
+  std::set<std::string> names_;                                   // The interned names of the binaries
+  std::map<pid_t, std::map<uint64_t, Mapping>> processes_;        // The mappings of each process, by start address
+  SymbolTable kernel_symbols_;
+  bool kernel_symbols_loaded_;
+  const std::string *kernel_name_;
+  const std::string *unknown_name_;
+
+  const std::string *intern(const std::string &name);
+  const SymbolTable *get_symbols(const std::string &path);
+  std::map<uint64_t, Mapping> &get_mappings(pid_t pid);
+  void insert_mapping(std::map<uint64_t, Mapping> &mappings, uint64_t start, uint64_t end, uint64_t file_offset, const std::string &path);
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <sys/types.h>  // for pid_t
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+#include <map>      // for std::map
+#include <vector>   // for std::vector
+
+#include "event_scheduler.h"  // for EventScheduler
+#include "pmu_config.h"       // for PMUConfig
+#include "read_buffer.h"      // for GroupReadBuffer
+#include "ring_buffer.h"      // for PerfRingBuffer
+
+/**
+ * @brief Follow the child tasks (processes and threads) of a measured process, for kernels without inherit on group reads.
+ *
+ * A software dummy event with the `task` bit is opened on the root process for each CPU with `inherit`, and its ring buffer
+ * (mmap) receives PERF_RECORD_FORK and PERF_RECORD_EXIT of all the descendants. On every poll(), each new task gets its own
+ * per-task EventScheduler, which follows the active group of the root scheduler, and the interval values of all live tasks
+ * are added to the read buffer of the root scheduler, so the children are folded into the totals of the process.
+ *
+ * A task is counted from the poll() after its fork, the events of a child living shorter than an interval are lost.
+ * When the kernel supports inherit with PERF_FORMAT_GROUP (see inherit_group_read_supported()), EventScheduler::set_inherit()
+ * counts the children from their fork without any of this.
+ */
+class TaskFollower {
+ public:
+  /**
+   * @brief Construct a new TaskFollower object
+   *
+   * @param pmu_config The event groups of the root scheduler, which must outlive this object
+   * @param root_pid The measured process
+   * @param delta_mode See EventScheduler::set_delta_mode()
+   */
+  TaskFollower(const PMUConfig &pmu_config, pid_t root_pid, bool delta_mode);
+
+  ~TaskFollower();
+
+  TaskFollower(const TaskFollower &) = delete;
+  TaskFollower &operator=(const TaskFollower &) = delete;
+
+  /**
+   * @brief Check if the kernel sums the counts of the inherited child events into a group read: a task-clock group with inherit
+   * is counted across a short-lived child, whose CPU time must show up in the read.
+   *
+   * @return true Supported
+   * @return false The kernel rejects the attributes, or the child is not counted
+   */
+  static bool inherit_group_read_supported();
+
+  /**
+   * @brief Open the tracking events and map their ring buffers
+   *
+   * @return true On success
+   * @return false On failure (the error is printed)
+   */
+  bool start();
+
+  /**
+   * @brief Drain the ring buffers: attach a scheduler to each new task with the given group active, and mark the exited ones
+   *
+   * @param active_group_idx The active group of the root scheduler
+   */
+  void poll(int active_group_idx);
+
+  /**
+   * @brief Read the active group of every followed task and add the values into `buffer`, then close the exited tasks
+   *
+   * @param buffer The read buffer of the active group of the root scheduler
+   */
+  void fold_into(GroupReadBuffer &buffer);
+
+  /**
+   * @brief Switch every followed task to the active group of the root scheduler
+   *
+   * @param group_idx
+   */
+  void switch_to_group(int group_idx);
+
+  /**
+   * @brief Stop counting on every followed task
+   */
+  void stop();
+
+  /**
+   * @brief The number of tasks followed so far, excluding the root
+   */
+  size_t get_followed_task_num() const { return followed_task_num_; }
+
+  /**
+   * @brief The number of child tasks that exited before they could be attached
+   */
+  size_t get_missed_task_num() const { return missed_task_num_; }
+
+  /**
+   * @brief The number of records lost because a ring buffer was full, so some tasks may not have been followed
+   */
+  uint64_t get_lost_record_num() const { return lost_record_num_; }
+
+ private:
+  struct Task {
+    EventScheduler scheduler;
+    bool exited;
+  };
+
+  const PMUConfig &pmu_config_;
+  pid_t root_pid_;
+  bool delta_mode_;
+  std::vector<PerfRingBuffer> rings_;  // A tracking event per CPU
+  std::map<pid_t, Task> tasks_;
+  size_t followed_task_num_;
+  size_t missed_task_num_;
+  uint64_t lost_record_num_;
+
+  /**
+   * @brief Create a per-task scheduler for a new task, with the given group enabled
+   *
+   * @return false The task cannot be measured, e.g., it has exited
+   */
+  bool attach(pid_t tid, int active_group_idx);
+};
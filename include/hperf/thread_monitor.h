@@ -0,0 +1,141 @@
+#pragma once
+
+#include <sys/types.h>  // for pid_t
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+#include <map>      // for std::map
+#include <set>      // for std::set
+#include <string>   // for std::string
+#include <vector>   // for std::vector
+
+#include "event_scheduler.h"  // for EventScheduler
+#include "pmu_config.h"       // for PMUConfig
+#include "read_buffer.h"      // for GroupReadBuffer
+
+/**
+ * @brief Per-thread measurement (`--per-thread`): an EventScheduler for each thread of a process, like the one for each CPU
+ * of a system-wide measurement. The threads are enumerated from /proc/<pid>/task on every scan(), so the new threads are measured
+ * from the next interval, and the gone ones are closed after their last read.
+ *
+ * Each thread takes an fd per event of every group. The soft limit of open files is raised to the hard limit, and the threads
+ * that would exceed it are not measured (see get_unmeasured_thread_num()) rather than failing the measurement.
+ * A thread that did not run in an interval keeps its active group, so the idle threads of a large process cost a read() per
+ * interval, but no ioctl() for switching.
+ */
+class ThreadMonitor {
+ public:
+  /**
+   * @brief Construct a new ThreadMonitor object
+   *
+   * @param pmu_config The event groups of each thread, which must outlive this object
+   * @param pid The measured process
+   * @param delta_mode See EventScheduler::set_delta_mode()
+   * @param schedule The scheduling policy of each thread (see create_scheduling_policy())
+   */
+  ThreadMonitor(const PMUConfig &pmu_config, pid_t pid, bool delta_mode, const std::string &schedule);
+
+  ThreadMonitor(const ThreadMonitor &) = delete;
+  ThreadMonitor &operator=(const ThreadMonitor &) = delete;
+
+  /**
+   * @brief Attach to the new threads of the process and mark the gone ones
+   *
+   * @return std::vector<pid_t> The TIDs of the threads attached by this scan
+   */
+  std::vector<pid_t> scan();
+
+  /**
+   * @brief Read the active group of each thread, then close the threads gone since the previous scan()
+   *
+   * @tparam Visitor void(pid_t tid, int group_idx, const GroupReadBuffer &buffer)
+   * @param visitor Called with the values of this interval of each thread
+   */
+  template <typename Visitor>
+  void read(Visitor visitor) {
+    for (auto it = threads_.begin(); it != threads_.end();) {
+      EventScheduler &scheduler = it->second.scheduler;
+      if (scheduler.read_active_group_data() > 0) {
+        const GroupReadBuffer &buffer = scheduler.get_active_group_read_buffer();
+        it->second.ran = buffer.time_enabled() > 0;  // A task event is only enabled while the task runs
+        visitor(it->first, scheduler.get_active_group_idx(), buffer);
+      }
+      if (it->second.gone) {
+        opened_fd_num_ -= fd_num_per_thread_;
+        it = threads_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  /**
+   * @brief Switch each thread that ran in the last interval to its next group
+   */
+  void switch_to_next_group();
+
+  /**
+   * @brief Stop counting on every thread
+   */
+  void stop();
+
+  /**
+   * @brief The name (comm) of a thread when it was attached
+   */
+  const std::string &get_thread_name(pid_t tid) const;
+
+  /**
+   * @brief The number of threads being measured
+   */
+  size_t get_thread_num() const { return threads_.size(); }
+
+  /**
+   * @brief The number of threads measured so far
+   */
+  size_t get_measured_thread_num() const { return measured_thread_num_; }
+
+  /**
+   * @brief The number of threads not measured because of the limit of open files
+   */
+  size_t get_unmeasured_thread_num() const { return unmeasured_threads_.size(); }
+
+  /**
+   * @brief The number of group switches skipped because the thread did not run in the interval
+   */
+  uint64_t get_skipped_switch_num() const { return skipped_switch_num_; }
+
+ private:
+  struct Thread {
+    EventScheduler scheduler;
+    bool ran;   // It ran in the last read interval
+    bool gone;  // Not in /proc/<pid>/task any more, closed after the next read
+  };
+
+  const PMUConfig &pmu_config_;
+  pid_t pid_;
+  bool delta_mode_;
+  std::string schedule_;
+  std::map<pid_t, Thread> threads_;
+  std::set<pid_t> unmeasured_threads_;  // The TIDs not attached because of the limit of open files
+  std::map<pid_t, std::string> names_;  // The names of all the threads ever measured
+
+  size_t fd_num_per_thread_;
+  size_t fd_limit_;  // The open files that may be used by the event groups
+  size_t opened_fd_num_;
+  size_t measured_thread_num_;
+  uint64_t skipped_switch_num_;
+
+  /**
+   * @brief Raise the soft limit of open files to the hard limit
+   *
+   * @return size_t The limit
+   */
+  static size_t raise_open_file_limit();
+
+  /**
+   * @brief Open the event groups of a new thread and enable its first group
+   *
+   * @return false The thread cannot be measured, e.g., it has exited
+   */
+  bool attach(pid_t tid);
+};
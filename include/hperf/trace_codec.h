@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t, int64_t
+#include <map>      // for std::map
+#include <utility>  // for std::pair
+#include <vector>   // for std::vector
+
+/**
+ * @brief A group read of one CPU in one interval, the unit of the compressed trace
+ */
+struct TraceBlock {
+  uint64_t timestamp;
+  int cpu_id;
+  int group_id;  // -1 for a marker without values
+  uint64_t time_enabled;
+  uint64_t time_running;
+  std::vector<uint64_t> values;  // fixed events + schedulable events of the group
+};
+
+namespace trace_codec {
+
+inline uint64_t zigzag_encode(int64_t v) {
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+inline int64_t zigzag_decode(uint64_t v) {
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+/**
+ * @brief Append an unsigned LEB128 varint (7 bits per byte, MSB set on all but the last byte)
+ */
+inline void put_varint(std::vector<char> &buf, uint64_t v) {
+  while (v >= 0x80) {
+    buf.push_back(static_cast<char>((v & 0x7f) | 0x80));
+    v >>= 7;
+  }
+  buf.push_back(static_cast<char>(v));
+}
+
+/**
+ * @brief Read an unsigned LEB128 varint
+ *
+ * @param[in,out] p The read position, advanced past the varint on success
+ * @param end The end of the buffer
+ * @param[out] v The decoded value
+ * @return true On success
+ * @return false The buffer ends in the middle of the varint, or the varint is longer than 64 bits
+ */
+inline bool get_varint(const char *&p, const char *end, uint64_t &v) {
+  v = 0;
+  for (int shift = 0; shift < 64 && p < end; shift += 7) {
+    uint8_t byte = static_cast<uint8_t>(*p++);
+    v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+/**
+ * @brief The previous values of a (cpu, group) stream, kept identically by the encoder and the decoder
+ */
+struct StreamState {
+  uint64_t prev_timestamp = 0;
+  int64_t prev_timestamp_delta = 0;
+  uint64_t prev_time_enabled = 0;
+  uint64_t prev_time_running = 0;
+  std::vector<uint64_t> prev_values;
+};
+
+}  // namespace trace_codec
+
+/**
+ * @brief Streaming Gorilla-style encoder for the counter stream (dependency-free).
+ *
+ * Each (cpu, group) pair is a stream: its timestamps are stored as delta-of-delta, and every column (time_enabled, time_running and each event count)
+ * is stored as the difference from the previous value in the same column. All numbers are zig-zag varints, so the regular timestamps and slowly varying counts take one or two bytes.
+ *
+ * Block layout: varint cpu_id + 1, varint group_id, zigzag dod(timestamp), zigzag d(time_enabled), zigzag d(time_running), zigzag d(value) * nr
+ * A block of group -1 is a marker (e.g., a phase boundary) without values, its group is encoded as 0xffffffff.
+ */
+class TraceEncoder {
+ public:
+  /**
+   * @brief Encode a block and append the bytes to `out`
+   *
+   * @param block
+   * @param out
+   */
+  void encode(const TraceBlock &block, std::vector<char> &out);
+
+ private:
+  std::map<std::pair<int, int>, trace_codec::StreamState> states_;  // (cpu_id, group_id) -> state
+};
+
+/**
+ * @brief Decoder of the byte stream produced by TraceEncoder
+ */
+class TraceDecoder {
+ public:
+  /**
+   * @brief Construct a new TraceDecoder object
+   *
+   * @param group_sizes The number of values (nr) of each group, taken from the dictionary in the file header
+   */
+  explicit TraceDecoder(std::vector<size_t> group_sizes);
+
+  /**
+   * @brief Decode the next block
+   *
+   * @param[in,out] p The read position, advanced past the block on success
+   * @param end The end of the buffer
+   * @param[out] block The decoded block
+   * @return true On success
+   * @return false The buffer is exhausted or corrupted
+   */
+  bool decode(const char *&p, const char *end, TraceBlock &block);
+
+ private:
+  std::vector<size_t> group_sizes_;
+  std::map<std::pair<int, int>, trace_codec::StreamState> states_;  // (cpu_id, group_id) -> state
+};
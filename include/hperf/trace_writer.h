@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>        // for size_t
+#include <cstdint>        // for uint64_t
+#include <ostream>        // for std::ostream
+#include <string>         // for std::string
+#include <unordered_map>  // for std::unordered_map
+#include <utility>        // for std::pair
+#include <vector>         // for std::vector
+
+#include "pmu_config.h"   // for PMUConfig
+#include "reporter.h"     // for Record
+#include "trace_codec.h"  // for TraceEncoder, TraceBlock
+
+/**
+ * @brief Interface of the raw data output. The records of one group read arrive in the order of event_id (0 .. nr - 1).
+ */
+class TraceWriter {
+ public:
+  virtual ~TraceWriter() = default;
+
+  /**
+   * @brief Write the file header, called once before the measurement
+   */
+  virtual void write_header() = 0;
+
+  /**
+   * @brief Write a single event count of an interval
+   *
+   * @param record
+   */
+  virtual void write_record(const Record &record) = 0;
+
+  /**
+   * @brief Write everything that is still buffered and the file footer (if any), called once after the measurement
+   */
+  virtual void finish() = 0;
+};
+
+/**
+ * @brief CSV output: `timestamp,cpu,group,event,value`, one line per event per group per CPU.
+ * A phase boundary is written as `timestamp,cpu,0,phase_boundary,<interval in ns from then on>` (the groups are numbered from 1).
+ */
+class CsvTraceWriter : public TraceWriter {
+ public:
+  /**
+   * @brief Construct a new CsvTraceWriter object
+   *
+   * @param pmu_config Used to look up the event names
+   * @param out The output stream
+   * @param with_header Whether to write the line of column names (not written to the console)
+   */
+  CsvTraceWriter(const PMUConfig &pmu_config, std::ostream &out, bool with_header);
+
+  void write_header() override;
+  void write_record(const Record &record) override;
+  void finish() override;
+
+ private:
+  const PMUConfig &pmu_config_;
+  std::ostream &out_;
+  bool with_header_;
+};
+
+/**
+ * @brief Compact binary trace (`--format=bin`). All integers are little-endian.
+ *
+ * File layout:
+ *   Header: "HPERFBIN", u32 version, u64 interval_ns, str cpu_model,
+ *           u32 fixed_event_num, { str name, u64 encoding } * fixed_event_num,
+ *           u32 group_num, { u32 event_num, { str name, u64 encoding } * event_num } * group_num
+ *   Blocks: one per group read, fixed width for each group:
+ *           u64 timestamp, i32 cpu, u32 group, u64 nr, u64 time_enabled, u64 time_running, u64 value * nr
+ *           (nr = fixed_event_num + event_num of the group, i.e., the layout of GroupReadBuffer without the event ids)
+ *           A phase boundary is a block of group 0xffffffff with nr = 0 and time_enabled = the interval in ns from then on (since version 2)
+ *   Index:  "HPERFIDX", u64 entry_num, { u64 first_timestamp, u64 last_timestamp, u64 offset, u64 block_num } * entry_num
+ *   Tail:   u64 index_offset, "HPERFEND"
+ * where str = u32 length + bytes. A reader seeks to the last 16 bytes, loads the index and then seeks to the blocks of any time window.
+ */
+class BinaryTraceWriter : public TraceWriter {
+ public:
+  /**
+   * @brief Construct a new BinaryTraceWriter object
+   *
+   * @param pmu_config Used to write the group/event dictionary and the size of blocks
+   * @param out The output stream, should be opened in binary mode
+   * @param interval_in_ns The event group switching interval
+   */
+  BinaryTraceWriter(const PMUConfig &pmu_config, std::ostream &out, uint64_t interval_in_ns);
+
+  void write_header() override;
+  void write_record(const Record &record) override;
+  void finish() override;
+
+  static constexpr uint32_t kVersion = 2;
+
+ private:
+  struct IndexEntry {
+    uint64_t first_timestamp;
+    uint64_t last_timestamp;
+    uint64_t offset;
+    uint64_t block_num;
+  };
+
+  const PMUConfig &pmu_config_;
+  std::ostream &out_;
+  uint64_t interval_in_ns_;
+
+  uint64_t offset_;  // The number of bytes written so far
+
+  std::unordered_map<int, std::vector<char>> pending_blocks_;  // The block being assembled for each CPU
+  std::vector<IndexEntry> index_;
+
+  void write_block(const std::vector<char> &block, uint64_t timestamp);
+
+  void write_bytes(const std::vector<char> &bytes);
+};
+
+/**
+ * @brief Compressed binary trace (`--format=cbin`), encoded by TraceEncoder (delta-of-delta timestamps and zig-zag varint value deltas).
+ *
+ * File layout:
+ *   Header: "HPERFCMP", followed by the same fields as the header of BinaryTraceWriter
+ *   Blocks: the byte stream of TraceEncoder, to be decoded sequentially by TraceDecoder
+ *           (a phase boundary is a block of group -1 without values, time_enabled = the interval in ns from then on, since version 2)
+ */
+class CompressedTraceWriter : public TraceWriter {
+ public:
+  CompressedTraceWriter(const PMUConfig &pmu_config, std::ostream &out, uint64_t interval_in_ns);
+
+  void write_header() override;
+  void write_record(const Record &record) override;
+  void finish() override;
+
+  static constexpr uint32_t kVersion = 2;
+
+ private:
+  const PMUConfig &pmu_config_;
+  std::ostream &out_;
+  uint64_t interval_in_ns_;
+
+  TraceEncoder encoder_;
+  std::vector<char> buf_;  // Encoded bytes not yet written
+
+  std::unordered_map<int, std::pair<TraceBlock, bool>> pending_blocks_;  // The block being assembled for each CPU, and whether it is valid
+
+  uint64_t raw_size_;         // The size of the blocks in the uncompressed binary trace
+  uint64_t compressed_size_;  // The size of the encoded blocks
+};
+
+// Helpers to serialize integers in little-endian order, shared by the binary trace formats
+namespace trace_encoding {
+
+inline void put_u32(std::vector<char> &buf, uint32_t v) {
+  for (int i = 0; i < 4; ++i) buf.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+inline void put_u64(std::vector<char> &buf, uint64_t v) {
+  for (int i = 0; i < 8; ++i) buf.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+inline void put_str(std::vector<char> &buf, const std::string &s) {
+  put_u32(buf, static_cast<uint32_t>(s.size()));
+  buf.insert(buf.end(), s.begin(), s.end());
+}
+
+/**
+ * @brief Read the CPU model from /proc/cpuinfo ("model name" on x86, "CPU implementer" / "CPU part" on Arm)
+ */
+std::string read_cpu_model();
+
+/**
+ * @brief Append the common file header: magic, version, interval, CPU model and the group/event dictionary
+ */
+void put_file_header(std::vector<char> &buf, const std::string &magic, uint32_t version,
+                     uint64_t interval_in_ns, const PMUConfig &pmu_config);
+
+}  // namespace trace_encoding
@@ -16,24 +16,47 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <sstream>
 
 #include "hperf/pmu_config.h"
 
+// The period of --sample without one, a prime so that the samples do not lock onto a loop
+#define DEFAULT_SAMPLE_PERIOD 1000003
+
 bool ArgsParser::parse(ProfileConfig &profile_config, int argc, char **argv) {
-  const char *short_opts = "d:i:ac:p:o:h";
+  const char *short_opts = "d:i:ac:p:G:o:h";
   const option long_opts[] = {{"duration", required_argument, nullptr, 'd'},
                               {"interval", required_argument, nullptr, 'i'},
                               {"system_wide", no_argument, nullptr, 'a'},
                               {"cpu", required_argument, nullptr, 'c'},
                               {"pid", required_argument, nullptr, 'p'},
+                              {"cgroup", required_argument, nullptr, 'G'},
                               {"output", required_argument, nullptr, 'o'},
                               {"detect-counters", no_argument, nullptr, 1},
                               {"optimize-event-groups", no_argument, nullptr, 2},
+                              {"per-cpu-threads", no_argument, nullptr, 3},
+                              {"delta-counting", no_argument, nullptr, 4},
+                              {"format", required_argument, nullptr, 5},
+                              {"async-output", no_argument, nullptr, 6},
+                              {"metrics", required_argument, nullptr, 7},
+                              {"interval-metrics", required_argument, nullptr, 8},
+                              {"rollup", required_argument, nullptr, 9},
+                              {"estimator", required_argument, nullptr, 10},
+                              {"schedule", required_argument, nullptr, 11},
+                              {"phase-detect", no_argument, nullptr, 12},
+                              {"metric-aware-grouping", no_argument, nullptr, 13},
+                              {"event-file", required_argument, nullptr, 14},
+                              {"follow-children", no_argument, nullptr, 15},
+                              {"per-thread", no_argument, nullptr, 16},
+                              {"sample", required_argument, nullptr, 17},
+                              {"call-graph", no_argument, nullptr, 18},
                               {"help", no_argument, nullptr, 'h'},
                               {nullptr, 0, nullptr, 0}};
 
   int opt;
   std::string cpu_list_str;
+  std::string rollup_str;
+  std::string sample_str;
   bool a_flag = false;
   bool p_flag = false;
   bool cmd_flag = false;
@@ -60,6 +83,14 @@ bool ArgsParser::parse(ProfileConfig &profile_config, int argc, char **argv) {
         p_flag = true;
         profile_config.target_pid = std::atoi(optarg);
         break;
+      case 'G': {
+        std::string cgroup;
+        std::istringstream cgroup_list(optarg);
+        while (std::getline(cgroup_list, cgroup, ',')) {
+          if (!cgroup.empty()) profile_config.cgroups.push_back(cgroup);
+        }
+        break;
+      }
       case 'o':
         profile_config.output_filename = optarg;
         break;
@@ -69,6 +100,55 @@ bool ArgsParser::parse(ProfileConfig &profile_config, int argc, char **argv) {
       case 2:
         profile_config.optimize_event_groups = true;
         break;
+      case 3:
+        profile_config.per_cpu_threads = true;
+        break;
+      case 4:
+        profile_config.delta_counting = true;
+        break;
+      case 5:
+        profile_config.output_format = optarg;
+        break;
+      case 6:
+        profile_config.async_output = true;
+        break;
+      case 7:
+        profile_config.metrics_filename = optarg;
+        break;
+      case 8:
+        profile_config.interval_metrics_filename = optarg;
+        break;
+      case 9:
+        rollup_str = optarg;
+        break;
+      case 10:
+        profile_config.estimator = optarg;
+        break;
+      case 11:
+        profile_config.schedule = optarg;
+        break;
+      case 12:
+        profile_config.phase_detect = true;
+        break;
+      case 13:
+        profile_config.metric_aware_grouping = true;
+        profile_config.optimize_event_groups = true;
+        break;
+      case 14:
+        profile_config.event_filename = optarg;
+        break;
+      case 15:
+        profile_config.follow_children = true;
+        break;
+      case 16:
+        profile_config.per_thread = true;
+        break;
+      case 17:
+        sample_str = optarg;
+        break;
+      case 18:
+        profile_config.call_graph = true;
+        break;
       case 'h':
         print_help(argv[0]);
         exit(0);
@@ -114,6 +194,116 @@ bool ArgsParser::parse(ProfileConfig &profile_config, int argc, char **argv) {
     return false;
   }
 
+  if (profile_config.per_cpu_threads && !a_flag) {
+    std::cerr << "Error: --per-cpu-threads is only available for system-wide measurement.\n";
+    return false;
+  }
+
+  if (profile_config.follow_children && a_flag) {
+    std::cerr << "Error: --follow-children is only available for per-process measurement.\n";
+    return false;
+  }
+
+  if (!profile_config.cgroups.empty() && !a_flag) {
+    std::cerr << "Error: -G is only available for system-wide measurement.\n";
+    return false;
+  }
+
+  if (!profile_config.cgroups.empty() && (profile_config.per_cpu_threads || profile_config.phase_detect)) {
+    std::cerr << "Error: -G cannot be used with --per-cpu-threads or --phase-detect.\n";
+    return false;
+  }
+
+  if (profile_config.cgroups.size() > 1 && profile_config.output_filename.empty()) {
+    std::cerr << "Error: Several cgroups (-G) require an output file (-o), the raw data of each cgroup is written to its own file.\n";
+    return false;
+  }
+
+  if (profile_config.per_thread && a_flag) {
+    std::cerr << "Error: --per-thread is only available for per-process measurement.\n";
+    return false;
+  }
+
+  if (profile_config.per_thread && (profile_config.follow_children || profile_config.phase_detect)) {
+    std::cerr << "Error: --per-thread cannot be used with --follow-children or --phase-detect.\n";
+    return false;
+  }
+
+  if (!sample_str.empty()) {
+    // <event>[:<period>], the event is checked against the event groups later
+    size_t colon = sample_str.rfind(':');
+    profile_config.sample_event = sample_str.substr(0, colon);
+    profile_config.sample_period = DEFAULT_SAMPLE_PERIOD;
+    if (colon != std::string::npos) {
+      char *endptr = nullptr;
+      const std::string period_str = sample_str.substr(colon + 1);
+      profile_config.sample_period = std::strtoull(period_str.c_str(), &endptr, 10);
+      if (period_str.empty() || *endptr != '\0' || profile_config.sample_period == 0) {
+        std::cerr << "Error: Invalid sample period (" << period_str << ").\n";
+        return false;
+      }
+    }
+    if (profile_config.sample_event.empty()) {
+      std::cerr << "Error: --sample requires an event.\n";
+      return false;
+    }
+  }
+
+  if (profile_config.call_graph && profile_config.sample_event.empty()) {
+    std::cerr << "Error: --call-graph requires --sample.\n";
+    return false;
+  }
+
+  if (!profile_config.sample_event.empty() && (!profile_config.cgroups.empty() || profile_config.per_cpu_threads ||
+                                               profile_config.per_thread || profile_config.follow_children)) {
+    std::cerr << "Error: --sample cannot be used with -G, --per-cpu-threads, --per-thread or --follow-children.\n";
+    return false;
+  }
+
+  if (profile_config.output_format != "csv" && profile_config.output_format != "bin" &&
+      profile_config.output_format != "cbin") {
+    std::cerr << "Error: Unknown output format (" << profile_config.output_format << ").\n";
+    return false;
+  }
+
+  if (profile_config.output_format != "csv" && profile_config.output_filename.empty()) {
+    std::cerr << "Error: Binary output format requires an output file (-o).\n";
+    return false;
+  }
+
+  if (profile_config.estimator != "wallclock" && profile_config.estimator != "kernel" &&
+      profile_config.estimator.compare(0, 4, "ref:") != 0) {
+    std::cerr << "Error: Unknown estimator (" << profile_config.estimator << ").\n";
+    return false;
+  }
+
+  // The weights are checked against the number of event groups later, which may change with --optimize-event-groups
+  if (profile_config.schedule != "rr" && profile_config.schedule != "variance" &&
+      profile_config.schedule.compare(0, 8, "weights:") != 0) {
+    std::cerr << "Error: Unknown scheduling policy (" << profile_config.schedule << ").\n";
+    return false;
+  }
+
+  if (!rollup_str.empty()) {
+    if (!a_flag) {
+      std::cerr << "Error: --rollup is only available for system-wide measurement.\n";
+      return false;
+    }
+    size_t pos = 0;
+    while (pos <= rollup_str.size()) {
+      size_t comma_pos = rollup_str.find(',', pos);
+      std::string token = rollup_str.substr(pos, comma_pos - pos);
+      TopologyLevel level;
+      if (!parse_topology_level(token, level)) {
+        std::cerr << "Error: Unknown roll-up level (" << token << "), expected cpu, core, cluster or package.\n";
+        return false;
+      }
+      profile_config.rollup_levels.push_back(level);
+      if (comma_pos == std::string::npos) break;
+      pos = comma_pos + 1;
+    }
+  }
+
   if (a_flag && profile_config.test_duration <= 0) {
     std::cerr << "Error: For system-wide, test duration must be greater than 0.\n";
     return false;
@@ -148,6 +338,19 @@ void ArgsParser::print_profile_config(const ProfileConfig &profile_config) {
 
   std::cout << "Event group switch inteval: " << profile_config.switch_group_interval << " ms\n";
 
+  std::cout << "Event group accounting: " << (profile_config.delta_counting ? "delta (no reset)" : "reset on switch") << "\n";
+
+  std::cout << "Estimator: " << profile_config.estimator << "\n";
+
+  std::cout << "Event group scheduling: " << profile_config.schedule << "\n";
+
+  std::cout << "Phase detection: " << (profile_config.phase_detect ? "on" : "off") << "\n";
+
+  if (!profile_config.sample_event.empty()) {
+    std::cout << "Sampling: " << profile_config.sample_event << " every " << profile_config.sample_period
+              << (profile_config.call_graph ? " (with callchains)" : "") << "\n";
+  }
+
   std::cout << "Mode: ";
   switch (profile_config.mode) {
     case ProfileMode::SYSTEM_WIDE:
@@ -163,6 +366,12 @@ void ArgsParser::print_profile_config(const ProfileConfig &profile_config) {
       std::cout << "UNKNOWN";
       break;
   }
+  if (profile_config.per_cpu_threads) {
+    std::cout << " (per-CPU threads)";
+  }
+  if (profile_config.per_thread) {
+    std::cout << " (per-thread)";
+  }
   std::cout << "\n";
 
   std::cout << "CPU ID list: [";
@@ -175,9 +384,26 @@ void ArgsParser::print_profile_config(const ProfileConfig &profile_config) {
   }
   std::cout << "]\n";
 
+  if (!profile_config.cgroups.empty()) {
+    std::cout << "cgroups: ";
+    for (size_t i = 0; i < profile_config.cgroups.size(); ++i) {
+      std::cout << profile_config.cgroups[i] << (i + 1 < profile_config.cgroups.size() ? ", " : "\n");
+    }
+  }
+
   std::cout << "Output file name: " << profile_config.output_filename << "\n";
+  std::cout << "Output format: " << profile_config.output_format << (profile_config.async_output ? " (asynchronous)" : "") << "\n";
+  std::cout << "Event file: " << (profile_config.event_filename.empty() ? "compiled-in" : profile_config.event_filename) << "\n";
+  std::cout << "Metric definitions: " << (profile_config.metrics_filename.empty() ? "embedded" : profile_config.metrics_filename) << "\n";
+  std::cout << "Interval metrics file name: " << profile_config.interval_metrics_filename << "\n";
+  std::cout << "Roll-up levels: [";
+  for (size_t i = 0; i < profile_config.rollup_levels.size(); ++i) {
+    const char *names[] = {"cpu", "core", "cluster", "package"};
+    std::cout << names[static_cast<int>(profile_config.rollup_levels[i])] << (i + 1 < profile_config.rollup_levels.size() ? ", " : "");
+  }
+  std::cout << "]\n";
   std::cout << "Output file descriptor: " << (profile_config.output_file_ptr ? "set" : "null") << "\n";
-  std::cout << "Target PID: " << profile_config.target_pid << "\n";
+  std::cout << "Target PID: " << profile_config.target_pid << (profile_config.follow_children ? " (with child tasks)" : "") << "\n";
 
   std::cout << "Command Args: [";
   for (size_t i = 0; i < profile_config.command_args.size(); ++i) {
@@ -246,9 +472,48 @@ void ArgsParser::print_help(const char *program_name) {
       << "  -c, --target_cpu <cpu>      Only for system-wide, only monitor the specified CPUs.\n"
       << "                              Multiple CPUs can be provided as a comma-separated list.\n"
       << "  -p, --pid <PID>             Per-process measurement by specifying PID.\n"
+      << "  -G, --cgroup <cgroup>       Only for system-wide, only count the tasks of the cgroup (relative to the perf_event cgroup\n"
+      << "                              mount, e.g. system.slice/docker-<id>.scope). Several cgroups (a comma-separated list, or\n"
+      << "                              repeated -G) are counted side by side with the same group schedule, each reported on its\n"
+      << "                              own and written to its own output file.\n"
       << "  -o, --output <file>         Print the raw data into the designated file.\n"
+      << "      --format <csv|bin|cbin> Raw data output format (default: csv). 'bin' is a compact binary trace with an index footer,\n"
+      << "                              'cbin' is a compressed binary trace (delta-of-delta timestamps, zig-zag varint value deltas).\n"
+      << "      --async-output          Write the raw data on a separate writer thread, so that slow I/O does not delay group switching.\n"
+      << "      --event-file <file>     Load the events and event groups from a JSON file instead of the compiled-in ones.\n"
+      << "                              Events are looked up by name in the file, then in the PMU drivers in sysfs.\n"
+      << "      --metrics <file>        Load the metric definitions from the file instead of the embedded ones.\n"
+      << "      --interval-metrics <file>\n"
+      << "                              Write the metrics of every group rotation, per CPU and system-wide, as CSV into the file.\n"
+      << "      --rollup <levels>       Only for system-wide, also report the counts and metrics of each CPU, or rolled up by\n"
+      << "                              the topology. Comma-separated list of cpu, core, cluster and package.\n"
+      << "      --estimator <name>      How multiplexed counts are extrapolated (default: wallclock). 'wallclock' scales by the\n"
+      << "                              residency of each group, 'kernel' by time_enabled / time_running per CPU and per interval,\n"
+      << "                              and also reports the wall-clock time not covered by any group. 'ref:<event>' scales each\n"
+      << "                              group by its share of a fixed event, e.g. 'ref:inst_retired', for bursty workloads.\n"
+      << "      --schedule <policy>     How the event groups share the time (default: rr). 'rr' switches in turn, 'weights:w1,w2,...'\n"
+      << "                              gives each group a residency proportional to its weight, 'variance' gives more time to the\n"
+      << "                              groups whose estimates have the highest error so far.\n"
+      << "      --phase-detect          Watch the ratios of the fixed events (e.g. IPC) of every interval, and after a phase change\n"
+      << "                              shorten the interval so that every group samples the new phase. Phase boundaries are\n"
+      << "                              recorded in the raw data output.\n"
       << "      --detect-counters       Detect the number of programmable hardware counters on each CPU and exit.\n"
       << "      --optimize-event-groups Detect counters, and use the result to optimize default event groups.\n"
+      << "      --metric-aware-grouping Like --optimize-event-groups, but only keep the events used by the metrics, and count the\n"
+      << "                              events of each metric in a common group where possible.\n"
+      << "      --follow-children       Only for per-process, also count the child processes and threads created during the\n"
+      << "                              measurement, e.g. the commands of a shell script.\n"
+      << "      --per-thread            Only for per-process, measure each thread of the process (including the ones created\n"
+      << "                              during the measurement) and report the counts and metrics of each thread. The CPU\n"
+      << "                              column of the raw data output is the TID.\n"
+      << "      --sample <event>[:<period>]\n"
+      << "                              Also sample on the overflow of an event of the event groups every <period> counts (default:\n"
+      << "                              1000003), and report the functions with the most samples. A fixed event samples all the\n"
+      << "                              time, an event of a group only while the group is counted.\n"
+      << "      --call-graph            With --sample, record the callchain of each sample and report the share of the samples\n"
+      << "                              with each function on the stack.\n"
+      << "      --per-cpu-threads       Only for system-wide, collect on each CPU by a thread pinned to it.\n"
+      << "      --delta-counting        Never reset counters when switching event groups, report the difference of cumulative counts.\n"
       << "  -h, --help                  Show this help message and exit.\n"
       << "\nExample:\n"
       << "  Specify a PID\n"
@@ -0,0 +1,145 @@
+#include "hperf/async_trace_writer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+AsyncTraceWriter::AsyncTraceWriter(std::unique_ptr<TraceWriter> inner, const PMUConfig &pmu_config, size_t batch_num, size_t batch_size)
+    : inner_(std::move(inner)),
+      ring_(std::max<size_t>(batch_num, 2)),
+      batch_size_(std::max<size_t>(batch_size, 1)),
+      head_(0),
+      filled_num_(0),
+      stopping_(false),
+      current_(0),
+      current_dropped_(false),
+      submitted_batch_num_(0),
+      dropped_read_num_(0),
+      dropped_record_num_(0),
+      max_filled_num_(0),
+      finished_(false) {
+  for (size_t i = 0; i < pmu_config.get_event_group_num(); ++i) {
+    read_sizes_.push_back(pmu_config.get_fixed_events().size() + pmu_config.get_event_group_by_idx(i).size());
+    batch_size_ = std::max(batch_size_, read_sizes_.back());  // A group read always fits in a batch
+  }
+  for (auto &batch : ring_) {
+    batch.records.resize(batch_size_);
+    batch.size = 0;
+  }
+  writer_thread_ = std::thread([this] { write_batches(); });
+}
+
+AsyncTraceWriter::~AsyncTraceWriter() {
+  if (!finished_) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    filled_cv_.notify_one();
+    writer_thread_.join();
+  }
+}
+
+void AsyncTraceWriter::write_header() {
+  inner_->write_header();
+}
+
+void AsyncTraceWriter::write_record(const Record &record) {
+  if (record.event_id == 0) {
+    // A new group read: all its records go into one batch, or are all dropped
+    const size_t read_size = get_read_size(record);
+    if (current_ != ring_.size() && ring_[current_].size + read_size > batch_size_) {
+      submit_current();
+    }
+    if (current_ == ring_.size()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (filled_num_ < ring_.size()) {
+        current_ = (head_ + filled_num_) % ring_.size();
+        ring_[current_].size = 0;
+      }
+    }
+    current_dropped_ = (current_ == ring_.size());  // Still no free batch
+    if (current_dropped_) ++dropped_read_num_;
+  }
+  if (current_dropped_ || current_ == ring_.size()) {
+    ++dropped_record_num_;
+    return;
+  }
+
+  // The space of the whole group read is checked at its first record
+  Batch &batch = ring_[current_];
+  if (batch.size == batch_size_) {  // More records than the group has, never split a read
+    ++dropped_record_num_;
+    return;
+  }
+  batch.records[batch.size++] = record;
+}
+
+size_t AsyncTraceWriter::get_read_size(const Record &record) const {
+  if (record.group_id < 0 || static_cast<size_t>(record.group_id) >= read_sizes_.size()) return 1;  // e.g., a phase boundary
+  return read_sizes_[record.group_id];
+}
+
+void AsyncTraceWriter::submit_current() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++filled_num_;
+    max_filled_num_ = std::max(max_filled_num_, filled_num_);
+    if (filled_num_ < ring_.size()) {
+      current_ = (head_ + filled_num_) % ring_.size();
+      ring_[current_].size = 0;
+    } else {
+      current_ = ring_.size();  // The writer thread falls behind, no free batch left
+    }
+  }
+  ++submitted_batch_num_;
+  filled_cv_.notify_one();
+}
+
+void AsyncTraceWriter::write_batches() {
+  while (true) {
+    size_t idx;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      filled_cv_.wait(lock, [this] { return filled_num_ > 0 || stopping_; });
+      if (filled_num_ == 0) break;  // stopping and nothing left
+      idx = head_;
+    }
+
+    // The batch is owned by the writer thread until head_ advances
+    const Batch &batch = ring_[idx];
+    for (size_t i = 0; i < batch.size; ++i) {
+      inner_->write_record(batch.records[i]);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      head_ = (head_ + 1) % ring_.size();
+      --filled_num_;
+    }
+  }
+}
+
+void AsyncTraceWriter::finish() {
+  if (finished_) return;
+
+  if (current_ != ring_.size() && ring_[current_].size > 0) {
+    submit_current();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  filled_cv_.notify_one();
+  writer_thread_.join();
+  finished_ = true;
+
+  inner_->finish();
+
+  std::cout << "Asynchronous output: " << submitted_batch_num_ << " batches written, ring high-water mark "
+            << max_filled_num_ << "/" << ring_.size() << " batches\n";
+  if (dropped_record_num_ > 0) {
+    std::cerr << "Warning: Output fell behind, " << dropped_read_num_ << " group reads ("
+              << dropped_record_num_ << " records) dropped\n";
+  }
+}
@@ -0,0 +1,33 @@
+#include "hperf/cache_dir.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+
+// The subdirectory of the cache directory of the user
+#define CACHE_SUBDIR "hperf"
+
+std::string get_cache_dir() {
+  std::string base;
+  const char *xdg_cache_home = getenv("XDG_CACHE_HOME");
+  const char *home = getenv("HOME");
+  if (xdg_cache_home && xdg_cache_home[0] == '/') {  // A relative path is invalid by the XDG spec
+    base = xdg_cache_home;
+  } else if (home && home[0] == '/') {
+    base = std::string(home) + "/.cache";
+  } else {
+    return "";
+  }
+
+  std::string dir = base + "/" + CACHE_SUBDIR;
+  mkdir(base.c_str(), 0700);  // May exist already
+  mkdir(dir.c_str(), 0700);
+
+  // Not a symlink planted by someone else, and nobody else can replace the files in it
+  struct stat st;
+  if (lstat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH))) {
+    return "";
+  }
+  return dir;
+}
@@ -0,0 +1,84 @@
+#include "hperf/cgroup.h"
+
+#include <fcntl.h>
+#include <linux/magic.h>  // for CGROUP_SUPER_MAGIC, CGROUP2_SUPER_MAGIC
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+std::string find_perf_cgroup_mount(const std::string &mounts_file) {
+  std::ifstream mounts(mounts_file);
+  std::string line;
+  std::string unified;
+  while (std::getline(mounts, line)) {
+    // <device> <mount point> <type> <options> ...
+    std::istringstream fields(line);
+    std::string device, mount_point, type, options;
+    if (!(fields >> device >> mount_point >> type >> options)) continue;
+    if (type == "cgroup") {
+      std::istringstream option_list(options);
+      std::string option;
+      while (std::getline(option_list, option, ',')) {
+        if (option == "perf_event") return mount_point;
+      }
+    } else if (type == "cgroup2" && unified.empty()) {
+      unified = mount_point;
+    }
+  }
+  return unified;
+}
+
+int open_cgroup(const std::string &path) {
+  auto is_directory = [](const std::string &p) {
+    struct stat st;
+    return stat(p.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+  };
+  auto is_under = [](const std::string &p, const std::string &dir) {
+    return p.compare(0, dir.size(), dir) == 0 && (p.size() == dir.size() || dir.back() == '/' || p[dir.size()] == '/');
+  };
+
+  const std::string mount_point = find_perf_cgroup_mount();
+  std::string directory;
+  if (!mount_point.empty() && is_under(path, mount_point)) {
+    directory = path;  // Already in the hierarchy
+  } else if (!mount_point.empty()) {
+    size_t start = path.find_first_not_of('/');
+    directory = mount_point + "/" + (start == std::string::npos ? "" : path.substr(start));
+  }
+  if (directory.empty() || !is_directory(directory)) {
+    // Not found under the mount point, e.g., a cgroup of another cgroup v2 mount given by its absolute path
+    if (path.empty() || path[0] != '/' || !is_directory(path)) {
+      std::cerr << "Error: cgroup " << path << " not found"
+                << (mount_point.empty() ? " (no perf_event cgroup hierarchy is mounted)" : " under " + mount_point) << std::endl;
+      return -1;
+    }
+    directory = path;
+  }
+
+  // Only a cgroup v2 directory or a directory of the cgroup v1 hierarchy with the perf_event controller can be given to perf.
+  // Any cgroup v1 hierarchy has the same magic, so a v1 directory must be under the perf_event mount point.
+  struct statfs fs;
+  if (statfs(directory.c_str(), &fs) != 0) {
+    std::cerr << "Error: Failed to stat cgroup " << directory << ": " << strerror(errno) << std::endl;
+    return -1;
+  }
+  const bool is_cgroup2 = (fs.f_type == CGROUP2_SUPER_MAGIC);
+  const bool is_perf_cgroup1 = (fs.f_type == CGROUP_SUPER_MAGIC && !mount_point.empty() && is_under(directory, mount_point));
+  if (!is_cgroup2 && !is_perf_cgroup1) {
+    std::cerr << "Error: " << directory << " is not a cgroup of perf (a cgroup v2 directory, or of the cgroup v1 hierarchy "
+              << "with the perf_event controller)" << std::endl;
+    return -1;
+  }
+
+  int fd = open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    std::cerr << "Error: Failed to open cgroup " << directory << ": " << strerror(errno) << std::endl;
+  }
+  return fd;
+}
@@ -0,0 +1,70 @@
+#include "hperf/core_type_layouts.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+CoreTypeLayouts::CoreTypeLayouts(const PMUConfig &pmu_config) : merged_config_(pmu_config) {
+  core_types_.push_back({0, {}, pmu_config, 0});
+}
+
+void CoreTypeLayouts::regroup(const std::vector<int> &cpu_ids, const std::vector<int> &counter_nums, const GroupingFunction &grouping) {
+  // Always start from the original groups, not from the groups of an earlier regroup()
+  const PMUConfig original = core_types_.front().pmu_config;
+  const size_t fixed_event_num = original.get_fixed_events().size();
+
+  std::map<int, std::vector<int>> cpus_by_counter_num;  // Ordered by the number of counters
+  for (size_t i = 0; i < cpu_ids.size() && i < counter_nums.size(); ++i) {
+    cpus_by_counter_num[counter_nums[i]].push_back(cpu_ids[i]);
+  }
+  if (cpus_by_counter_num.empty()) return;
+
+  std::vector<CoreType> core_types;
+  size_t group_id_base = 0;
+  for (const auto &entry : cpus_by_counter_num) {
+    CoreType core_type = {entry.first, entry.second, original, group_id_base};
+    if (cpus_by_counter_num.size() > 1) {
+      std::cout << "Core type " << core_types.size() + 1 << " (" << entry.first << " programmable counters, CPU ";
+      for (size_t i = 0; i < entry.second.size(); ++i) {
+        std::cout << entry.second[i] << (i + 1 < entry.second.size() ? ", " : ")\n");
+      }
+    }
+    size_t programmable_counters_num = (entry.first > (int)fixed_event_num) ? entry.first - fixed_event_num : 0;
+    grouping(core_type.pmu_config, programmable_counters_num, entry.second);
+    group_id_base += core_type.pmu_config.get_event_group_num();
+    core_types.push_back(std::move(core_type));
+  }
+
+  core_types_ = std::move(core_types);
+  merged_config_ = core_types_.front().pmu_config;
+  for (size_t k = 1; k < core_types_.size(); ++k) {
+    merged_config_.append_event_groups(core_types_[k].pmu_config);
+  }
+}
+
+size_t CoreTypeLayouts::get_core_type_idx(int cpu_id) const {
+  for (size_t k = 0; k < core_types_.size(); ++k) {
+    const auto &cpu_ids = core_types_[k].cpu_ids;
+    if (std::find(cpu_ids.begin(), cpu_ids.end(), cpu_id) != cpu_ids.end()) return k;
+  }
+  return 0;
+}
+
+void CoreTypeLayouts::print_event_groups() const {
+  for (size_t k = 0; k < core_types_.size(); ++k) {
+    const auto &core_type = core_types_[k];
+    if (core_types_.size() > 1) {
+      std::cout << "Core type " << k + 1 << " (" << core_type.counter_num << " programmable counters, "
+                << core_type.pmu_config.get_event_group_num() << " event groups):" << std::endl;
+    }
+    for (size_t i = 0; i < core_type.pmu_config.get_event_group_num(); ++i) {
+      const auto &event_group = core_type.pmu_config.get_event_group_by_idx(i);
+      std::cout << "[" << core_type.group_id_base + i << "]: { ";
+      for (size_t j = 0; j < event_group.size(); ++j) {
+        std::cout << event_group[j].name;
+        if (j < event_group.size() - 1) std::cout << ", ";
+      }
+      std::cout << " }" << std::endl;
+    }
+  }
+}
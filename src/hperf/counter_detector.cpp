@@ -8,88 +8,113 @@
 #include <cstdint>
 #include <cstring>
 #include <algorithm>
-#include <fstream>
 #include <iostream>
 #include <ostream>
+#include <thread>
 
 #include "hperf/read_buffer.h"
 
+// The time each probe counts its events. The events that do not fit in the counters are never scheduled
+// (or only after a rotation), so a short window is enough to see time_running < time_enabled.
+#define PROBE_WINDOW_US 20000
+
 CounterDetector::CounterDetector()
     : detected_(false),
-      fds_(),
       cpu_num_(sysconf(_SC_NPROCESSORS_ONLN)),
       detected_general_counter_nums_(cpu_num_, -1) {}
 
-CounterDetector::~CounterDetector() {
-  close_all_events();
-}
+CounterDetector::~CounterDetector() {}
 
 void CounterDetector::detect() {
-  if (load_detected_result()) {
-    return;
+  // The CPUs are independent, probe them all at the same time
+  std::vector<std::thread> threads;
+  for (uint64_t cpu_id = 0; cpu_id < cpu_num_; ++cpu_id) {
+    threads.emplace_back([this, cpu_id] { detected_general_counter_nums_[cpu_id] = detect_on_cpu(cpu_id); });
   }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  detected_ = true;
+}
 
-  for (uint64_t cpu_id = 0; cpu_id < cpu_num_; ++cpu_id) {  // for each CPU
-    // Stress test: guadually increase the number of events (up to 32), and see when multiplexing is triggered:
-    for (uint64_t event_num = 1; event_num < event_list.size(); ++event_num) {
-      if (!test(cpu_id, event_num)) {  // if multiplexing is triggered
-        detected_general_counter_nums_[cpu_id] = event_num - 1;
-        break;  // stop stress test on this CPU
-      }
+int CounterDetector::detect_on_cpu(uint64_t cpu_id) {
+  // Multiplexing is monotonic in the number of events: search the largest number of events that fit.
+  // Invariant: `fit` events fit, `multiplexed` events trigger multiplexing.
+  uint64_t fit = 0;
+  uint64_t multiplexed = event_list.size();
+  if (test(cpu_id, multiplexed) != ProbeResult::MULTIPLEXED) {
+    return -1;  // A probe failed, or there are more counters than events to test with
+  }
+
+  while (multiplexed - fit > 1) {
+    uint64_t event_num = fit + (multiplexed - fit) / 2;
+    switch (test(cpu_id, event_num)) {
+      case ProbeResult::FIT:
+        fit = event_num;
+        break;
+      case ProbeResult::MULTIPLEXED:
+        multiplexed = event_num;
+        break;
+      case ProbeResult::FAILED:
+        return -1;
     }
-    close_all_events();
-    fds_.clear();
   }
-  detected_ = true;
-  save_detected_result();
+  return fit;
 }
 
-bool CounterDetector::test(uint64_t cpu_id, uint64_t event_num) {
-  // Ensure fds_ has enough capacity for event_num events
-  while (fds_.size() < event_num) {
+CounterDetector::ProbeResult CounterDetector::test(uint64_t cpu_id, uint64_t event_num) {
+  std::vector<int> fds;
+  for (uint64_t i = 0; i < event_num; ++i) {
     struct perf_event_attr pe;
-    configure_event(&pe, event_list[fds_.size()].second);
+    configure_event(&pe, event_list[i].second);
     int fd = perf_event_open(&pe, cpu_id);
     if (fd == -1) {
-      std::cerr << "Failed to create event " << event_list[fds_.size()].first << " on CPU " << cpu_id << std::endl;
-      return false;
+      std::cerr << "Failed to create event " << event_list[i].first << " on CPU " << cpu_id << std::endl;
+      close_all_events(fds);
+      return ProbeResult::FAILED;
     }
-    fds_.push_back(fd);
+    fds.push_back(fd);
   }
 
   // Enable all events and check for multiplexing
-  if (!enable_all_events()) {
-    return false;
+  if (!enable_all_events(fds)) {
+    close_all_events(fds);
+    return ProbeResult::FAILED;
   }
 
-  usleep(100000);  // Sleep for 100ms
+  usleep(PROBE_WINDOW_US);
 
-  if (!disable_all_events()) {
-    return false;
+  if (!disable_all_events(fds)) {
+    close_all_events(fds);
+    return ProbeResult::FAILED;
   }
 
   // Read and check if multiplexing occurred
+  ProbeResult result = ProbeResult::FIT;
   SingleReadBuffer buffer;
-  for (int fd : fds_) {
+  for (int fd : fds) {
     ssize_t bytes_read = read(fd, buffer.data(), buffer.size());
     if (bytes_read == -1) {
       std::cerr << "Failed to read data for event: " << strerror(errno) << std::endl;
-      return false;
+      result = ProbeResult::FAILED;
+      break;
     } else if (static_cast<size_t>(bytes_read) != buffer.size()) {
       std::cerr << "Warning: Read " << bytes_read << " bytes, expected " << buffer.size() << std::endl;
     } else {
       if (buffer.time_enabled() != buffer.time_running()) {  // Multiplexing detected
-        return false;
+        result = ProbeResult::MULTIPLEXED;
+        break;
       }
     }
   }
 
-  // For all events, time_enabled == time_running, return true
-  return true;
+  // For all events, time_enabled == time_running: FIT
+  close_all_events(fds);
+  return result;
 }
 
-bool CounterDetector::enable_all_events() {
-  for (const int fd : fds_) {
+bool CounterDetector::enable_all_events(const std::vector<int> &fds) {
+  for (const int fd : fds) {
     if (ioctl(fd, PERF_EVENT_IOC_ENABLE, 0) == -1) {
       std::cerr << "Failed to enable event: " << strerror(errno) << std::endl;
       return false;
@@ -98,8 +123,8 @@ bool CounterDetector::enable_all_events() {
   return true;
 }
 
-bool CounterDetector::disable_all_events() {
-  for (const int fd : fds_) {
+bool CounterDetector::disable_all_events(const std::vector<int> &fds) {
+  for (const int fd : fds) {
     if (ioctl(fd, PERF_EVENT_IOC_DISABLE, 0) == -1) {
       std::cerr << "Failed to disable event: " << strerror(errno) << std::endl;
       return false;
@@ -108,8 +133,8 @@ bool CounterDetector::disable_all_events() {
   return true;
 }
 
-void CounterDetector::close_all_events() {
-  for (int fd : fds_) {
+void CounterDetector::close_all_events(const std::vector<int> &fds) {
+  for (int fd : fds) {
     if (fd != -1) {
       close(fd);
     }
@@ -172,42 +197,3 @@ int CounterDetector::perf_event_open(struct perf_event_attr *pe,
   }
   return fd;
 }
-
-void CounterDetector::save_detected_result() const {
-  std::ofstream outfile("/tmp/.hperf");
-  if (!outfile.is_open()) {
-    std::cerr << "Failed to create /tmp/.hperf" << std::endl;
-    return;
-  }
-
-  for (const auto& counter_num : detected_general_counter_nums_) {
-    outfile << counter_num << std::endl;
-  }
-
-  outfile.close();
-}
-
-bool CounterDetector::load_detected_result() {
-  std::ifstream infile("/tmp/.hperf");
-  if (!infile.is_open()) {
-    return false;
-  }
-
-  detected_general_counter_nums_.clear();
-  int counter_num;
-  while (infile >> counter_num) {
-    detected_general_counter_nums_.push_back(counter_num);
-  }
-
-  infile.close();
-  
-  if (detected_general_counter_nums_.size() == cpu_num_) {
-    detected_ = true;
-    return true;
-  }
-  
-  detected_general_counter_nums_.clear();
-  detected_general_counter_nums_.resize(cpu_num_, -1);
-  return false;
-}
-
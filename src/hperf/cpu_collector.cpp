@@ -0,0 +1,218 @@
+#include "hperf/cpu_collector.h"
+
+#include <sched.h>  // for sched_setaffinity, CPU_SET
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "hperf/event_scheduler.h"
+#include "hperf/phase_detector.h"
+#include "hperf/scheduling_policy.h"
+
+// Records of a few intervals are buffered in each queue before the producer has to wait for the main thread
+#define RECORD_QUEUE_CAPACITY 1024
+
+PerCpuCollector::PerCpuCollector(const CoreTypeLayouts &core_type_layouts, const ProfileConfig &config)
+    : core_type_layouts_(core_type_layouts),
+      config_(config),
+      ready_num_(0),
+      failed_num_(0),
+      released_(false),
+      aborted_(false),
+      start_timestamp_(0) {
+  for (const auto cpu : config_.cpu_id_list) {
+    workers_.push_back(std::make_unique<Worker>(cpu, RECORD_QUEUE_CAPACITY, config_.switch_group_interval * 1000000ULL));
+  }
+}
+
+PerCpuCollector::~PerCpuCollector() {
+  {
+    // Make sure no thread is left blocked on the barrier
+    std::lock_guard<std::mutex> lock(barrier_mutex_);
+    if (!released_) {
+      aborted_ = true;
+      released_ = true;
+    }
+  }
+  barrier_cv_.notify_all();
+  for (auto &worker : workers_) {
+    if (worker->thread.joinable()) worker->thread.join();
+  }
+}
+
+bool PerCpuCollector::pin_to_cpu(int cpu_id) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu_id, &cpu_set);
+  // pid 0 means the calling thread
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == -1) {
+    std::cerr << "Failed to pin the collector thread to CPU " << cpu_id << ": " << strerror(errno) << "\n";
+    return false;
+  }
+  return true;
+}
+
+bool PerCpuCollector::arrive_and_wait(bool ok) {
+  std::unique_lock<std::mutex> lock(barrier_mutex_);
+  ++ready_num_;
+  if (!ok) ++failed_num_;
+  barrier_cv_.notify_all();
+  barrier_cv_.wait(lock, [this] { return released_; });
+  return !aborted_;
+}
+
+void PerCpuCollector::collect(Worker &worker) {
+  const int cpu = worker.cpu_id;
+
+  bool ok = pin_to_cpu(cpu);
+
+  // The event scheduler is created on the pinned thread and never leaves it.
+  // It counts the groups of the core type of this CPU, the records carry the global group ids.
+  const auto &core_type = core_type_layouts_.get_core_type(cpu);
+  const PMUConfig &pmu_config = core_type.pmu_config;
+  EventScheduler event_scheduler(pmu_config, -1, cpu);
+  event_scheduler.set_delta_mode(config_.delta_counting);
+  event_scheduler.set_scheduling_policy(create_scheduling_policy(config_.schedule, pmu_config));
+  if (ok && !event_scheduler.initialize()) {
+    std::cerr << "Fail to initialize the event scheduler on CPU " << cpu << "\n";
+    ok = false;
+  }
+  if (ok && !event_scheduler.reset_all_groups()) {
+    std::cerr << "Fail to reset counters on CPU " << cpu << "\n";
+    ok = false;
+  }
+
+  if (!arrive_and_wait(ok)) {
+    worker.finished.store(true, std::memory_order_release);
+    return;
+  }
+
+  const auto start = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(start_timestamp_));
+  const auto end = start + std::chrono::seconds(config_.test_duration);
+
+  if (!event_scheduler.enable_active_group()) {
+    std::cerr << "Fail to enable counters on CPU " << cpu << "\n";
+    worker.finished.store(true, std::memory_order_release);
+    return;
+  }
+
+  // All threads share the same start time, so their switch boundaries stay aligned on the same grid
+  // (until a phase change shortens the interval of this CPU)
+  worker.interval_timer.start(start_timestamp_);
+  PhaseDetector phase_detector(pmu_config.get_fixed_events().size());
+  FastRotationWindow fast_rotation(worker.interval_timer, pmu_config.get_event_group_num());
+  while (std::chrono::steady_clock::now() < end) {
+    uint64_t current_timestamp = worker.interval_timer.wait_for_next_boundary();
+    if (event_scheduler.read_active_group_data() > 0) {
+      const auto &buffer = event_scheduler.get_active_group_read_buffer();
+      for (uint64_t j = 0; j < buffer.nr(); ++j) {
+        Record record = {
+            current_timestamp - start_timestamp_,
+            cpu,
+            static_cast<int>(core_type.group_id_base) + event_scheduler.get_active_group_idx(),
+            j,
+            buffer.entry(j)->value,
+            buffer.time_enabled(),
+            buffer.time_running()};
+        push_record(worker, record);
+      }
+
+      if (config_.phase_detect) {
+        bool phase_changed = phase_detector.observe(buffer);
+        fast_rotation.mark_read(0, event_scheduler.get_active_group_idx(), event_scheduler.get_num_event_groups());
+        fast_rotation.update(phase_changed);
+        if (phase_changed) {
+          Record marker = {current_timestamp - start_timestamp_, cpu, PHASE_BOUNDARY_GROUP_ID, 0, fast_rotation.get_period(), 0, 0};
+          push_record(worker, marker);
+        }
+      }
+    } else {
+      std::cerr << "Fail to read event counts on CPU " << cpu << ": " << strerror(errno) << "\n";
+    }
+
+    if (!event_scheduler.switch_to_next_group()) {
+      std::cerr << "Warning: Failed to properly switch event group on CPU " << cpu << std::endl;
+    }
+  }
+
+  if (!event_scheduler.disable_active_group()) {
+    std::cerr << "Fail to stop counters on CPU " << cpu << "\n";
+  }
+
+  worker.finished.store(true, std::memory_order_release);
+}
+
+void PerCpuCollector::push_record(Worker &worker, const Record &record) {
+  while (!worker.queue.try_push(record)) {  // The main thread falls behind, wait for it
+    ++worker.queue_full_spins;
+    std::this_thread::yield();
+  }
+}
+
+size_t PerCpuCollector::drain(Reporter &reporter, TraceWriter &trace_writer) {
+  size_t drained = 0;
+  Record record;
+  for (auto &worker : workers_) {
+    while (worker->queue.try_pop(record)) {
+      reporter.process_a_record(record);
+      trace_writer.write_record(record);
+      ++drained;
+    }
+  }
+  return drained;
+}
+
+bool PerCpuCollector::run(Reporter &reporter, TraceWriter &trace_writer) {
+  for (auto &worker : workers_) {
+    Worker *w = worker.get();
+    w->thread = std::thread([this, w] { collect(*w); });
+  }
+
+  // Wait until every collector thread has created its event groups
+  {
+    std::unique_lock<std::mutex> lock(barrier_mutex_);
+    barrier_cv_.wait(lock, [this] { return ready_num_ == workers_.size(); });
+    if (failed_num_ > 0) {
+      aborted_ = true;
+    } else {
+      start_timestamp_ = IntervalTimer::now();
+    }
+    released_ = true;
+  }
+  barrier_cv_.notify_all();
+
+  if (aborted_) {
+    for (auto &worker : workers_) worker->thread.join();
+    return false;  // stop measurement
+  }
+
+  std::cout << "System-wide (per-CPU threads): collecting data...\n";
+
+  const auto poll_interval = std::chrono::milliseconds(std::max(1, config_.switch_group_interval / 2));
+  while (true) {
+    // Check the flags before draining, so that no record pushed before finishing is missed
+    bool all_finished = std::all_of(workers_.begin(), workers_.end(), [](const auto &worker) {
+      return worker->finished.load(std::memory_order_acquire);
+    });
+    size_t drained = drain(reporter, trace_writer);
+    if (all_finished) break;
+    if (drained == 0) std::this_thread::sleep_for(poll_interval);
+  }
+
+  IntervalTimer all_timers(config_.switch_group_interval * 1000000ULL);
+  for (auto &worker : workers_) {
+    worker->thread.join();
+    all_timers.merge_stats(worker->interval_timer);
+    if (worker->queue_full_spins > 0) {
+      std::cerr << "Warning: Record queue of CPU " << worker->cpu_id << " was full "
+                << worker->queue_full_spins << " times\n";
+    }
+  }
+
+  std::cout << "System-wide (per-CPU threads): data collection finished" << std::endl;
+  all_timers.print_jitter_stats(std::cout);
+  return true;
+}
@@ -0,0 +1,36 @@
+#include "hperf/cpu_topology.h"
+
+#include <fstream>
+
+static int read_topology_value(int cpu_id, const char *name) {
+  std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu_id) + "/topology/" + name);
+  int value = -1;
+  if (!(file >> value)) {
+    return -1;
+  }
+  return value;
+}
+
+CpuTopology read_cpu_topology(int cpu_id) {
+  CpuTopology topology;
+  topology.cpu_id = cpu_id;
+  topology.core_id = read_topology_value(cpu_id, "core_id");
+  topology.cluster_id = read_topology_value(cpu_id, "cluster_id");
+  topology.package_id = read_topology_value(cpu_id, "physical_package_id");
+  return topology;
+}
+
+bool parse_topology_level(const std::string &name, TopologyLevel &level) {
+  if (name == "cpu") {
+    level = TopologyLevel::CPU;
+  } else if (name == "core") {
+    level = TopologyLevel::CORE;
+  } else if (name == "cluster") {
+    level = TopologyLevel::CLUSTER;
+  } else if (name == "package") {
+    level = TopologyLevel::PACKAGE;
+  } else {
+    return false;
+  }
+  return true;
+}
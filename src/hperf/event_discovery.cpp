@@ -0,0 +1,439 @@
+#include "hperf/event_discovery.h"
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "hperf/cache_dir.h"
+#include "hperf/file_utils.h"
+#include "hperf/json_parser.h"
+#include "hperf/pmu_probe.h"
+
+// The prefix of the resolved event files in the cache directory, a file per hardware fingerprint and event file content
+#define EVENT_CACHE_PREFIX "events-"
+
+namespace {
+
+std::vector<std::string> list_dir(const std::string &path) {
+  std::vector<std::string> entries;
+  DIR *dir = opendir(path.c_str());
+  if (dir == nullptr) return entries;
+  while (struct dirent *entry = readdir(dir)) {
+    if (entry->d_name[0] != '.') entries.push_back(entry->d_name);
+  }
+  closedir(dir);
+  std::sort(entries.begin(), entries.end());  // readdir() has no order, keep the result stable
+  return entries;
+}
+
+std::string to_lower(std::string text) {
+  std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+  return text;
+}
+
+bool parse_uint64(const std::string &text, uint64_t &value) {
+  if (text.empty()) return false;
+  char *end = nullptr;
+  value = std::strtoull(text.c_str(), &end, 0);
+  return *end == '\0';
+}
+
+/**
+ * @brief A number, or a string of a number (e.g., "0x11") as in the pmu-events files
+ */
+bool parse_uint64(const JsonValue &json, uint64_t &value) {
+  if (json.type == JsonValue::Type::NUMBER && json.number >= 0) {
+    value = static_cast<uint64_t>(json.number);
+    return true;
+  }
+  return json.type == JsonValue::Type::STRING && parse_uint64(json.string, value);
+}
+
+using BitRanges = std::vector<std::pair<int, int>>;  // [low, high] bits of perf_event_attr.config
+
+/**
+ * @brief Parse a format file, e.g., "config:0-7,21", ranges of other fields (config1, config2) are not supported
+ */
+bool parse_format(const std::string &text, BitRanges &ranges) {
+  auto colon = text.find(':');
+  if (colon == std::string::npos || text.substr(0, colon) != "config") return false;
+  std::stringstream fields(text.substr(colon + 1));
+  std::string field;
+  while (std::getline(fields, field, ',')) {
+    auto dash = field.find('-');
+    int low = std::atoi(field.c_str());
+    int high = (dash == std::string::npos) ? low : std::atoi(field.c_str() + dash + 1);
+    if (low < 0 || high < low || high > 63) return false;
+    ranges.push_back({low, high});
+  }
+  return !ranges.empty();
+}
+
+/**
+ * @brief Encode an event file (e.g., "event=0x3c,umask=0x01,edge") by the formats of its PMU
+ */
+bool encode_event(const std::string &text, const std::map<std::string, BitRanges> &formats, uint64_t &config) {
+  config = 0;
+  std::stringstream terms(text);
+  std::string term;
+  while (std::getline(terms, term, ',')) {
+    auto equal = term.find('=');
+    std::string name = term.substr(0, equal);
+    uint64_t value = 1;  // A term without a value is a flag
+    if (equal != std::string::npos && !parse_uint64(term.substr(equal + 1), value)) return false;  // e.g., "?"
+    auto it = formats.find(name);
+    if (it == formats.end()) return false;
+    for (const auto &range : it->second) {
+      int width = range.second - range.first + 1;
+      uint64_t mask = (width >= 64) ? ~0ULL : ((1ULL << width) - 1);
+      config |= (value & mask) << range.first;
+      value = (width >= 64) ? 0 : (value >> width);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Parse the "Counter" field of a pmu-events entry, e.g., "0,1,2,3", the fixed counters are ignored
+ */
+uint64_t parse_counter_mask(const JsonValue &json) {
+  if (json.type == JsonValue::Type::NUMBER) return (json.number >= 0 && json.number < 64) ? (1ULL << (int)json.number) : 0;
+  if (json.type != JsonValue::Type::STRING) return 0;
+  uint64_t mask = 0;
+  std::stringstream counters(json.string);
+  std::string counter;
+  while (std::getline(counters, counter, ',')) {
+    uint64_t idx;
+    counter.erase(0, counter.find_first_not_of(' '));
+    if (parse_uint64(counter, idx) && idx < 64) mask |= 1ULL << idx;
+  }
+  return mask;
+}
+
+/**
+ * @brief A core PMU has a `cpus` file (Arm PMUs, x86 hybrid "cpu_core" / "cpu_atom") or is named "cpu" (x86)
+ */
+bool is_core_pmu(const std::string &pmu, const std::string &sysfs_root) {
+  return pmu == "cpu" || access((sysfs_root + "/" + pmu + "/cpus").c_str(), F_OK) == 0;
+}
+
+/**
+ * @brief An uncore PMU (e.g., "arm_cmn_0", "uncore_imc_0") counts on the CPUs of its `cpumask` file and cannot count a task,
+ * unlike a core PMU or a PMU of the kernel without a cpumask ("software", "tracepoint", ...)
+ */
+bool is_uncore_pmu(const std::string &pmu, const std::string &sysfs_root) {
+  return !is_core_pmu(pmu, sysfs_root) && access((sysfs_root + "/" + pmu + "/cpumask").c_str(), F_OK) == 0;
+}
+
+/**
+ * @brief The events defined in the "events" member of the event file, keyed by lowercase name,
+ * and the PMU of each event of an uncore PMU
+ */
+bool read_defined_events(const JsonValue &json, const std::string &sysfs_root, std::map<std::string, PMUEvent> &events,
+                         std::map<std::string, std::string> &uncore_pmus) {
+  if (json.type != JsonValue::Type::ARRAY) {
+    std::cerr << "Error: \"events\" must be an array." << std::endl;
+    return false;
+  }
+  for (const auto &entry : json.elements) {
+    PMUEvent event{};
+    std::string error;
+    if (!parse_pmu_event(entry, event, error)) {
+      std::cerr << "Error: " << error << std::endl;
+      return false;
+    }
+    if (const JsonValue *field = entry.find("PMU")) {
+      int type = read_pmu_type(field->string, sysfs_root);
+      if (type < 0) {
+        std::cerr << "Error: PMU " << field->string << " of event " << event.name << " is not found in " << sysfs_root << "." << std::endl;
+        return false;
+      }
+      event.type = type;
+      if (is_uncore_pmu(field->string, sysfs_root)) uncore_pmus[to_lower(event.name)] = field->string;
+    }
+    events[to_lower(event.name)] = event;
+  }
+  return true;
+}
+
+/**
+ * @brief Resolve an event name of "fixed_events" or "event_groups", keeping the name as written in the file for the metrics
+ */
+bool resolve_event(const JsonValue &json, const std::map<std::string, PMUEvent> &defined_events,
+                   const std::map<std::string, std::string> &uncore_pmus, const std::map<std::string, PMUEvent> &sysfs_events,
+                   const std::set<std::string> &ambiguous_events, PMUEvent &event) {
+  if (json.type != JsonValue::Type::STRING) {
+    std::cerr << "Error: An event in \"fixed_events\" or \"event_groups\" must be a name." << std::endl;
+    return false;
+  }
+  const std::string key = to_lower(json.string);
+  // The groups are led by a core event and opened per task or per CPU, the kernel rejects a group mixing PMUs,
+  // and an uncore PMU cannot count a task
+  auto uncore = uncore_pmus.find(key);
+  if (uncore != uncore_pmus.end()) {
+    std::cerr << "Error: Event " << json.string << " of the uncore PMU " << uncore->second
+              << " cannot be counted in \"fixed_events\" or \"event_groups\", only core PMU events can." << std::endl;
+    return false;
+  }
+  auto it = defined_events.find(key);
+  if (it == defined_events.end()) {
+    it = sysfs_events.find(key);
+    if (ambiguous_events.count(key) > 0) {
+      std::cerr << "Error: Event " << json.string << " is exported by several core PMUs with different encodings, "
+                << "define it in \"events\" with the \"PMU\" of each core type." << std::endl;
+      return false;
+    }
+    if (it == sysfs_events.end()) {
+      std::cerr << "Error: Event " << json.string << " is neither defined in the event file nor exported by the PMU driver." << std::endl;
+      return false;
+    }
+  }
+  event = it->second;
+  event.name = json.string;
+  return true;
+}
+
+bool parse_event_file(const std::string &text, const std::string &sysfs_root, EventFileConfig &config) {
+  JsonValue json;
+  std::string error;
+  if (!parse_json(text, json, error)) {
+    std::cerr << "Error: Failed to parse the event file: " << error << std::endl;
+    return false;
+  }
+  const JsonValue *fixed_events = json.find("fixed_events");
+  const JsonValue *event_groups = json.find("event_groups");
+  if (fixed_events == nullptr || fixed_events->type != JsonValue::Type::ARRAY ||
+      event_groups == nullptr || event_groups->type != JsonValue::Type::ARRAY) {
+    std::cerr << "Error: The event file needs the arrays \"fixed_events\" and \"event_groups\"." << std::endl;
+    return false;
+  }
+
+  std::map<std::string, PMUEvent> defined_events;
+  std::map<std::string, std::string> uncore_pmus;
+  if (const JsonValue *events = json.find("events")) {
+    if (!read_defined_events(*events, sysfs_root, defined_events, uncore_pmus)) return false;
+  }
+  std::set<std::string> ambiguous_events;
+  const auto sysfs_events = read_sysfs_events(sysfs_root, &ambiguous_events);
+
+  config = EventFileConfig();
+  for (const auto &name : fixed_events->elements) {
+    config.fixed_events.emplace_back();
+    if (!resolve_event(name, defined_events, uncore_pmus, sysfs_events, ambiguous_events, config.fixed_events.back())) return false;
+  }
+  for (const auto &group : event_groups->elements) {
+    if (group.type != JsonValue::Type::ARRAY) {
+      std::cerr << "Error: An event group must be an array of event names." << std::endl;
+      return false;
+    }
+    config.event_groups.emplace_back();
+    for (const auto &name : group.elements) {
+      config.event_groups.back().emplace_back();
+      PMUEvent &event = config.event_groups.back().back();
+      if (!resolve_event(name, defined_events, uncore_pmus, sysfs_events, ambiguous_events, event)) return false;
+    }
+  }
+
+  if (const JsonValue *metrics = json.find("metrics")) {
+    if (metrics->type == JsonValue::Type::STRING) {
+      config.metric_definitions = metrics->string;
+    } else {
+      for (const auto &line : metrics->elements) config.metric_definitions += line.string + "\n";
+    }
+  }
+  return true;
+}
+
+std::vector<std::string> split_tabs(const std::string &line) {
+  std::vector<std::string> fields;
+  std::stringstream stream(line);
+  std::string field;
+  while (std::getline(stream, field, '\t')) fields.push_back(field);
+  if (!line.empty() && line.back() == '\t') fields.push_back("");  // An empty description
+  return fields;
+}
+
+/**
+ * @brief Load the resolved events, the fields of an event line are separated by tabs, so the names and descriptions may contain spaces.
+ * Any malformed line makes the whole cache a miss.
+ */
+bool load_cache(const std::string &path, const std::string &key, EventFileConfig &config) {
+  std::ifstream infile(path);
+  std::string line;
+  if (!std::getline(infile, line) || line != "key " + key) return false;  // Another file with the same hash
+
+  EventFileConfig cached;
+  while (std::getline(infile, line)) {
+    if (line.compare(0, 7, "metric\t") == 0) {  // The rest of the line as is
+      cached.metric_definitions += line.substr(7) + "\n";
+      continue;
+    }
+    const auto fields = split_tabs(line);
+    const std::string &tag = fields.empty() ? line : fields[0];
+    if (tag == "group" && fields.size() == 1) {
+      cached.event_groups.emplace_back();
+    } else if ((tag == "fixed" || tag == "event") && fields.size() == 6) {
+      PMUEvent event{};
+      uint64_t type;
+      if (!parse_uint64(fields[1], type) || type > UINT32_MAX || !parse_uint64(fields[2], event.encoding) ||
+          !parse_uint64(fields[3], event.counter_mask)) {
+        return false;
+      }
+      event.type = static_cast<uint32_t>(type);
+      event.name = fields[4];
+      event.description = fields[5];
+      if (tag == "fixed") {
+        cached.fixed_events.push_back(event);
+      } else if (!cached.event_groups.empty()) {
+        cached.event_groups.back().push_back(event);
+      } else {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  config = std::move(cached);
+  return true;
+}
+
+void save_cache(const std::string &path, const std::string &key, const EventFileConfig &config) {
+  // A name or a description with a tab or a line break cannot be written as a field, such a file is parsed every time
+  auto is_field = [](const std::string &text) { return text.find_first_of("\t\n") == std::string::npos; };
+  auto is_writable = [&is_field](const PMUEvent &event) { return is_field(event.name) && is_field(event.description); };
+  if (!std::all_of(config.fixed_events.begin(), config.fixed_events.end(), is_writable)) return;
+  for (const auto &event_group : config.event_groups) {
+    if (!std::all_of(event_group.begin(), event_group.end(), is_writable)) return;
+  }
+
+  std::ofstream outfile(path);
+  if (!outfile.is_open()) return;  // Only the next run is slower
+
+  auto write_event = [&outfile](const char *tag, const PMUEvent &event) {
+    outfile << tag << "\t" << event.type << "\t0x" << std::hex << event.encoding << "\t0x" << event.counter_mask << std::dec
+            << "\t" << event.name << "\t" << event.description << "\n";
+  };
+  outfile << "key " << key << "\n";
+  for (const auto &event : config.fixed_events) write_event("fixed", event);
+  for (const auto &event_group : config.event_groups) {
+    outfile << "group\n";
+    for (const auto &event : event_group) write_event("event", event);
+  }
+  std::istringstream metrics(config.metric_definitions);
+  std::string line;
+  while (std::getline(metrics, line)) outfile << "metric\t" << line << "\n";
+}
+
+}  // namespace
+
+bool parse_pmu_event(const JsonValue &entry, PMUEvent &event, std::string &error) {
+  const JsonValue *name = entry.find("EventName");
+  const JsonValue *code = entry.find("EventCode");
+  event = PMUEvent{};
+  if (name == nullptr || name->type != JsonValue::Type::STRING || code == nullptr || !parse_uint64(*code, event.encoding)) {
+    error = "Each event needs an \"EventName\" and a numeric \"EventCode\".";
+    return false;
+  }
+  event.name = name->string;
+
+  if (const JsonValue *field = entry.find("UMask")) {
+    uint64_t umask;
+    if (!parse_uint64(*field, umask)) {
+      error = "Invalid \"UMask\" of event " + event.name + ".";
+      return false;
+    }
+    event.encoding |= umask << 8;
+  }
+  if (const JsonValue *field = entry.find("BriefDescription")) {
+    event.description = field->string;
+  } else if (const JsonValue *field = entry.find("PublicDescription")) {
+    event.description = field->string;
+  }
+  if (const JsonValue *field = entry.find("Counter")) {
+    event.counter_mask = parse_counter_mask(*field);
+  }
+  return true;
+}
+
+int read_pmu_type(const std::string &pmu, const std::string &sysfs_root) {
+  uint64_t type;
+  if (!parse_uint64(read_first_line(sysfs_root + "/" + pmu + "/type"), type)) return -1;
+  return static_cast<int>(type);
+}
+
+std::map<std::string, PMUEvent> read_sysfs_events(const std::string &sysfs_root, std::set<std::string> *ambiguous_events) {
+  std::map<std::string, PMUEvent> events;
+  std::map<std::string, std::string> pmu_of_event;
+  std::set<std::string> ambiguous;
+  for (const auto &pmu : list_dir(sysfs_root)) {
+    const std::string pmu_dir = sysfs_root + "/" + pmu;
+    if (!is_core_pmu(pmu, sysfs_root)) continue;
+    int type = read_pmu_type(pmu, sysfs_root);
+    if (type < 0) continue;
+
+    std::map<std::string, BitRanges> formats;
+    for (const auto &field : list_dir(pmu_dir + "/format")) {
+      BitRanges ranges;
+      if (parse_format(read_first_line(pmu_dir + "/format/" + field), ranges)) formats[field] = ranges;
+    }
+
+    for (const auto &name : list_dir(pmu_dir + "/events")) {
+      if (name.find('.') != std::string::npos) continue;  // e.g., "<event>.scale", "<event>.unit"
+      PMUEvent event{};
+      if (!encode_event(read_first_line(pmu_dir + "/events/" + name), formats, event.encoding)) continue;
+      event.name = name;
+      event.description = pmu + "/" + name + "/";
+      event.type = type;
+
+      const std::string key = to_lower(name);
+      if (ambiguous.count(key) > 0) continue;
+      auto it = events.find(key);
+      if (it == events.end()) {
+        events[key] = event;
+        pmu_of_event[key] = pmu;
+      } else if (pmu_of_event[key] != pmu) {
+        if (it->second.encoding == event.encoding) {
+          it->second.type = PERF_TYPE_RAW;  // The same event on several core PMUs, let the kernel pick the PMU of the CPU
+        } else {
+          // e.g., "cpu_core" and "cpu_atom" of x86 hybrid, a raw config would count another event on the other core type
+          events.erase(it);
+          ambiguous.insert(key);
+        }
+      }
+    }
+  }
+  if (ambiguous_events) *ambiguous_events = std::move(ambiguous);
+  return events;
+}
+
+bool load_event_file(const std::string &filename, EventFileConfig &config, const std::string &sysfs_root) {
+  std::ifstream infile(filename);
+  if (!infile.is_open()) {
+    std::cerr << "Error: Failed to open event file: " << filename << std::endl;
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << infile.rdbuf();
+  const std::string text = buffer.str();
+
+  // The events resolved from sysfs depend on the CPUs and the kernel, and the names on the file
+  std::ostringstream key;
+  key << read_hardware_fingerprint() << ";sysfs=" << sysfs_root << ";file=" << std::hex << fnv1a(text);
+  const std::string cache_dir = get_cache_dir();
+  std::ostringstream path;
+  path << cache_dir << "/" << EVENT_CACHE_PREFIX << std::hex << fnv1a(key.str());
+
+  if (!cache_dir.empty() && load_cache(path.str(), key.str(), config)) return true;
+  if (!parse_event_file(text, sysfs_root, config)) return false;
+  if (!cache_dir.empty()) save_cache(path.str(), key.str(), config);
+  return true;
+}
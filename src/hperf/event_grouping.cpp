@@ -0,0 +1,256 @@
+#include "hperf/event_grouping.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+int popcount(uint64_t mask) {
+  return __builtin_popcountll(mask);
+}
+
+/**
+ * @brief Kuhn's augmenting path: try to assign event `i` to a counter, moving the events already assigned if needed
+ */
+bool assign_counter(size_t i, const std::vector<uint64_t> &masks, size_t counter_num,
+                    std::vector<int> &counter_owner, std::vector<bool> &visited) {
+  for (size_t c = 0; c < counter_num; ++c) {
+    if (!(masks[i] & (1ULL << c)) || visited[c]) continue;
+    visited[c] = true;
+    if (counter_owner[c] == -1 || assign_counter(counter_owner[c], masks, counter_num, counter_owner, visited)) {
+      counter_owner[c] = static_cast<int>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Check if every event can be counted on a distinct counter allowed by its mask
+ */
+bool match_counters(const std::vector<uint64_t> &masks, size_t counter_num) {
+  if (masks.size() > counter_num) return false;
+  std::vector<int> counter_owner(counter_num, -1);
+  for (size_t i = 0; i < masks.size(); ++i) {
+    std::vector<bool> visited(counter_num, false);
+    if (!assign_counter(i, masks, counter_num, counter_owner, visited)) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+EventGroupingSolver::EventGroupingSolver(const std::vector<PMUEvent> &fixed_events, size_t counter_num, uint64_t node_limit)
+    : fixed_events_(fixed_events),
+      counter_num_(std::min<size_t>(counter_num, 64)),  // The counter masks have 64 bits
+      node_limit_(node_limit),
+      lower_bound_(0),
+      node_num_(0),
+      optimal_(false) {}
+
+uint64_t EventGroupingSolver::allowed_counters(const PMUEvent &event) const {
+  const uint64_t all = (counter_num_ >= 64) ? ~0ULL : ((1ULL << counter_num_) - 1);
+  return event.counter_mask == 0 ? all : (event.counter_mask & all);
+}
+
+bool EventGroupingSolver::fits(const std::vector<size_t> &bin, const std::vector<size_t> &extra) const {
+  for (size_t k = 0; k < extra.size(); ++k) {
+    for (size_t i : bin) {
+      if (conflicting_[extra[k]][i]) return false;
+    }
+    for (size_t l = 0; l < k; ++l) {
+      if (conflicting_[extra[k]][extra[l]]) return false;
+    }
+  }
+
+  std::vector<uint64_t> masks;
+  masks.reserve(fixed_events_.size() + bin.size() + extra.size());
+  for (const auto &event : fixed_events_) masks.push_back(allowed_counters(event));
+  for (size_t i : bin) masks.push_back(allowed_counters(events_[i]));
+  for (size_t i : extra) masks.push_back(allowed_counters(events_[i]));
+  return match_counters(masks, counter_num_);
+}
+
+std::vector<size_t> EventGroupingSolver::missing_events(const std::vector<size_t> &bin, const std::vector<size_t> &item) const {
+  std::vector<size_t> missing;
+  for (size_t i : item) {
+    if (std::find(bin.begin(), bin.end(), i) == bin.end()) missing.push_back(i);
+  }
+  return missing;
+}
+
+bool EventGroupingSolver::solve(const std::vector<PMUEvent> &events, const std::vector<std::vector<size_t>> &affinity_sets,
+                                std::vector<std::vector<PMUEvent>> &groups) {
+  node_num_ = 0;
+  optimal_ = false;
+  events_.clear();
+  items_.clear();
+  bins_.clear();
+  best_bins_.clear();
+  split_sets_.clear();
+
+  if (counter_num_ <= fixed_events_.size()) {
+    std::cerr << "Error: No counter is left for the schedulable events (" << counter_num_ << " counters, "
+              << fixed_events_.size() << " fixed events).\n";
+    return false;
+  }
+
+  // Distinct events by type and encoding, keeping the first occurrence
+  std::vector<size_t> distinct_idx(events.size());
+  for (size_t i = 0; i < events.size(); ++i) {
+    const EventKey key = get_event_key(events[i]);
+    auto it = std::find_if(events_.begin(), events_.end(), [&key](const PMUEvent &e) { return get_event_key(e) == key; });
+    distinct_idx[i] = it - events_.begin();
+    if (it == events_.end()) events_.push_back(events[i]);
+  }
+
+  conflicting_.assign(events_.size(), std::vector<bool>(events_.size(), false));
+  for (const auto &conflict : conflicts_) {
+    for (size_t i = 0; i < events_.size(); ++i) {
+      for (size_t j = 0; j < events_.size(); ++j) {
+        if (get_event_key(events_[i]) == conflict.first && get_event_key(events_[j]) == conflict.second) {
+          conflicting_[i][j] = conflicting_[j][i] = true;
+        }
+      }
+    }
+  }
+
+  for (size_t i = 0; i < events_.size(); ++i) {
+    if (!fits({}, {i})) {
+      std::cerr << "Error: Event " << events_[i].name << " cannot be counted together with the fixed events on "
+                << counter_num_ << " counters.\n";
+      return false;
+    }
+  }
+
+  // Items: the affinity sets that fit in a group, and every event not covered by them on its own
+  std::vector<bool> covered(events_.size(), false);
+  for (const auto &affinity_set : affinity_sets) {
+    std::vector<size_t> item;
+    for (size_t i : affinity_set) {
+      if (i < events.size() && std::find(item.begin(), item.end(), distinct_idx[i]) == item.end()) {
+        item.push_back(distinct_idx[i]);
+      }
+    }
+    if (item.empty() || !fits({}, item)) continue;  // Too large, its events are packed on their own
+    std::sort(item.begin(), item.end());
+    for (size_t i : item) covered[i] = true;
+    items_.push_back(item);
+  }
+  for (size_t i = 0; i < events_.size(); ++i) {
+    if (!covered[i]) items_.push_back({i});
+  }
+
+  // Visit the largest items first, then the most constrained ones (fewest allowed counters), ties by the input order
+  auto min_counters = [this](const std::vector<size_t> &item) {
+    int n = 64;
+    for (size_t i : item) n = std::min(n, popcount(allowed_counters(events_[i])));
+    return n;
+  };
+  std::stable_sort(items_.begin(), items_.end(), [&](const std::vector<size_t> &a, const std::vector<size_t> &b) {
+    if (a.size() != b.size()) return a.size() > b.size();
+    return min_counters(a) < min_counters(b);
+  });
+
+  // Lower bound: the number of counters left by the fixed events, and the events pinned to the same single counter
+  const size_t capacity = counter_num_ - fixed_events_.size();
+  lower_bound_ = events_.empty() ? 0 : (events_.size() + capacity - 1) / capacity;
+  std::vector<size_t> pinned(counter_num_, 0);
+  for (const auto &event : events_) {
+    uint64_t mask = allowed_counters(event);
+    if (popcount(mask) == 1) {
+      lower_bound_ = std::max(lower_bound_, ++pinned[__builtin_ctzll(mask)]);
+    }
+  }
+
+  // Upper bound: first-fit decreasing. An item only adds the events its group does not have yet,
+  // so the events shared by several items (e.g., a common denominator) are counted in several groups if that keeps the items whole.
+  for (const auto &item : items_) {
+    auto it = std::find_if(best_bins_.begin(), best_bins_.end(),
+                           [&](const std::vector<size_t> &bin) { return fits(bin, missing_events(bin, item)); });
+    if (it != best_bins_.end()) {
+      auto missing = missing_events(*it, item);
+      it->insert(it->end(), missing.begin(), missing.end());
+    } else {
+      best_bins_.push_back(item);
+    }
+  }
+
+  if (best_bins_.size() > lower_bound_) {
+    placed_num_.assign(events_.size(), 0);
+    search(0);
+  }
+  optimal_ = (best_bins_.size() == lower_bound_) || node_num_ <= node_limit_;
+
+  // Back to the input order: the events of a group, then the groups by their first event (events_ is in the input order)
+  for (auto &bin : best_bins_) {
+    std::sort(bin.begin(), bin.end());
+  }
+  std::sort(best_bins_.begin(), best_bins_.end());
+
+  groups.clear();
+  for (const auto &bin : best_bins_) {
+    groups.emplace_back();
+    for (size_t i : bin) groups.back().push_back(events_[i]);
+  }
+
+  // An affinity set is split if no group contains all its events
+  for (size_t s = 0; s < affinity_sets.size(); ++s) {
+    std::vector<size_t> item;
+    for (size_t i : affinity_sets[s]) {
+      if (i < events.size()) item.push_back(distinct_idx[i]);
+    }
+    bool together = std::any_of(best_bins_.begin(), best_bins_.end(),
+                                [&](const std::vector<size_t> &bin) { return missing_events(bin, item).empty(); });
+    if (!together) split_sets_.push_back(s);
+  }
+  return true;
+}
+
+void EventGroupingSolver::search(size_t k) {
+  if (++node_num_ > node_limit_) return;
+
+  if (k == items_.size()) {
+    if (bins_.size() < best_bins_.size()) best_bins_ = bins_;
+    return;
+  }
+
+  // Even if the events not placed yet fill every free counter, the open groups cannot hold them all
+  const size_t capacity = counter_num_ - fixed_events_.size();
+  size_t free_slots = 0;
+  for (const auto &bin : bins_) free_slots += capacity - bin.size();
+  size_t unplaced = 0;
+  for (size_t i = 0; i < events_.size(); ++i) unplaced += (placed_num_[i] == 0);
+  size_t extra_bins = (unplaced > free_slots) ? (unplaced - free_slots + capacity - 1) / capacity : 0;
+  if (bins_.size() + extra_bins >= best_bins_.size()) return;
+
+  const auto &item = items_[k];
+  for (const auto &bin : bins_) {
+    if (missing_events(bin, item).empty()) {
+      // Already whole in this group, no other choice can be better
+      search(k + 1);
+      return;
+    }
+  }
+
+  // By index: the deeper levels may append groups and reallocate bins_
+  for (size_t b = 0; b < bins_.size(); ++b) {
+    auto missing = missing_events(bins_[b], item);
+    if (bins_[b].size() + missing.size() > capacity || !fits(bins_[b], missing)) continue;
+    bins_[b].insert(bins_[b].end(), missing.begin(), missing.end());
+    for (size_t i : missing) ++placed_num_[i];
+    search(k + 1);
+    for (size_t i : missing) --placed_num_[i];
+    bins_[b].resize(bins_[b].size() - missing.size());
+    if (best_bins_.size() == lower_bound_ || node_num_ > node_limit_) return;
+  }
+
+  // Open a new group (only one, the empty groups are interchangeable)
+  if (bins_.size() + 1 < best_bins_.size()) {
+    bins_.push_back(item);
+    for (size_t i : item) ++placed_num_[i];
+    search(k + 1);
+    for (size_t i : item) --placed_num_[i];
+    bins_.pop_back();
+  }
+}
@@ -8,30 +8,52 @@
 
 #include "hperf/pmu_event.h"
 
-EventScheduler::EventScheduler(PMUConfig &pmu_config,
-                               pid_t target_pid,
-                               int target_cpu)
+// The data pages of the sample ring buffer of each scheduler (a power of 2), drained once per interval
+#define SAMPLE_RING_PAGES 64
+
+EventScheduler::EventScheduler(const PMUConfig &pmu_config,
+                                     pid_t target_pid,
+                                     int target_cpu)
     : fds_(),
-      pmu_config_(pmu_config),
+      pmu_config_(&pmu_config),
       target_pid_(target_pid),
       target_cpu_(target_cpu),
       active_group_idx_(0),
-      initialized_(false) {
-  size_t group_num = pmu_config_.get_event_group_num();
+      initialized_(false),
+      delta_mode_(false),
+      inherit_(false),
+      cgroup_fd_(-1),
+      sample_period_(0),
+      sample_callchain_(false),
+      scheduling_policy_(nullptr) {
+  size_t group_num = pmu_config_->get_event_group_num();
   read_buffers_.reserve(group_num);
   for (size_t i = 0; i < group_num; i++) {
-    read_buffers_.emplace_back(pmu_config_.get_fixed_events().size() + pmu_config_.get_event_group_by_idx(i).size());
+    read_buffers_.emplace_back(pmu_config_->get_fixed_events().size() + pmu_config_->get_event_group_by_idx(i).size());
   }
+  // All zeros: the counts and times of a newly created (disabled) group
+  prev_buffers_ = read_buffers_;
+  delta_buffers_ = read_buffers_;
 }
 
 EventScheduler::EventScheduler(EventScheduler &&other) noexcept
     : fds_(std::move(other.fds_)),
       read_buffers_(std::move(other.read_buffers_)),
+      prev_buffers_(std::move(other.prev_buffers_)),
+      delta_buffers_(std::move(other.delta_buffers_)),
       pmu_config_(other.pmu_config_),
       target_pid_(other.target_pid_),
       target_cpu_(other.target_cpu_),
       active_group_idx_(other.active_group_idx_),
-      initialized_(other.initialized_) {
+      initialized_(other.initialized_),
+      delta_mode_(other.delta_mode_),
+      inherit_(other.inherit_),
+      cgroup_fd_(other.cgroup_fd_),
+      sample_event_(std::move(other.sample_event_)),
+      sample_period_(other.sample_period_),
+      sample_callchain_(other.sample_callchain_),
+      sample_ring_(std::move(other.sample_ring_)),
+      scheduling_policy_(std::move(other.scheduling_policy_)) {
   other.initialized_ = false;
 }
 
@@ -41,11 +63,21 @@ EventScheduler &EventScheduler::operator=(EventScheduler &&other) noexcept {
 
     fds_ = std::move(other.fds_);
     read_buffers_ = std::move(other.read_buffers_);
+    prev_buffers_ = std::move(other.prev_buffers_);
+    delta_buffers_ = std::move(other.delta_buffers_);
     pmu_config_ = other.pmu_config_;
     target_pid_ = other.target_pid_;
     target_cpu_ = other.target_cpu_;
     active_group_idx_ = other.active_group_idx_;
     initialized_ = other.initialized_;
+    delta_mode_ = other.delta_mode_;
+    inherit_ = other.inherit_;
+    cgroup_fd_ = other.cgroup_fd_;
+    sample_event_ = std::move(other.sample_event_);
+    sample_period_ = other.sample_period_;
+    sample_callchain_ = other.sample_callchain_;
+    sample_ring_ = std::move(other.sample_ring_);
+    scheduling_policy_ = std::move(other.scheduling_policy_);
   }
   other.initialized_ = false;
   return *this;
@@ -56,6 +88,7 @@ EventScheduler::~EventScheduler() {
 }
 
 void EventScheduler::cleanup_fds() {
+  sample_ring_.unmap();  // Before its fd is closed
   for (const auto &group_fds : fds_) {
     for (int fd : group_fds) {
       if (fd != -1) {
@@ -66,6 +99,30 @@ void EventScheduler::cleanup_fds() {
   fds_.clear();
 }
 
+void EventScheduler::set_delta_mode(bool enable) {
+  delta_mode_ = enable;
+}
+
+void EventScheduler::set_inherit(bool enable) {
+  inherit_ = enable;
+  // RESET does not clear the counts and times summed from the exited children, they would be reported again in every read
+  if (enable) delta_mode_ = true;
+}
+
+void EventScheduler::set_cgroup(int cgroup_fd) {
+  cgroup_fd_ = cgroup_fd;
+}
+
+void EventScheduler::set_sampling(const std::string &event_name, uint64_t period, bool callchain) {
+  sample_event_ = event_name;
+  sample_period_ = period;
+  sample_callchain_ = callchain;
+}
+
+void EventScheduler::set_scheduling_policy(std::unique_ptr<SchedulingPolicy> policy) {
+  scheduling_policy_ = std::move(policy);
+}
+
 bool EventScheduler::initialize() {
   if (initialized_) {
     std::cerr << "Event Groups for PID " << target_pid_ << " and CPU "
@@ -73,7 +130,7 @@ bool EventScheduler::initialize() {
     return true;
   }
 
-  const auto event_group_num = pmu_config_.get_event_group_num();
+  const auto event_group_num = pmu_config_->get_event_group_num();
 
   fds_.resize(event_group_num);
 
@@ -81,11 +138,11 @@ bool EventScheduler::initialize() {
   std::vector<PMUEvent> fixed_events_and_schedulable_events;
   for (size_t i = 0; i < event_group_num; ++i) {  // for each event group
     fixed_events_and_schedulable_events.insert(fixed_events_and_schedulable_events.end(),
-                                               pmu_config_.get_fixed_events().begin(),
-                                               pmu_config_.get_fixed_events().end());
+                                               pmu_config_->get_fixed_events().begin(),
+                                               pmu_config_->get_fixed_events().end());
     fixed_events_and_schedulable_events.insert(fixed_events_and_schedulable_events.end(),
-                                               pmu_config_.get_event_group_by_idx(i).begin(),
-                                               pmu_config_.get_event_group_by_idx(i).end());
+                                               pmu_config_->get_event_group_by_idx(i).begin(),
+                                               pmu_config_->get_event_group_by_idx(i).end());
 
     int group_leader_fd = -1;
     bool is_first_in_group = true;
@@ -93,12 +150,21 @@ bool EventScheduler::initialize() {
     for (const auto &pmu_event : fixed_events_and_schedulable_events) {  // for each event
       // Prepare perf_event_attr
       struct perf_event_attr pe = {};
-      configure_event(&pe, PERF_TYPE_RAW, pmu_event.encoding, is_first_in_group);
+      configure_event(&pe, pmu_event.type, pmu_event.encoding, is_first_in_group);
+      pe.inherit = inherit_ ? 1 : 0;
+      const bool sampled = !sample_event_.empty() && pmu_event.name == sample_event_;
+      if (sampled) {
+        pe.sample_period = sample_period_;
+        pe.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_TID | (sample_callchain_ ? PERF_SAMPLE_CALLCHAIN : 0);
+        pe.mmap = 1;  // Only the instance of the active group is enabled, so the mappings are reported once at a time
+      }
 
       // Open fd for event
       // (1) system-wide measurement: target_pid_ = -1, target_cpu_ = the specified CPU
       // (2) per-process measurement: target_pid_ = the specified PID, target_cpu_ = -1 (running on any CPU)
-      int fd = perf_event_open(&pe, target_pid_, target_cpu_, group_leader_fd, 0);
+      // (3) cgroup: the cgroup fd in place of the PID, target_cpu_ = the specified CPU
+      int fd = (cgroup_fd_ != -1) ? perf_event_open(&pe, cgroup_fd_, target_cpu_, group_leader_fd, PERF_FLAG_PID_CGROUP)
+                                  : perf_event_open(&pe, target_pid_, target_cpu_, group_leader_fd, 0);
 
       if (fd == -1) {
         std::cerr << "Failed to open event " << pmu_event.name
@@ -110,6 +176,17 @@ bool EventScheduler::initialize() {
       }
 
       fds_[i].push_back(fd);
+      if (sampled) {
+        // All the instances of the sampled event write into the ring buffer of the first one
+        bool attached = sample_ring_.is_mapped() ? ioctl(fd, PERF_EVENT_IOC_SET_OUTPUT, sample_ring_.get_fd()) == 0
+                                                 : sample_ring_.map(fd, SAMPLE_RING_PAGES);
+        if (!attached) {
+          std::cerr << "Failed to attach event " << pmu_event.name << " to the sample ring buffer (PID: " << target_pid_
+                    << ", CPU: " << target_cpu_ << "): " << strerror(errno) << std::endl;
+          cleanup_fds();
+          return false;
+        }
+      }
       if (is_first_in_group) {
         group_leader_fd = fd;
         is_first_in_group = false;
@@ -181,7 +258,8 @@ bool EventScheduler::switch_to_next_group() {
   if (!initialized_ || fds_.empty() ||
       get_num_event_groups() <= 1) {  // No switch if 0 or 1 group
     if (get_num_event_groups() == 1 && !fds_[0].empty()) {
-      // If only one group, just reset and ensure it's enabled
+      // If only one group, just reset and ensure it's enabled (in delta mode, it simply keeps counting)
+      if (delta_mode_) return true;
       if (!reset_active_group()) return false;
       return enable_active_group();
     }
@@ -194,10 +272,27 @@ bool EventScheduler::switch_to_next_group() {
   }
 
   // Change the active event group
-  active_group_idx_ = (active_group_idx_ + 1) % get_num_event_groups();
+  if (scheduling_policy_) {
+    active_group_idx_ = static_cast<int>(scheduling_policy_->next_group(active_group_idx_) % get_num_event_groups());
+  } else {
+    active_group_idx_ = (active_group_idx_ + 1) % get_num_event_groups();
+  }
 
-  if (!reset_active_group()) return false;  // Reset the new active group
-  return enable_active_group();             // Enable the new active group
+  // In delta mode the counts are never reset, the difference is taken when the group is read
+  if (!delta_mode_ && !reset_active_group()) return false;  // Reset the new active group
+  return enable_active_group();                             // Enable the new active group
+}
+
+bool EventScheduler::switch_to_group(int group_idx) {
+  if (!initialized_ || group_idx < 0 || group_idx >= get_num_event_groups()) return false;
+  if (group_idx == active_group_idx_) return delta_mode_ || reset_active_group();  // A new interval of the same group
+
+  if (!disable_active_group()) {
+    std::cerr << "Warning: Failed to stop current group, but attempting to switch." << std::endl;
+  }
+  active_group_idx_ = group_idx;
+  if (!delta_mode_ && !reset_active_group()) return false;
+  return enable_active_group();
 }
 
 ssize_t EventScheduler::read_active_group_data() {
@@ -221,11 +316,19 @@ ssize_t EventScheduler::read_active_group_data() {
               << buffer.size() << " for event group "
               << active_group_idx_ << std::endl;
   }
+
+  if (bytes_read > 0) {
+    // time_enabled and time_running are never reset by the kernel, so they are always turned into the values of this interval
+    GroupReadBuffer &prev = prev_buffers_[active_group_idx_];
+    delta_buffers_[active_group_idx_].assign_delta(buffer, prev, delta_mode_);
+    prev = buffer;
+    if (scheduling_policy_) scheduling_policy_->observe(active_group_idx_, delta_buffers_[active_group_idx_]);
+  }
   return bytes_read;
 }
 
 GroupReadBuffer& EventScheduler::get_active_group_read_buffer() {
-  return read_buffers_[active_group_idx_];
+  return delta_buffers_[active_group_idx_];
 }
 
 int EventScheduler::get_active_group_idx() const { return active_group_idx_; }
@@ -244,7 +347,7 @@ const std::vector<PMUEvent> &EventScheduler::get_pmu_events_in_active_group() co
               << std::endl;
     return empty_events;
   }
-  return pmu_config_.get_event_group_by_idx(active_group_idx_);
+  return pmu_config_->get_event_group_by_idx(active_group_idx_);
 }
 
 void EventScheduler::configure_event(struct perf_event_attr *pe, uint32_t type,
@@ -267,9 +370,8 @@ void EventScheduler::configure_event(struct perf_event_attr *pe, uint32_t type,
   } else {
     pe->disabled = 0;
   }
-  // pe->inherit = 1;
-  // [[NOTE]] The inherit bit specifies that this counter should count events of child tasks as well as the task specified.
-  // Inherit does not work for some combinations of read_format values, such as PERF_FORMAT_GROUP.
+  // [[NOTE]] The inherit bit (see set_inherit()) specifies that this counter should count events of child tasks as well as the task specified.
+  // Older kernels reject inherit with PERF_FORMAT_GROUP, TaskFollower then attaches a scheduler to each child instead.
 }
 
 int EventScheduler::perf_event_open(struct perf_event_attr *pe, pid_t pid, int cpu,
@@ -0,0 +1,20 @@
+#include "hperf/file_utils.h"
+
+#include <fstream>
+
+std::string read_first_line(const std::string &path) {
+  std::ifstream file(path);
+  std::string line;
+  if (!file.is_open() || !std::getline(file, line)) return "";
+  line.erase(line.find_last_not_of(" \t\r\n") + 1);
+  return line;
+}
+
+uint64_t fnv1a(const std::string &text) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (unsigned char c : text) {
+    hash ^= c;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
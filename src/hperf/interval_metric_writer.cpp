@@ -0,0 +1,126 @@
+#include "hperf/interval_metric_writer.h"
+
+#include <iomanip>
+#include <ios>
+
+IntervalMetricWriter::IntervalMetricWriter(const PMUConfig &pmu_config, const MetricEngine &metric_engine, std::ostream &out, size_t cpu_num)
+    : pmu_config_(pmu_config), metric_engine_(metric_engine), out_(out), cpu_num_(cpu_num), cnt_freq_(read_cntfrq_el0()), core_type_layouts_(nullptr) {
+  fixed_event_num_ = pmu_config_.get_fixed_events().size();
+  event_num_ = pmu_config_.get_all_events().size();
+
+  event_slots_.resize(pmu_config_.get_event_group_num());
+  for (size_t i = 0; i < event_slots_.size(); ++i) {
+    size_t nr = fixed_event_num_ + pmu_config_.get_event_group_by_idx(i).size();
+    for (size_t j = 0; j < nr; ++j) {
+      event_slots_[i].push_back(pmu_config_.get_event_index(pmu_config_.get_pmu_event(i, j).name));
+    }
+  }
+
+  event_values_.resize(event_num_);
+}
+
+void IntervalMetricWriter::write_header() {
+  out_ << "timestamp,cpu";
+  for (const auto &metric : metric_engine_.get_metrics()) {
+    out_ << "," << metric.name;
+  }
+  out_ << "\n";
+}
+
+void IntervalMetricWriter::process_a_record(const Record &record) {
+  if (record.group_id < 0 || static_cast<size_t>(record.group_id) >= event_slots_.size() ||
+      record.event_id >= event_slots_[record.group_id].size()) {
+    return;
+  }
+  const size_t group_id = static_cast<size_t>(record.group_id);
+
+  RotationState &state = cpu_states_[record.cpu_id];
+  if (state.raw_sum.empty()) {
+    state.raw_sum.assign(event_num_, 0);
+    state.running_sum.assign(event_num_, 0);
+    state.duration = 0;
+    state.group_seen.assign(event_slots_.size(), false);
+    state.seen_group_num = 0;
+  }
+
+  // The records of a group read share the times, count them once
+  if (record.event_id == 0) {
+    state.duration += record.time_enabled;
+  }
+
+  size_t idx = event_slots_[group_id][record.event_id];
+  state.raw_sum[idx] += record.value;
+  if (record.event_id >= fixed_event_num_) {
+    state.running_sum[idx] += record.time_running;
+  }
+
+  // The groups are not read in a fixed order (e.g., with the weights or variance policy), so a rotation is complete once every
+  // group of the CPU has been read since the last row
+  if (record.event_id != event_slots_[group_id].size() - 1) return;
+  if (!state.group_seen[group_id]) {
+    state.group_seen[group_id] = true;
+    ++state.seen_group_num;
+  }
+  size_t group_num = event_slots_.size();
+  if (core_type_layouts_) {
+    group_num = core_type_layouts_->get_core_type(record.cpu_id).pmu_config.get_event_group_num();
+  }
+  if (state.seen_group_num < group_num) return;
+
+  for (size_t i = 0; i < event_num_; ++i) {
+    if (i < fixed_event_num_) {
+      event_values_[i] = state.raw_sum[i];
+    } else {
+      event_values_[i] = (state.running_sum[i] > 0) ? (double)state.raw_sum[i] * state.duration / state.running_sum[i] : 0.0;
+    }
+  }
+  write_row(record.timestamp, record.cpu_id, event_values_, state.duration);
+
+  if (cpu_num_ > 1) {
+    uint64_t rotation = rotation_counts_[record.cpu_id]++;
+    SystemState &system_state = system_states_[rotation];
+    if (system_state.event_values.empty()) {
+      system_state.event_values.assign(event_num_, 0.0);
+      system_state.duration_sum = 0;
+      system_state.timestamp = 0;
+      system_state.cpu_count = 0;
+    }
+    for (size_t i = 0; i < event_num_; ++i) {
+      system_state.event_values[i] += event_values_[i];
+    }
+    system_state.duration_sum += state.duration;
+    if (record.timestamp > system_state.timestamp) system_state.timestamp = record.timestamp;
+
+    if (++system_state.cpu_count == cpu_num_) {
+      // The events are summed over CPUs, while the duration is the wall-clock time of the rotation (the mean over CPUs)
+      write_row(system_state.timestamp, -1, system_state.event_values, system_state.duration_sum / cpu_num_);
+      system_states_.erase(rotation);
+    }
+  }
+
+  state.raw_sum.assign(event_num_, 0);
+  state.running_sum.assign(event_num_, 0);
+  state.duration = 0;
+  state.group_seen.assign(event_slots_.size(), false);
+  state.seen_group_num = 0;
+}
+
+void IntervalMetricWriter::write_row(uint64_t timestamp, int cpu_id, const std::vector<double> &event_values, uint64_t duration) {
+  double variables[MetricEngine::VARIABLE_NUM];
+  variables[MetricEngine::CNT_FREQ] = cnt_freq_;
+  variables[MetricEngine::DURATION_NS] = duration;
+
+  out_ << timestamp << ",";
+  if (cpu_num_ > 1 && cpu_id == -1) {
+    out_ << "all";
+  } else {
+    out_ << cpu_id;
+  }
+
+  out_ << std::fixed << std::setprecision(4);
+  for (const auto &metric : metric_engine_.get_metrics()) {
+    double value = MetricEngine::evaluate(metric, event_values, variables);
+    out_ << "," << (metric.unit == MetricUnit::PERCENT ? value * 100 : value);
+  }
+  out_ << "\n";
+}
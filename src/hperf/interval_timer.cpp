@@ -0,0 +1,80 @@
+#include "hperf/interval_timer.h"
+
+#include <time.h>  // for clock_nanosleep, clock_gettime
+
+#include <algorithm>
+#include <cerrno>
+#include <iomanip>
+
+#define NS_PER_SEC 1000000000ULL
+
+IntervalTimer::IntervalTimer(uint64_t period_in_ns)
+    : period_(period_in_ns > 0 ? period_in_ns : 1),
+      last_deadline_(0),
+      missed_boundary_num_(0) {}
+
+void IntervalTimer::start(uint64_t start_timestamp) {
+  last_deadline_ = start_timestamp;
+  jitters_.clear();
+  missed_boundary_num_ = 0;
+}
+
+uint64_t IntervalTimer::wait_for_next_boundary() {
+  uint64_t deadline = last_deadline_ + period_;
+
+  uint64_t current = now();
+  if (current > deadline + period_) {
+    // Overrun: skip to the latest boundary that has passed, instead of firing repeatedly to catch up
+    uint64_t skipped = (current - deadline) / period_;
+    missed_boundary_num_ += skipped;
+    deadline += skipped * period_;
+  }
+
+  struct timespec ts;
+  ts.tv_sec = deadline / NS_PER_SEC;
+  ts.tv_nsec = deadline % NS_PER_SEC;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    // interrupted by a signal handler, sleep again until the same deadline
+  }
+
+  uint64_t wakeup = now();
+  jitters_.push_back(wakeup > deadline ? wakeup - deadline : 0);
+  last_deadline_ = deadline;
+  return wakeup;
+}
+
+void IntervalTimer::set_period(uint64_t period_in_ns) {
+  period_ = period_in_ns > 0 ? period_in_ns : 1;
+}
+
+void IntervalTimer::merge_stats(const IntervalTimer &other) {
+  jitters_.insert(jitters_.end(), other.jitters_.begin(), other.jitters_.end());
+  missed_boundary_num_ += other.missed_boundary_num_;
+}
+
+void IntervalTimer::print_jitter_stats(std::ostream &out) const {
+  if (jitters_.empty()) {
+    out << "Interval timer: no wakeup recorded\n";
+    return;
+  }
+
+  std::vector<uint64_t> sorted = jitters_;
+  std::sort(sorted.begin(), sorted.end());
+
+  uint64_t sum = 0;
+  for (uint64_t j : sorted) sum += j;
+  double mean_us = (double)sum / sorted.size() / 1e3;
+  double p99_us = sorted[(sorted.size() - 1) * 99 / 100] / 1e3;
+  double max_us = sorted.back() / 1e3;
+
+  out << std::fixed << std::setprecision(2)
+      << "Interval timer: " << sorted.size() << " wakeups, jitter mean " << mean_us
+      << " us, p99 " << p99_us << " us, max " << max_us << " us, "
+      << missed_boundary_num_ << " missed boundaries\n";
+}
+
+uint64_t IntervalTimer::now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
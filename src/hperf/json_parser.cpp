@@ -0,0 +1,231 @@
+#include "hperf/json_parser.h"
+
+#include <cstdlib>
+
+// Nesting limit, a deeper document is rejected instead of overflowing the stack
+#define JSON_MAX_DEPTH 64
+
+namespace {
+
+class JsonParser {
+ public:
+  explicit JsonParser(const std::string &text) : text_(text), pos_(0) {}
+
+  bool parse(JsonValue &value, std::string &error) {
+    bool ok = parse_value(value, 0);
+    if (ok) {
+      skip_whitespace();
+      ok = (pos_ == text_.size()) || fail("Unexpected trailing characters");
+    }
+    if (!ok) {
+      size_t line = 1;
+      for (size_t i = 0; i < pos_ && i < text_.size(); ++i) line += (text_[i] == '\n');
+      error = "Line " + std::to_string(line) + ": " + error_;
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  const std::string &text_;
+  size_t pos_;
+  std::string error_;
+
+  bool fail(const std::string &message) {
+    error_ = message;
+    return false;
+  }
+
+  void skip_whitespace() {
+    while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r')) ++pos_;
+  }
+
+  bool consume(const char *literal) {
+    size_t len = std::char_traits<char>::length(literal);
+    if (text_.compare(pos_, len, literal) != 0) return false;
+    pos_ += len;
+    return true;
+  }
+
+  bool parse_value(JsonValue &value, int depth) {
+    if (depth > JSON_MAX_DEPTH) return fail("Nesting too deep");
+    skip_whitespace();
+    if (pos_ >= text_.size()) return fail("Unexpected end of input");
+
+    char c = text_[pos_];
+    if (c == '{') return parse_object(value, depth);
+    if (c == '[') return parse_array(value, depth);
+    if (c == '"') {
+      value.type = JsonValue::Type::STRING;
+      return parse_string(value.string);
+    }
+    if (consume("true") || consume("false")) {
+      value.type = JsonValue::Type::BOOL;
+      value.boolean = (c == 't');
+      return true;
+    }
+    if (consume("null")) {
+      value.type = JsonValue::Type::NUL;
+      return true;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+      const char *begin = text_.c_str() + pos_;
+      char *end = nullptr;
+      value.type = JsonValue::Type::NUMBER;
+      value.number = std::strtod(begin, &end);
+      pos_ += end - begin;
+      return true;
+    }
+    return fail(std::string("Unexpected character '") + c + "'");
+  }
+
+  bool parse_object(JsonValue &value, int depth) {
+    value.type = JsonValue::Type::OBJECT;
+    ++pos_;  // '{'
+    skip_whitespace();
+    if (pos_ < text_.size() && text_[pos_] == '}') {
+      ++pos_;
+      return true;
+    }
+    while (true) {
+      skip_whitespace();
+      if (pos_ >= text_.size() || text_[pos_] != '"') return fail("Expected a member name");
+      value.keys.emplace_back();
+      if (!parse_string(value.keys.back())) return false;
+      skip_whitespace();
+      if (pos_ >= text_.size() || text_[pos_] != ':') return fail("Expected ':'");
+      ++pos_;
+      value.elements.emplace_back();
+      if (!parse_value(value.elements.back(), depth + 1)) return false;
+      skip_whitespace();
+      if (pos_ < text_.size() && text_[pos_] == ',') {
+        ++pos_;
+      } else if (pos_ < text_.size() && text_[pos_] == '}') {
+        ++pos_;
+        return true;
+      } else {
+        return fail("Expected ',' or '}'");
+      }
+    }
+  }
+
+  bool parse_array(JsonValue &value, int depth) {
+    value.type = JsonValue::Type::ARRAY;
+    ++pos_;  // '['
+    skip_whitespace();
+    if (pos_ < text_.size() && text_[pos_] == ']') {
+      ++pos_;
+      return true;
+    }
+    while (true) {
+      value.elements.emplace_back();
+      if (!parse_value(value.elements.back(), depth + 1)) return false;
+      skip_whitespace();
+      if (pos_ < text_.size() && text_[pos_] == ',') {
+        ++pos_;
+      } else if (pos_ < text_.size() && text_[pos_] == ']') {
+        ++pos_;
+        return true;
+      } else {
+        return fail("Expected ',' or ']'");
+      }
+    }
+  }
+
+  bool parse_hex4(unsigned &code) {
+    if (pos_ + 4 > text_.size()) return fail("Truncated \\u escape");
+    code = 0;
+    for (int i = 0; i < 4; ++i) {
+      char h = text_[pos_++];
+      code <<= 4;
+      if (h >= '0' && h <= '9') {
+        code |= h - '0';
+      } else if (h >= 'a' && h <= 'f') {
+        code |= h - 'a' + 10;
+      } else if (h >= 'A' && h <= 'F') {
+        code |= h - 'A' + 10;
+      } else {
+        return fail("Invalid \\u escape");
+      }
+    }
+    return true;
+  }
+
+  static void append_utf8(std::string &out, unsigned code) {
+    if (code < 0x80) {
+      out += static_cast<char>(code);
+    } else if (code < 0x800) {
+      out += static_cast<char>(0xc0 | (code >> 6));
+      out += static_cast<char>(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+      out += static_cast<char>(0xe0 | (code >> 12));
+      out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+      out += static_cast<char>(0x80 | (code & 0x3f));
+    } else {
+      out += static_cast<char>(0xf0 | (code >> 18));
+      out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+      out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+      out += static_cast<char>(0x80 | (code & 0x3f));
+    }
+  }
+
+  bool parse_string(std::string &out) {
+    ++pos_;  // '"'
+    while (pos_ < text_.size()) {
+      char c = text_[pos_++];
+      if (c == '"') return true;
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (pos_ >= text_.size()) break;
+      char e = text_[pos_++];
+      switch (e) {
+        case '"': out += '"'; break;
+        case '\\': out += '\\'; break;
+        case '/': out += '/'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+          unsigned code;
+          if (!parse_hex4(code)) return false;
+          // A surrogate pair encodes a code point above U+FFFF
+          if (code >= 0xd800 && code < 0xdc00 && consume("\\u")) {
+            unsigned low;
+            if (!parse_hex4(low)) return false;
+            if (low >= 0xdc00 && low < 0xe000) {
+              code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+            } else {
+              append_utf8(out, code);
+              code = low;
+            }
+          }
+          append_utf8(out, code);
+          break;
+        }
+        default:
+          return fail(std::string("Invalid escape '\\") + e + "'");
+      }
+    }
+    return fail("Unterminated string");
+  }
+};
+
+}  // namespace
+
+const JsonValue *JsonValue::find(const std::string &key) const {
+  if (type != Type::OBJECT) return nullptr;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (keys[i] == key) return &elements[i];
+  }
+  return nullptr;
+}
+
+bool parse_json(const std::string &text, JsonValue &value, std::string &error) {
+  value = JsonValue();
+  JsonParser parser(text);
+  return parser.parse(value, error);
+}
@@ -15,22 +15,42 @@
 #include <signal.h>    // For kill
 #include <sys/wait.h>  // For waitpid
 
+#include <algorithm>
 #include <cerrno>
 #include <chrono>
 #include <csignal>
 #include <cstddef>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <string>
 #include <thread>
 
 #include "hperf/args_parser.h"
-#include "hperf/counter_detector.h"
+#include "hperf/async_trace_writer.h"
+#include "hperf/cgroup.h"
+#include "hperf/core_type_layouts.h"
+#include "hperf/cpu_collector.h"
 #include "hperf/event_scheduler.h"
+#include "hperf/interval_metric_writer.h"
+#include "hperf/interval_timer.h"
+#include "hperf/metric_engine.h"
+#include "hperf/phase_detector.h"
 #include "hperf/pmu_config.h"
+#include "hperf/task_follower.h"
+#include "hperf/pmu_probe.h"
 #include "hperf/reporter.h"
+#include "hperf/sample_profile.h"
+#include "hperf/scheduling_policy.h"
+#include "hperf/thread_monitor.h"
+#include "hperf/trace_writer.h"
 
 #define MAX_TEST_DURATION 600  // Max test duration: 600s
 
+#define ASYNC_OUTPUT_BATCH_NUM 8      // The number of batches in the ring of asynchronous output
+#define ASYNC_OUTPUT_BATCH_SIZE 4096  // The number of records in a batch of asynchronous output
+
 /**
  * @brief Get the timestamp in nanoseconds since epoch object
  *
@@ -41,29 +61,79 @@ uint64_t get_timestamp_since_epoch(std::chrono::steady_clock::time_point t) {
   return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
 }
 
+/**
+ * @brief The reporter and the outputs of a measured scope: the whole measurement, or a cgroup of `-G`
+ */
+struct MeasurementOutput {
+  std::string cgroup;  // Empty for the whole measurement
+  std::unique_ptr<Reporter> reporter;
+  std::ofstream output_file;
+  std::unique_ptr<TraceWriter> trace_writer;
+  std::ofstream interval_metrics_file;
+  std::unique_ptr<IntervalMetricWriter> interval_metric_writer;
+};
+
+/**
+ * @brief Move the records of the sample ring buffer of a scheduler into the profile, if sampling
+ *
+ * @param event_scheduler
+ * @param sample_profile nullptr without --sample
+ */
+void drain_samples(EventScheduler &event_scheduler, SampleProfile *sample_profile) {
+  if (sample_profile) {
+    event_scheduler.drain_samples([sample_profile](const struct perf_event_header *record) { sample_profile->add_record(record); });
+  }
+}
+
 /**
  * @brief System-wide measurement, collect performance data on all CPUs or specified CPU(s)
  *
+ * With cgroups, each CPU has an event scheduler for each cgroup. The scheduler of the first cgroup selects the groups,
+ * and the others on the same CPU follow it, so that all cgroups are measured with the same schedule.
+ *
+ * @param core_type_layouts The event groups of each core type
  * @param config
- * @param reporter
+ * @param cgroup_fds The cgroup of each output, or empty for the whole system
+ * @param outputs The reporter and the raw data output of each cgroup, or of the whole system
+ * @param sample_profile The hot spots of --sample, or nullptr
  */
-void system_wide_measurement(PMUConfig &pmu_config, const ProfileConfig &config, Reporter &reporter) {
-  // create and initialize event groups on each CPU
+void system_wide_measurement(const CoreTypeLayouts &core_type_layouts, const ProfileConfig &config, const std::vector<int> &cgroup_fds,
+                             std::vector<MeasurementOutput> &outputs, SampleProfile *sample_profile) {
+  // create and initialize event groups on each CPU, with the groups of its core type, [cgroup * cpu_num + the index of the CPU]
+  const size_t cpu_num = config.cpu_id_list.size();
   std::vector<EventScheduler> event_scheduler_list;
-  for (const auto cpu : config.cpu_id_list) {
-    EventScheduler event_scheduler(pmu_config, -1, cpu);
-    if (!event_scheduler.initialize()) {
-      std::cerr << "Fail to initialize the event scheduler on CPU " << cpu << "\n";
-      return;  // stop measurement
-    } else {
-      event_scheduler_list.push_back(std::move(event_scheduler));
+  std::vector<int> group_id_bases;  // The global id of the first group of each CPU
+  size_t max_group_num = 0;
+  for (size_t scope = 0; scope < outputs.size(); ++scope) {
+    for (const auto cpu : config.cpu_id_list) {
+      const auto &core_type = core_type_layouts.get_core_type(cpu);
+      EventScheduler event_scheduler(core_type.pmu_config, -1, cpu);
+      event_scheduler.set_delta_mode(config.delta_counting);
+      if (!cgroup_fds.empty()) {
+        event_scheduler.set_cgroup(cgroup_fds[scope]);
+      }
+      if (sample_profile) {
+        event_scheduler.set_sampling(config.sample_event, config.sample_period, config.call_graph);
+      }
+      if (scope == 0) {
+        event_scheduler.set_scheduling_policy(create_scheduling_policy(config.schedule, core_type.pmu_config));
+        group_id_bases.push_back(static_cast<int>(core_type.group_id_base));
+        max_group_num = std::max(max_group_num, core_type.pmu_config.get_event_group_num());
+      }
+      if (!event_scheduler.initialize()) {
+        std::cerr << "Fail to initialize the event scheduler on CPU " << cpu
+                  << (cgroup_fds.empty() ? "" : " for cgroup " + outputs[scope].cgroup) << "\n";
+        return;  // stop measurement
+      } else {
+        event_scheduler_list.push_back(std::move(event_scheduler));
+      }
     }
   }
 
   // Reset all counters
-  for (int i = 0; i < config.cpu_id_list.size(); i++) {
-    if (!event_scheduler_list[i].reset_all_groups()) {
-      std::cerr << "Fail to reset counters on CPU " << config.cpu_id_list[i] << "\n";
+  for (size_t k = 0; k < event_scheduler_list.size(); k++) {
+    if (!event_scheduler_list[k].reset_all_groups()) {
+      std::cerr << "Fail to reset counters on CPU " << config.cpu_id_list[k % cpu_num] << "\n";
       return;  // stop measurement
     }
   }
@@ -74,62 +144,146 @@ void system_wide_measurement(PMUConfig &pmu_config, const ProfileConfig &config,
   uint64_t start_timestamp = get_timestamp_since_epoch(start);
 
   // Enable (the first) event group
-  for (int i = 0; i < config.cpu_id_list.size(); i++) {
-    if (!event_scheduler_list[i].enable_active_group()) {
-      std::cerr << "Fail to reset counters on CPU " << config.cpu_id_list[i] << "\n";
+  for (size_t k = 0; k < event_scheduler_list.size(); k++) {
+    if (!event_scheduler_list[k].enable_active_group()) {
+      std::cerr << "Fail to reset counters on CPU " << config.cpu_id_list[k % cpu_num] << "\n";
       return;  // stop measurement
     }
   }
 
   std::cout << "System-wide: collecting data...\n";
 
-  while (std::chrono::steady_clock::now() < end) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(config.switch_group_interval));
+  // Switch boundaries are kept on the grid start + k * interval
+  IntervalTimer interval_timer(config.switch_group_interval * 1000000ULL);
+  interval_timer.start(start_timestamp);
 
-    uint64_t current_timestamp = get_timestamp_since_epoch(std::chrono::steady_clock::now());
-    for (int i = 0; i < config.cpu_id_list.size(); i++) {
-      if (event_scheduler_list[i].read_active_group_data() > 0) {
-        const auto &buffer = event_scheduler_list[i].get_active_group_read_buffer();
+  // Phase detection on each CPU, the interval is shortened for all CPUs (long enough for the core type with the most groups)
+  const size_t fixed_event_num = core_type_layouts.get_merged_config().get_fixed_events().size();
+  std::vector<PhaseDetector> phase_detectors(cpu_num, PhaseDetector(fixed_event_num));
+  FastRotationWindow fast_rotation(interval_timer, max_group_num);
+  std::vector<int> phase_changed_cpus;
+
+  while (std::chrono::steady_clock::now() < end) {
+    uint64_t current_timestamp = interval_timer.wait_for_next_boundary();
+    phase_changed_cpus.clear();
+    for (size_t k = 0; k < event_scheduler_list.size(); k++) {
+      const size_t i = k % cpu_num;
+      MeasurementOutput &output = outputs[k / cpu_num];
+      if (event_scheduler_list[k].read_active_group_data() > 0) {
+        const auto &buffer = event_scheduler_list[k].get_active_group_read_buffer();
+        if (config.phase_detect && k < cpu_num) {
+          fast_rotation.mark_read(i, event_scheduler_list[k].get_active_group_idx(), event_scheduler_list[k].get_num_event_groups());
+        }
+        if (config.phase_detect && phase_detectors[i].observe(buffer)) {
+          phase_changed_cpus.push_back(config.cpu_id_list[i]);
+        }
         for (uint64_t j = 0; j < buffer.nr(); ++j) {
           Record record = {
               current_timestamp - start_timestamp,
               config.cpu_id_list[i],
-              event_scheduler_list[i].get_active_group_idx(),
+              group_id_bases[i] + event_scheduler_list[k].get_active_group_idx(),
               j,
-              buffer.entry(j)->value};
-          reporter.process_a_record(record);
-          reporter.print_a_record(record, config.output_file_ptr ? *config.output_file_ptr : std::cout);
+              buffer.entry(j)->value,
+              buffer.time_enabled(),
+              buffer.time_running()};
+          output.reporter->process_a_record(record);
+          output.trace_writer->write_record(record);
         }
       } else {
         std::cerr << "Fail to read event counts on CPU " << config.cpu_id_list[i] << ": "
                   << strerror(errno) << "\n";
       }
+      drain_samples(event_scheduler_list[k], sample_profile);
     }
 
-    // Switch to the next event group
-    for (int i = 0; i < config.cpu_id_list.size(); i++) {
-      if (!event_scheduler_list[i].switch_to_next_group())
-        std::cerr << "Warning: Failed to properly switch event group on CPU " << config.cpu_id_list[i]
+    if (config.phase_detect) {
+      fast_rotation.update(!phase_changed_cpus.empty());
+      for (const auto cpu : phase_changed_cpus) {
+        Record marker = {current_timestamp - start_timestamp, cpu, PHASE_BOUNDARY_GROUP_ID, 0, fast_rotation.get_period(), 0, 0};
+        outputs[0].reporter->process_a_record(marker);
+        outputs[0].trace_writer->write_record(marker);
+      }
+    }
+
+    // Switch to the next event group, the schedulers of the other cgroups follow the first one on the same CPU
+    for (size_t k = 0; k < event_scheduler_list.size(); k++) {
+      bool switched = (k < cpu_num) ? event_scheduler_list[k].switch_to_next_group()
+                                    : event_scheduler_list[k].switch_to_group(event_scheduler_list[k % cpu_num].get_active_group_idx());
+      if (!switched)
+        std::cerr << "Warning: Failed to properly switch event group on CPU " << config.cpu_id_list[k % cpu_num]
                   << std::endl;
     }
   }  // end while
 
   // Stop the last active group
-  for (int i = 0; i < config.cpu_id_list.size(); i++) {
-    if (!event_scheduler_list[i].disable_active_group()) {
-      std::cerr << "Fail to stop counters on CPU " << config.cpu_id_list[i] << "\n";
+  for (size_t k = 0; k < event_scheduler_list.size(); k++) {
+    if (!event_scheduler_list[k].disable_active_group()) {
+      std::cerr << "Fail to stop counters on CPU " << config.cpu_id_list[k % cpu_num] << "\n";
     }
+    drain_samples(event_scheduler_list[k], sample_profile);
   }
 
   std::cout << "System-wide: data collection finished" << std::endl;
+  interval_timer.print_jitter_stats(std::cout);
+}
+
+/**
+ * @brief Check if the target process has terminated (a subprocess is reaped)
+ *
+ * @param pid
+ * @return true The process has terminated, the message is printed
+ * @return false Still running
+ */
+bool target_process_exited(pid_t pid) {
+  int status;
+  pid_t result = waitpid(pid, &status, WNOHANG);
+
+  if (result > 0) {  // subprocess, terminated
+    std::cout << "Target process " << pid << " has terminated, stopping measurement.\n";
+    return true;
+  } else if (result == -1 && errno == ECHILD) {  // not subprocess
+    if (kill(pid, 0) == -1 && errno == ESRCH) {
+      std::cout << "Target process " << pid << " no longer exists, stopping measurement.\n";
+      return true;
+    }
+    // kill return 0: still running
+  }
+  // result == 0: subprocess, still running
+  return false;
 }
 
-void per_process_measurement(PMUConfig &pmu_config, const ProfileConfig &config, Reporter &reporter) {
+void per_process_measurement(const PMUConfig &pmu_config, const ProfileConfig &config, Reporter &reporter, TraceWriter &trace_writer,
+                             SampleProfile *sample_profile) {
   EventScheduler event_scheduler(pmu_config, config.target_pid, -1);
+  event_scheduler.set_delta_mode(config.delta_counting);
+  event_scheduler.set_scheduling_policy(create_scheduling_policy(config.schedule, pmu_config));
+  if (sample_profile) {
+    event_scheduler.set_sampling(config.sample_event, config.sample_period, config.call_graph);
+  }
+
+  // The children are inherited if the kernel sums them into the group reads, otherwise each child gets its own scheduler
+  std::unique_ptr<TaskFollower> task_follower;
+  if (config.follow_children) {
+    if (TaskFollower::inherit_group_read_supported()) {
+      std::cout << "Following child tasks with inherited event groups" << (config.delta_counting ? "" : " (delta counting)") << std::endl;
+      event_scheduler.set_inherit(true);
+    } else {
+      std::cout << "Following child tasks by tracking fork and exit (no inherit for group reads on this kernel)" << std::endl;
+      task_follower = std::make_unique<TaskFollower>(pmu_config, config.target_pid, config.delta_counting);
+      if (!task_follower->start()) {
+        std::cerr << "Fail to track the child tasks of PID " << config.target_pid << "\n";
+        return;  // stop measurement
+      }
+    }
+  }
+
   if (!event_scheduler.initialize()) {
     std::cerr << "Fail to initialize event groups for PID " << config.target_pid << "\n";
     return;  // stop measurement
   }
+  if (sample_profile) {
+    sample_profile->add_process(config.target_pid);  // The samples of the last interval are drained after the process exits
+  }
 
   // Reset all counters
   if (!event_scheduler.reset_all_groups()) {
@@ -152,62 +306,259 @@ void per_process_measurement(PMUConfig &pmu_config, const ProfileConfig &config,
 
   std::cout << "Per-process (Target PID: " << config.target_pid << "): collecting data...\n";
 
+  // Switch boundaries are kept on the grid start + k * interval
+  IntervalTimer interval_timer(config.switch_group_interval * 1000000ULL);
+  interval_timer.start(start_timestamp);
+
+  PhaseDetector phase_detector(pmu_config.get_fixed_events().size());
+  FastRotationWindow fast_rotation(interval_timer, pmu_config.get_event_group_num());
+
   while (std::chrono::steady_clock::now() < end) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(config.switch_group_interval));
+    uint64_t current_timestamp = interval_timer.wait_for_next_boundary();
 
     // Check the target process
-    if (config.target_pid != -1) {
-      int status;
-      pid_t result = waitpid(config.target_pid, &status, WNOHANG);
-
-      if (result > 0) {  // subprocess, terminated
-        std::cout << "Target process " << config.target_pid << " has terminated, stopping measurement.\n";
-        break;
-      } else if (result == -1 && errno == ECHILD) {  // not subprocess
-        if (kill(config.target_pid, 0) == -1 && errno == ESRCH) {
-          std::cout << "Target process " << config.target_pid << " no longer exists, stopping measurement.\n";
-          break;
-        }
-        // kill return 0: still running
-      }
-      // result == 0: subprocess, still running
+    if (config.target_pid != -1 && target_process_exited(config.target_pid)) {
+      break;
     }
 
-    uint64_t current_timestamp = get_timestamp_since_epoch(std::chrono::steady_clock::now());
-
     int active_group_idx = event_scheduler.get_active_group_idx();
 
     if (event_scheduler.read_active_group_data() > 0) {
-      const auto &buffer = event_scheduler.get_active_group_read_buffer();
+      auto &buffer = event_scheduler.get_active_group_read_buffer();
+      if (task_follower) {
+        task_follower->poll(active_group_idx);
+        task_follower->fold_into(buffer);  // The process and its children as a whole
+      }
       for (uint64_t i = 0; i < buffer.nr(); ++i) {
         Record record = {
             current_timestamp - start_timestamp,
             -1,
             active_group_idx,
             i,
-            buffer.entry(i)->value};
+            buffer.entry(i)->value,
+            buffer.time_enabled(),
+            buffer.time_running()};
         reporter.process_a_record(record);
-        reporter.print_a_record(record, config.output_file_ptr ? *config.output_file_ptr : std::cout);
+        trace_writer.write_record(record);
+      }
+
+      if (config.phase_detect) {
+        bool phase_changed = phase_detector.observe(buffer);
+        fast_rotation.mark_read(0, active_group_idx, event_scheduler.get_num_event_groups());
+        fast_rotation.update(phase_changed);
+        if (phase_changed) {
+          Record marker = {current_timestamp - start_timestamp, -1, PHASE_BOUNDARY_GROUP_ID, 0, fast_rotation.get_period(), 0, 0};
+          reporter.process_a_record(marker);
+          trace_writer.write_record(marker);
+        }
       }
     } else {
       std::cerr << "Fail to read event counts for PID " << config.target_pid << ": "
                 << strerror(errno) << "\n";
     }
+    drain_samples(event_scheduler, sample_profile);
 
     // Switch to the next event group
     if (!event_scheduler.switch_to_next_group() && event_scheduler.get_num_event_groups() > 1) {
       std::cerr << "Warning: Failed to properly switch event group for PID " << config.target_pid
                 << std::endl;
     }
+    if (task_follower) {
+      task_follower->switch_to_group(event_scheduler.get_active_group_idx());
+    }
   }  // end while
 
   // Stop the last active group
   if (!event_scheduler.disable_active_group()) {
     std::cerr << "Fail to stop counters for PID " << config.target_pid << "\n";
   }
+  drain_samples(event_scheduler, sample_profile);
+  if (task_follower) {
+    task_follower->stop();
+    std::cout << "Followed " << task_follower->get_followed_task_num() << " child tasks";
+    if (task_follower->get_missed_task_num() > 0 || task_follower->get_lost_record_num() > 0) {
+      std::cout << " (" << task_follower->get_missed_task_num() << " exited within an interval and were not counted, "
+                << task_follower->get_lost_record_num() << " tracking records lost)";
+    }
+    std::cout << std::endl;
+  }
 
   std::cout << "Per-process (Target PID: " << config.target_pid << "): data collection finished"
             << std::endl;
+  interval_timer.print_jitter_stats(std::cout);
+}
+
+/**
+ * @brief Per-thread measurement, each thread of the target process is measured by its own event groups
+ *
+ * @param pmu_config
+ * @param config
+ * @param reporter
+ * @param trace_writer The raw data output, the CPU of the records is the TID
+ * @param thread_names The name of each measured thread, filled during the measurement
+ */
+void per_thread_measurement(const PMUConfig &pmu_config, const ProfileConfig &config, Reporter &reporter, TraceWriter &trace_writer,
+                            std::map<int, std::string> &thread_names) {
+  ThreadMonitor thread_monitor(pmu_config, config.target_pid, config.delta_counting, config.schedule);
+  auto add_thread_names = [&thread_monitor, &thread_names](const std::vector<pid_t> &tids) {
+    for (const pid_t tid : tids) thread_names[tid] = thread_monitor.get_thread_name(tid);
+  };
+
+  add_thread_names(thread_monitor.scan());
+  if (thread_monitor.get_thread_num() == 0) {
+    std::cerr << "Fail to initialize event groups for any thread of PID " << config.target_pid << "\n";
+    return;  // stop measurement
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  int duration = config.test_duration > 0 ? config.test_duration : MAX_TEST_DURATION;
+  auto end = start + std::chrono::seconds(duration);
+
+  uint64_t start_timestamp = get_timestamp_since_epoch(start);
+
+  std::cout << "Per-thread (Target PID: " << config.target_pid << ", " << thread_monitor.get_thread_num()
+            << " threads): collecting data...\n";
+
+  // Switch boundaries are kept on the grid start + k * interval
+  IntervalTimer interval_timer(config.switch_group_interval * 1000000ULL);
+  interval_timer.start(start_timestamp);
+
+  while (std::chrono::steady_clock::now() < end) {
+    uint64_t current_timestamp = interval_timer.wait_for_next_boundary();
+
+    // Check the target process
+    if (target_process_exited(config.target_pid)) {
+      break;
+    }
+
+    thread_monitor.read([&](pid_t tid, int group_idx, const GroupReadBuffer &buffer) {
+      for (uint64_t i = 0; i < buffer.nr(); ++i) {
+        Record record = {
+            current_timestamp - start_timestamp,
+            tid,
+            group_idx,
+            i,
+            buffer.entry(i)->value,
+            buffer.time_enabled(),
+            buffer.time_running()};
+        reporter.process_a_record(record);
+        trace_writer.write_record(record);
+      }
+    });
+
+    // The threads created in this interval are counted from the next one
+    add_thread_names(thread_monitor.scan());
+
+    // Switch to the next event group, except on the threads that did not run
+    thread_monitor.switch_to_next_group();
+  }  // end while
+
+  thread_monitor.stop();
+
+  std::cout << "Measured " << thread_monitor.get_measured_thread_num() << " threads";
+  if (thread_monitor.get_unmeasured_thread_num() > 0) {
+    std::cout << " (" << thread_monitor.get_unmeasured_thread_num() << " more not measured for the limit of open files, see ulimit -n)";
+  }
+  reporter.set_unmeasured_thread_num(thread_monitor.get_unmeasured_thread_num());
+  std::cout << ", " << thread_monitor.get_skipped_switch_num() << " group switches skipped on idle threads" << std::endl;
+
+  std::cout << "Per-thread (Target PID: " << config.target_pid << "): data collection finished" << std::endl;
+  interval_timer.print_jitter_stats(std::cout);
+}
+
+/**
+ * @brief Create the reporter of a measured scope, with the estimator and the metric definitions of the options
+ *
+ * @param config
+ * @param core_type_layouts
+ * @return std::unique_ptr<Reporter> nullptr if the options are invalid (the error is printed)
+ */
+std::unique_ptr<Reporter> create_reporter(const ProfileConfig &config, const CoreTypeLayouts &core_type_layouts) {
+  // The records carry the global group ids of the merged groups of all core types
+  auto reporter = std::make_unique<Reporter>(core_type_layouts.get_merged_config());
+  reporter->set_core_type_layouts(&core_type_layouts);
+  if (config.estimator == "kernel") {
+    reporter->set_estimator(EstimatorType::KERNEL_TIME);
+  } else if (config.estimator.compare(0, 4, "ref:") == 0) {
+    if (!reporter->set_estimator(EstimatorType::REFERENCE_EVENT, config.estimator.substr(4))) {
+      return nullptr;
+    }
+  }
+  if (!config.metrics_filename.empty() && !reporter->load_metrics(config.metrics_filename)) {
+    return nullptr;
+  }
+  return reporter;
+}
+
+/**
+ * @brief Insert a suffix before the extension of a file name, e.g., "system.csv" and ".1" give "system.1.csv"
+ */
+std::string insert_file_suffix(const std::string &filename, const std::string &suffix) {
+  size_t dot = filename.find_last_of('.');
+  size_t slash = filename.find_last_of('/');
+  if (dot == std::string::npos || dot == 0 || (slash != std::string::npos && dot < slash)) {
+    return filename + suffix;
+  }
+  return filename.substr(0, dot) + suffix + filename.substr(dot);
+}
+
+/**
+ * @brief Open the raw data output (the file of -o, or the console) and the time series of metrics of a measured scope,
+ * and write their headers
+ *
+ * @param config
+ * @param core_type_layouts
+ * @param suffix Inserted into the file names, see insert_file_suffix()
+ * @param output The scope, whose reporter feeds the time series of metrics
+ * @return true On success
+ * @return false A file cannot be opened (the error is printed)
+ */
+bool open_outputs(const ProfileConfig &config, const CoreTypeLayouts &core_type_layouts, const std::string &suffix, MeasurementOutput &output) {
+  const PMUConfig &merged_config = core_type_layouts.get_merged_config();
+  const std::string of_cgroup = output.cgroup.empty() ? "" : " of cgroup " + output.cgroup;
+
+  if (!config.output_filename.empty()) {
+    const std::string filename = insert_file_suffix(config.output_filename, suffix);
+    output.output_file.open(filename, std::ios::out | std::ios::binary);
+    if (!output.output_file.is_open()) {
+      std::cerr << "Error: Failed to open output file: " << filename << "\n";
+      return false;
+    } else {
+      std::cout << "Outputting data" << of_cgroup << " to " << filename << "\n";
+    }
+  }
+
+  std::ostream &raw_data_out = output.output_file.is_open() ? output.output_file : std::cout;
+  if (config.output_format == "bin") {
+    output.trace_writer = std::make_unique<BinaryTraceWriter>(merged_config, raw_data_out, config.switch_group_interval * 1000000ULL);
+  } else if (config.output_format == "cbin") {
+    output.trace_writer = std::make_unique<CompressedTraceWriter>(merged_config, raw_data_out, config.switch_group_interval * 1000000ULL);
+  } else {
+    output.trace_writer = std::make_unique<CsvTraceWriter>(merged_config, raw_data_out, output.output_file.is_open());
+  }
+  if (config.async_output) {
+    output.trace_writer = std::make_unique<AsyncTraceWriter>(std::move(output.trace_writer), merged_config, ASYNC_OUTPUT_BATCH_NUM,
+                                                             ASYNC_OUTPUT_BATCH_SIZE);
+  }
+  output.trace_writer->write_header();
+
+  // The time series of metrics, if specified
+  if (!config.interval_metrics_filename.empty()) {
+    const std::string filename = insert_file_suffix(config.interval_metrics_filename, suffix);
+    output.interval_metrics_file.open(filename);
+    if (!output.interval_metrics_file.is_open()) {
+      std::cerr << "Error: Failed to open interval metrics file: " << filename << "\n";
+      return false;
+    }
+    size_t cpu_num = (config.mode == ProfileMode::SYSTEM_WIDE) ? config.cpu_id_list.size() : 1;
+    output.interval_metric_writer = std::make_unique<IntervalMetricWriter>(merged_config, output.reporter->get_metric_engine(),
+                                                                           output.interval_metrics_file, cpu_num);
+    output.interval_metric_writer->set_core_type_layouts(&core_type_layouts);
+    output.interval_metric_writer->write_header();
+    output.reporter->set_interval_metric_writer(output.interval_metric_writer.get());
+  }
+  return true;
 }
 
 /**
@@ -237,12 +588,6 @@ pid_t execute_command(char *const command_args[]) {
 }
 
 int main(int argc, char **argv) {
-  PMUConfig pmu_config;
-  if (!pmu_config.is_valid()) {
-    std::cerr << "Error: PMU event configuration is invalid." << std::endl;
-    return 1;
-  }
-
   ProfileConfig profile_config;
   ArgsParser args_parser;
 
@@ -251,32 +596,163 @@ int main(int argc, char **argv) {
     return 1;
   }
 
-  // Detect counters?
-  if (profile_config.detect_counters) {
-    CounterDetector counter_detector;
-    std::cout << "Detecting available programmable counters on each CPU ..." << std::endl;
-    counter_detector.detect();
-    counter_detector.print_result();
-    return 0;
+  // The compiled-in events of the CPU type, or the events of an event file resolved on this machine
+  PMUConfig pmu_config;
+  if (!profile_config.event_filename.empty() && !pmu_config.load_event_file(profile_config.event_filename)) {
+    return 1;
+  }
+  if (!pmu_config.is_valid()) {
+    std::cerr << "Error: PMU event configuration is invalid." << std::endl;
+    return 1;
   }
 
-  if (profile_config.optimize_event_groups) {
-    CounterDetector counter_detector;
+  // Probe the PMU capabilities of each CPU (the counters, the events that open, the conflicting events), cached by the hardware fingerprint
+  PMUProbe pmu_probe(pmu_config);
+  if (profile_config.detect_counters || profile_config.optimize_event_groups) {
     std::cout << "Detecting available programmable counters on each CPU ..." << std::endl;
-    counter_detector.detect();
-    counter_detector.print_result();
+    pmu_probe.run();
+    pmu_probe.print_result();
+    if (profile_config.detect_counters) {
+      return 0;
+    }
+  } else {
+    pmu_probe.load();  // Only the cached capabilities, without the time of probing
+  }
+
+  // A process may run on any CPU
+  const std::vector<int> measured_cpus = (profile_config.mode == ProfileMode::SYSTEM_WIDE) ? profile_config.cpu_id_list : pmu_probe.get_cpu_ids();
+  if (pmu_probe.is_valid()) {
+    // Start from the events known to open on the measured CPUs, instead of failing at initialization
+    const auto removed = pmu_config.remove_events(pmu_probe.get_unsupported_events(measured_cpus));
+    if (!removed.empty()) {
+      std::cout << "Events not supported by the measured CPUs are removed:";
+      for (const auto &name : removed) std::cout << " " << name;
+      std::cout << std::endl;
+    }
+    if (!pmu_config.is_valid()) {
+      std::cerr << "Error: No event group is left after removing the unsupported events." << std::endl;
+      return 1;
+    }
+
+    if (!profile_config.optimize_event_groups) {
+      for (const auto &conflict : pmu_probe.get_conflicts(measured_cpus)) {
+        for (size_t i = 0; i < pmu_config.get_event_group_num(); ++i) {
+          const auto &event_group = pmu_config.get_event_group_by_idx(i);
+          auto find = [&event_group](const EventKey &event) {
+            return std::find_if(event_group.begin(), event_group.end(), [&event](const PMUEvent &e) { return get_event_key(e) == event; });
+          };
+          if (find(conflict.first) != event_group.end() && find(conflict.second) != event_group.end()) {
+            std::cerr << "Warning: " << find(conflict.first)->name << " and " << find(conflict.second)->name << " in event group " << i
+                      << " cannot be counted together on some CPUs, use --optimize-event-groups to separate them" << std::endl;
+          }
+        }
+      }
+    }
+  }
 
+  CoreTypeLayouts core_type_layouts(pmu_config);
+  if (profile_config.optimize_event_groups) {
     std::cout << "Adaptive Grouping: " << std::endl;
     std::cout << "Before:" << std::endl;
     pmu_config.print_event_groups_by_line();
 
-    pmu_config.adaptive_grouping(counter_detector.get_detected_general_counter_num() - pmu_config.get_fixed_events().size());
+    // The conflicting pairs of the CPUs of a core type (of all CPUs for a process) are kept in different groups
+    auto conflicts_of = [&pmu_probe, &measured_cpus](const std::vector<int> &cpu_ids) {
+      return pmu_probe.get_conflicts(cpu_ids.front() == -1 ? measured_cpus : cpu_ids);
+    };
+    CoreTypeLayouts::GroupingFunction grouping = [&conflicts_of](PMUConfig &config, size_t programmable_counters_num, const std::vector<int> &cpu_ids) {
+      config.adaptive_grouping(programmable_counters_num, conflicts_of(cpu_ids));
+    };
+    MetricEngine metric_engine;
+    if (profile_config.metric_aware_grouping) {
+      // The metrics are compiled against the original events here, and compiled again by the Reporter against the new groups
+      std::string error;
+      auto resolver = [&pmu_config](const std::string &name) { return pmu_config.get_event_index(name); };
+      bool ok = profile_config.metrics_filename.empty()
+                    ? metric_engine.compile(pmu_config.get_metric_definitions(), resolver, error)
+                    : metric_engine.load_file(profile_config.metrics_filename, resolver, error);
+      if (!ok) {
+        std::cerr << "Error: Failed to load metric definitions: " << error << std::endl;
+        return 1;
+      }
+      grouping = [&metric_engine, &conflicts_of](PMUConfig &config, size_t programmable_counters_num, const std::vector<int> &cpu_ids) {
+        config.metric_aware_grouping(programmable_counters_num, metric_engine.get_metrics(), conflicts_of(cpu_ids));
+      };
+    }
+
+    // System-wide, the events are grouped for each core type (the CPUs with the same number of counters).
+    // A process may run on any CPU, so it uses the groups for the fewest counters.
+    std::vector<int> cpu_ids;
+    std::vector<int> counter_nums;
+    if (profile_config.mode == ProfileMode::SYSTEM_WIDE) {
+      for (const auto cpu : measured_cpus) {
+        int counter_num = pmu_probe.get_capability(cpu).counter_num;
+        if (counter_num <= 0) continue;  // Not detected, the CPU uses the first core type
+        cpu_ids.push_back(cpu);
+        counter_nums.push_back(counter_num);
+      }
+    } else {
+      int min_counter_num = -1;
+      for (const auto cpu : measured_cpus) {
+        int counter_num = pmu_probe.get_capability(cpu).counter_num;
+        if (counter_num > 0 && (min_counter_num == -1 || counter_num < min_counter_num)) min_counter_num = counter_num;
+      }
+      if (min_counter_num > 0) {
+        cpu_ids.push_back(-1);
+        counter_nums.push_back(min_counter_num);
+      }
+    }
+    core_type_layouts.regroup(cpu_ids, counter_nums, grouping);
 
     std::cout << "After:" << std::endl;
-    pmu_config.print_event_groups_by_line();
+    core_type_layouts.print_event_groups();
   }
 
-  Reporter reporter(pmu_config);
+  // Check the scheduling policy against the final event groups of each core type, each event scheduler creates its own instance
+  for (const auto &core_type : core_type_layouts.get_core_types()) {
+    if (!create_scheduling_policy(profile_config.schedule, core_type.pmu_config)) {
+      return 1;
+    }
+  }
+
+  // The sampled event must be in the event groups, a fixed event is counted (and samples) all the time
+  std::unique_ptr<SampleProfile> sample_profile;
+  if (!profile_config.sample_event.empty()) {
+    const PMUConfig &merged_config = core_type_layouts.get_merged_config();
+    if (merged_config.get_event_index(profile_config.sample_event) == -1) {
+      std::cerr << "Error: The sampled event " << profile_config.sample_event << " is not in the event groups." << std::endl;
+      return 1;
+    }
+    const auto &fixed_events = merged_config.get_fixed_events();
+    if (std::none_of(fixed_events.begin(), fixed_events.end(), [&profile_config](const PMUEvent &e) { return e.name == profile_config.sample_event; })) {
+      std::cout << "Note: " << profile_config.sample_event << " is not a fixed event, it is only sampled while its event group is counted"
+                << std::endl;
+    }
+    sample_profile = std::make_unique<SampleProfile>(profile_config.sample_event, profile_config.sample_period, profile_config.call_graph);
+  }
+
+  // The measured scopes: the whole measurement, or each cgroup of -G, each with its own reporter and outputs
+  std::vector<int> cgroup_fds;
+  for (const auto &cgroup : profile_config.cgroups) {
+    int fd = open_cgroup(cgroup);
+    if (fd == -1) {
+      return 1;
+    }
+    cgroup_fds.push_back(fd);
+  }
+  std::vector<MeasurementOutput> outputs(std::max<size_t>(1, profile_config.cgroups.size()));
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    outputs[i].cgroup = profile_config.cgroups.empty() ? "" : profile_config.cgroups[i];
+    outputs[i].reporter = create_reporter(profile_config, core_type_layouts);
+    if (!outputs[i].reporter) {
+      return 1;
+    }
+  }
+  Reporter &reporter = *outputs[0].reporter;
+  std::map<int, std::string> thread_names;  // Filled by the per-thread measurement
+  if (profile_config.per_thread) {
+    reporter.set_thread_names(&thread_names);
+  }
 
   // Step 1.1 Execute command if specified
   if (profile_config.mode == ProfileMode::SUBPROCESS) {
@@ -314,34 +790,65 @@ int main(int argc, char **argv) {
     std::cout << "Monitoring process with PID: " << profile_config.target_pid << "\n";
   }
 
-  // Step 1.3 Set output file stream, if specified
-  std::ofstream output_file;
-  if (!profile_config.output_filename.empty()) {
-    output_file.open(profile_config.output_filename);
-    if (!output_file.is_open()) {
-      std::cerr << "Error: Failed to open output file: " << profile_config.output_filename << "\n";
+  // Step 1.3 Set the raw data output and the time series of metrics of each scope, the files of several cgroups are numbered
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    if (!open_outputs(profile_config, core_type_layouts, outputs.size() > 1 ? "." + std::to_string(i) : "", outputs[i])) {
       return 1;
-    } else {
-      std::cout << "Outputting data to " << profile_config.output_filename << "\n";
-      output_file << "timestamp,cpu,group,event,value\n";
     }
-    profile_config.output_file_ptr = &output_file;
+  }
+  if (outputs[0].output_file.is_open()) {
+    profile_config.output_file_ptr = &outputs[0].output_file;
   }
 
-  // Step 1.4 Print Profiling config
+  // Step 1.5 Print Profiling config
   args_parser.print_profile_config(profile_config);
 
   // Step 2 Conduct measurement
+  TraceWriter &trace_writer = *outputs[0].trace_writer;
   if (profile_config.mode == ProfileMode::SYSTEM_WIDE) {
-    system_wide_measurement(pmu_config, profile_config, reporter);
+    if (profile_config.per_cpu_threads) {
+      PerCpuCollector collector(core_type_layouts, profile_config);
+      collector.run(reporter, trace_writer);
+    } else {
+      system_wide_measurement(core_type_layouts, profile_config, cgroup_fds, outputs, sample_profile.get());
+    }
+  } else if (profile_config.per_thread) {
+    per_thread_measurement(core_type_layouts.get_core_type(-1).pmu_config, profile_config, reporter, trace_writer, thread_names);
   } else {
-    per_process_measurement(pmu_config, profile_config, reporter);
+    per_process_measurement(core_type_layouts.get_core_type(-1).pmu_config, profile_config, reporter, trace_writer, sample_profile.get());
+  }
+  for (auto &output : outputs) {
+    output.trace_writer->finish();
+  }
+  for (const int fd : cgroup_fds) {
+    close(fd);
   }
 
   // Step 3 Show performance data
-  reporter.estimation();
-  reporter.print_stats();
-  reporter.print_metrics();
+  for (auto &output : outputs) {
+    if (!output.cgroup.empty()) {
+      std::cout << "################ cgroup " << output.cgroup << " ################\n";
+    }
+    output.reporter->estimation();
+    output.reporter->print_stats();
+    output.reporter->print_metrics();
+    output.reporter->print_threads();
+    for (const auto level : profile_config.rollup_levels) {
+      output.reporter->print_rollup(level);
+    }
+  }
+  if (outputs.size() > 1) {
+    std::vector<std::string> cgroups;
+    std::vector<const Reporter *> reporters;
+    for (const auto &output : outputs) {
+      cgroups.push_back(output.cgroup);
+      reporters.push_back(output.reporter.get());
+    }
+    Reporter::print_metric_comparison(cgroups, reporters);
+  }
+  if (sample_profile) {
+    sample_profile->print();
+  }
 
   return 0;
 }
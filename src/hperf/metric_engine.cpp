@@ -0,0 +1,310 @@
+#include "hperf/metric_engine.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// The maximum depth of the evaluation stack, expressions that need a deeper stack are rejected
+#define MAX_STACK_DEPTH 64
+
+namespace {
+
+using Instruction = CompiledMetric::Instruction;
+
+std::string trim(const std::string &s) {
+  size_t begin = s.find_first_not_of(" \t\r");
+  if (begin == std::string::npos) return "";
+  size_t end = s.find_last_not_of(" \t\r");
+  return s.substr(begin, end - begin + 1);
+}
+
+/**
+ * @brief Recursive descent parser of an expression, which emits the bytecode directly
+ *
+ * expr   := term { ('+' | '-') term }
+ * term   := unary { ('*' | '/') unary }
+ * unary  := '-' unary | primary
+ * primary:= NUMBER | EVENT | '$' VARIABLE | '(' expr ')'
+ */
+class ExpressionParser {
+ public:
+  ExpressionParser(const std::string &text, const MetricEngine::EventResolver &resolver, CompiledMetric &metric)
+      : text_(text), pos_(0), resolver_(resolver), metric_(metric), depth_(0) {}
+
+  bool parse(std::string &error) {
+    if (!parse_expr(error)) return false;
+    skip_spaces();
+    if (pos_ != text_.size()) {
+      error = "unexpected '" + text_.substr(pos_, 1) + "'";
+      return false;
+    }
+    return true;
+  }
+
+  const std::string &get_unknown_event() const { return unknown_event_; }
+
+ private:
+  const std::string &text_;
+  size_t pos_;
+  const MetricEngine::EventResolver &resolver_;
+  CompiledMetric &metric_;
+  size_t depth_;
+  std::string unknown_event_;  // The first unknown event name, if any
+
+  void skip_spaces() {
+    while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) ++pos_;
+  }
+
+  bool peek(char c) {
+    skip_spaces();
+    return pos_ < text_.size() && text_[pos_] == c;
+  }
+
+  void emit(Instruction::Op op, size_t index = 0, double constant = 0.0) {
+    metric_.code.push_back({op, index, constant});
+    if (op == Instruction::PUSH_CONST || op == Instruction::PUSH_EVENT || op == Instruction::PUSH_VAR) {
+      ++depth_;
+      metric_.max_stack_depth = std::max(metric_.max_stack_depth, depth_);
+    } else if (op != Instruction::NEG) {
+      --depth_;  // binary operators pop 2 and push 1
+    }
+  }
+
+  bool parse_expr(std::string &error) {
+    if (!parse_term(error)) return false;
+    while (peek('+') || peek('-')) {
+      char op = text_[pos_++];
+      if (!parse_term(error)) return false;
+      emit(op == '+' ? Instruction::ADD : Instruction::SUB);
+    }
+    return true;
+  }
+
+  bool parse_term(std::string &error) {
+    if (!parse_unary(error)) return false;
+    while (peek('*') || peek('/')) {
+      char op = text_[pos_++];
+      if (!parse_unary(error)) return false;
+      emit(op == '*' ? Instruction::MUL : Instruction::DIV);
+    }
+    return true;
+  }
+
+  bool parse_unary(std::string &error) {
+    if (peek('-')) {
+      ++pos_;
+      if (!parse_unary(error)) return false;
+      emit(Instruction::NEG);
+      return true;
+    }
+    return parse_primary(error);
+  }
+
+  bool parse_primary(std::string &error) {
+    skip_spaces();
+    if (pos_ >= text_.size()) {
+      error = "unexpected end of expression";
+      return false;
+    }
+
+    char c = text_[pos_];
+    if (c == '(') {
+      ++pos_;
+      if (!parse_expr(error)) return false;
+      if (!peek(')')) {
+        error = "missing ')'";
+        return false;
+      }
+      ++pos_;
+      return true;
+    }
+
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+      const char *begin = text_.c_str() + pos_;
+      char *end = nullptr;
+      double value = std::strtod(begin, &end);
+      if (end == begin) {
+        error = "invalid number";
+        return false;
+      }
+      pos_ += end - begin;
+      emit(Instruction::PUSH_CONST, 0, value);
+      return true;
+    }
+
+    bool is_variable = (c == '$');
+    if (is_variable) ++pos_;
+
+    size_t begin = pos_;
+    while (pos_ < text_.size() && (std::isalnum(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '_')) ++pos_;
+    if (pos_ == begin) {
+      error = "unexpected '" + std::string(1, c) + "'";
+      return false;
+    }
+    std::string name = text_.substr(begin, pos_ - begin);
+
+    if (is_variable) {
+      if (name == "cnt_freq") {
+        emit(Instruction::PUSH_VAR, MetricEngine::CNT_FREQ);
+      } else if (name == "duration_ns") {
+        emit(Instruction::PUSH_VAR, MetricEngine::DURATION_NS);
+      } else {
+        error = "unknown variable '$" + name + "'";
+        return false;
+      }
+      return true;
+    }
+
+    int event_idx = resolver_(name);
+    if (event_idx < 0) {
+      if (unknown_event_.empty()) unknown_event_ = name;
+      event_idx = 0;  // Keep parsing to report syntax errors, the metric is dropped anyway
+    } else if (std::find(metric_.event_operands.begin(), metric_.event_operands.end(), (size_t)event_idx) ==
+               metric_.event_operands.end()) {
+      metric_.event_operands.push_back(event_idx);
+    }
+    emit(Instruction::PUSH_EVENT, event_idx);
+    return true;
+  }
+};
+
+}  // namespace
+
+bool MetricEngine::compile(const std::string &text, const EventResolver &resolver, std::string &error) {
+  std::vector<CompiledMetric> compiled;
+  std::string section;
+  std::string subsection;
+
+  std::istringstream in(text);
+  std::string raw_line;
+  int line_no = 0;
+  while (std::getline(in, raw_line)) {
+    ++line_no;
+    std::string line = trim(raw_line.substr(0, raw_line.find('#')));
+    if (line.empty()) continue;
+
+    if (line.compare(0, 8, "section ") == 0) {
+      section = trim(line.substr(8));
+      subsection.clear();
+      continue;
+    }
+    if (line.compare(0, 11, "subsection ") == 0) {
+      subsection = trim(line.substr(11));
+      continue;
+    }
+
+    size_t eq_pos = line.find('=');
+    if (eq_pos == std::string::npos) {
+      error = "line " + std::to_string(line_no) + ": expected '<name> [unit] = <expression>'";
+      return false;
+    }
+
+    CompiledMetric metric;
+    metric.section = section;
+    metric.subsection = subsection;
+    metric.unit = MetricUnit::NONE;
+    metric.max_stack_depth = 0;
+
+    std::string lhs = trim(line.substr(0, eq_pos));
+    size_t bracket_pos = lhs.find('[');
+    if (bracket_pos != std::string::npos) {
+      size_t close_pos = lhs.find(']', bracket_pos);
+      if (close_pos == std::string::npos) {
+        error = "line " + std::to_string(line_no) + ": missing ']'";
+        return false;
+      }
+      std::string unit = trim(lhs.substr(bracket_pos + 1, close_pos - bracket_pos - 1));
+      if (unit == "%") {
+        metric.unit = MetricUnit::PERCENT;
+      } else if (unit == "cycles") {
+        metric.unit = MetricUnit::CYCLES;
+      } else if (unit == "GHz") {
+        metric.unit = MetricUnit::GHZ;
+      } else {
+        error = "line " + std::to_string(line_no) + ": unknown unit '" + unit + "'";
+        return false;
+      }
+      lhs = trim(lhs.substr(0, bracket_pos));
+    }
+    if (lhs.empty()) {
+      error = "line " + std::to_string(line_no) + ": missing metric name";
+      return false;
+    }
+    metric.name = lhs;
+
+    std::string expression = line.substr(eq_pos + 1);
+    ExpressionParser parser(expression, resolver, metric);
+    std::string parse_error;
+    if (!parser.parse(parse_error)) {
+      error = "line " + std::to_string(line_no) + ": " + parse_error;
+      return false;
+    }
+    if (metric.max_stack_depth > MAX_STACK_DEPTH) {
+      error = "line " + std::to_string(line_no) + ": expression is too deep";
+      return false;
+    }
+    if (!parser.get_unknown_event().empty()) {
+      std::cerr << "Warning: Metric \"" << metric.name << "\" is skipped, event "
+                << parser.get_unknown_event() << " is not configured" << std::endl;
+      continue;
+    }
+
+    compiled.push_back(std::move(metric));
+  }
+
+  metrics_.insert(metrics_.end(), compiled.begin(), compiled.end());
+  return true;
+}
+
+bool MetricEngine::load_file(const std::string &filename, const EventResolver &resolver, std::string &error) {
+  std::ifstream infile(filename);
+  if (!infile.is_open()) {
+    error = "failed to open " + filename;
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << infile.rdbuf();
+  return compile(buffer.str(), resolver, error);
+}
+
+double MetricEngine::evaluate(const CompiledMetric &metric, const std::vector<double> &event_values, const double *variables) {
+  double stack[MAX_STACK_DEPTH];
+  size_t top = 0;  // The number of values in the stack
+
+  for (const auto &instruction : metric.code) {
+    switch (instruction.op) {
+      case Instruction::PUSH_CONST:
+        stack[top++] = instruction.constant;
+        break;
+      case Instruction::PUSH_EVENT:
+        stack[top++] = instruction.index < event_values.size() ? event_values[instruction.index] : 0.0;
+        break;
+      case Instruction::PUSH_VAR:
+        stack[top++] = variables[instruction.index];
+        break;
+      case Instruction::ADD:
+        --top;
+        stack[top - 1] += stack[top];
+        break;
+      case Instruction::SUB:
+        --top;
+        stack[top - 1] -= stack[top];
+        break;
+      case Instruction::MUL:
+        --top;
+        stack[top - 1] *= stack[top];
+        break;
+      case Instruction::DIV:
+        --top;
+        stack[top - 1] = (stack[top] != 0.0) ? stack[top - 1] / stack[top] : 0.0;
+        break;
+      case Instruction::NEG:
+        stack[top - 1] = -stack[top - 1];
+        break;
+    }
+  }
+  return top > 0 ? stack[top - 1] : 0.0;
+}
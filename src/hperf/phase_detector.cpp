@@ -0,0 +1,106 @@
+#include "hperf/phase_detector.h"
+
+#include <algorithm>
+#include <cmath>
+
+// The weight of the latest interval in the exponentially weighted mean and variance
+#define PHASE_EWMA_ALPHA 0.2
+
+// The number of intervals to build a baseline before any change can be reported
+#define PHASE_WARMUP_INTERVALS 3
+
+// Intervals with fewer counts of the first fixed event (cycles) are ignored
+#define PHASE_MIN_REFERENCE_COUNT 100000
+
+// The shortest interval of the fast rotation
+#define FAST_ROTATION_MIN_PERIOD_NS 10000000ULL
+
+PhaseDetector::PhaseDetector(size_t fixed_event_num, double threshold)
+    : fixed_event_num_(fixed_event_num),
+      threshold_(threshold),
+      n_(0),
+      means_(fixed_event_num > 1 ? fixed_event_num - 1 : 0, 0.0),
+      vars_(fixed_event_num > 1 ? fixed_event_num - 1 : 0, 0.0) {}
+
+bool PhaseDetector::observe(const GroupReadBuffer &buffer) {
+  if (means_.empty() || buffer.nr() < fixed_event_num_) return false;
+
+  const uint64_t reference = buffer.entry(0)->value;
+  if (reference < PHASE_MIN_REFERENCE_COUNT) return false;
+
+  std::vector<double> ratios(means_.size());
+  for (size_t i = 0; i < ratios.size(); ++i) {
+    ratios[i] = (double)buffer.entry(i + 1)->value / reference;
+  }
+
+  bool changed = false;
+  if (n_ >= PHASE_WARMUP_INTERVALS) {
+    for (size_t i = 0; i < ratios.size(); ++i) {
+      double deviation = std::fabs(ratios[i] - means_[i]);
+      if (deviation > threshold_ * means_[i] && deviation > 3 * std::sqrt(vars_[i])) {
+        changed = true;
+        break;
+      }
+    }
+  }
+
+  if (changed || n_ == 0) {
+    // (Re)start the baseline from this interval
+    means_ = ratios;
+    std::fill(vars_.begin(), vars_.end(), 0.0);
+    n_ = 1;
+    return changed;
+  }
+
+  for (size_t i = 0; i < ratios.size(); ++i) {
+    double delta = ratios[i] - means_[i];
+    means_[i] += PHASE_EWMA_ALPHA * delta;
+    vars_[i] = (1 - PHASE_EWMA_ALPHA) * (vars_[i] + PHASE_EWMA_ALPHA * delta * delta);
+  }
+  ++n_;
+  return false;
+}
+
+FastRotationWindow::FastRotationWindow(IntervalTimer &timer, size_t group_num)
+    : timer_(timer),
+      group_num_(group_num),
+      normal_period_(timer.get_period()),
+      fast_(false),
+      unread_num_(0),
+      fast_interval_num_(0) {
+  fast_period_ = group_num_ > 1 ? std::max<uint64_t>(normal_period_ / group_num_, FAST_ROTATION_MIN_PERIOD_NS) : normal_period_;
+  fast_period_ = std::min(fast_period_, normal_period_);
+}
+
+void FastRotationWindow::mark_read(size_t reader, size_t group_idx, size_t group_num) {
+  if (reader >= read_.size()) read_.resize(reader + 1);
+  if (read_[reader].size() != group_num) read_[reader].assign(group_num, false);  // The reader is seen for the first time
+  if (fast_ && group_idx < group_num && !read_[reader][group_idx]) {
+    read_[reader][group_idx] = true;
+    --unread_num_;
+  }
+}
+
+void FastRotationWindow::update(bool phase_changed) {
+  if (fast_period_ >= normal_period_) return;  // A single group, or the interval is already short
+
+  if (phase_changed) {
+    if (!fast_) timer_.set_period(fast_period_);
+    fast_ = true;
+    // The groups read so far (including in this interval) may have seen the old phase
+    unread_num_ = 0;
+    for (auto &groups : read_) {
+      std::fill(groups.begin(), groups.end(), false);
+      unread_num_ += groups.size();
+    }
+    fast_interval_num_ = 0;
+  } else if (fast_) {
+    ++fast_interval_num_;
+    // Without any reader (mark_read() never called), a round-robin rotation of all the groups is assumed
+    const bool all_read = read_.empty() ? fast_interval_num_ >= group_num_ : unread_num_ == 0;
+    if (all_read) {
+      timer_.set_period(normal_period_);
+      fast_ = false;
+    }
+  }
+}
@@ -4,9 +4,12 @@
 #include <cstddef>
 #include <iostream>
 #include <ostream>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
-#include <limits>
 
+#include "hperf/event_discovery.h"
+#include "hperf/event_grouping.h"
 #include "hperf/pmu_event.h"
 
 // Include the specified PMU config header based on compilation option.
@@ -19,11 +22,37 @@
 #include "hperf/pmu_config/cpu_icx.h"
 #elif defined(CPU_CLX)
 #include "hperf/pmu_config/cpu_clx.h"
+#elif defined(CPU_CORTEX_X4)
+#include "hperf/pmu_config/model_cortex_x4.h"
+#define PMU_MODEL PMUModelCortexX4
 #else
 #error "No CPU model defined."
 #endif
 
-PMUConfig::PMUConfig() : fixed_events_(::fixed_events), event_groups_(::event_groups) {}
+#if defined(PMU_MODEL)
+// A generated model has no global vectors to copy, see pmu_model.h
+PMUConfig::PMUConfig() : PMUConfig(make_pmu_config<PMU_MODEL>()) {}
+#else
+PMUConfig::PMUConfig() : fixed_events_(::fixed_events), event_groups_(::event_groups), metric_definitions_(::metric_definitions) {}
+#endif
+
+PMUConfig::PMUConfig(std::vector<PMUEvent> fixed_events, std::vector<std::vector<PMUEvent>> event_groups, std::string metric_definitions)
+    : fixed_events_(std::move(fixed_events)),
+      event_groups_(std::move(event_groups)),
+      metric_definitions_(std::move(metric_definitions)) {}
+
+bool PMUConfig::load_event_file(const std::string& filename) {
+  EventFileConfig config;
+  if (!::load_event_file(filename, config)) {
+    return false;
+  }
+  fixed_events_ = std::move(config.fixed_events);
+  event_groups_ = std::move(config.event_groups);
+  if (!config.metric_definitions.empty()) {
+    metric_definitions_ = std::move(config.metric_definitions);
+  }
+  return true;
+}
 
 bool PMUConfig::is_valid() const {
   if (fixed_events_.empty() || event_groups_.empty()) {
@@ -63,6 +92,42 @@ const std::vector<PMUEvent>& PMUConfig::get_event_group_by_idx(size_t idx) const
   }
 }
 
+std::vector<PMUEvent> PMUConfig::get_all_events() const {
+  std::vector<PMUEvent> all_events = fixed_events_;
+  for (const auto& event_group : event_groups_) {
+    for (const auto& pmu_event : event_group) {
+      auto same_name = [&pmu_event](const PMUEvent& e) { return e.name == pmu_event.name; };
+      if (std::find_if(all_events.begin(), all_events.end(), same_name) == all_events.end()) {
+        all_events.push_back(pmu_event);
+      }
+    }
+  }
+  return all_events;
+}
+
+int PMUConfig::get_event_index(const std::string& name) const {
+  // Walk the events in the order of get_all_events() without copying them, counting each name at its first occurrence
+  std::unordered_set<std::string_view> seen;
+  int idx = 0;
+  for (const auto& pmu_event : fixed_events_) {
+    if (pmu_event.name == name) return idx;
+    seen.insert(pmu_event.name);
+    ++idx;
+  }
+  for (const auto& event_group : event_groups_) {
+    for (const auto& pmu_event : event_group) {
+      if (!seen.insert(pmu_event.name).second) continue;
+      if (pmu_event.name == name) return idx;
+      ++idx;
+    }
+  }
+  return -1;
+}
+
+const std::string& PMUConfig::get_metric_definitions() const {
+  return metric_definitions_;
+}
+
 size_t PMUConfig::get_event_group_num() const {
   return event_groups_.size();
 }
@@ -98,75 +163,113 @@ void PMUConfig::print_event_groups_by_line() const {
   }
 }
 
-void PMUConfig::adaptive_grouping(size_t programmable_counters_num) {
-  auto get_smallest_event_group_idx = [](const std::vector<std::vector<PMUEvent>>& event_groups) {
-    size_t smallest_idx = 0;
-    for (size_t i = 1; i < event_groups.size(); ++i) {
-      if (event_groups[i].size() < event_groups[smallest_idx].size()) {
-        smallest_idx = i;
-      }
+void PMUConfig::adaptive_grouping(size_t programmable_counters_num, const std::vector<std::pair<EventKey, EventKey>>& conflicts) {
+  // Repack all the schedulable events from scratch, so oversized groups are split as well as small groups merged
+  std::vector<PMUEvent> events;
+  for (const auto& event_group : event_groups_) {
+    events.insert(events.end(), event_group.begin(), event_group.end());
+  }
+
+  EventGroupingSolver solver(fixed_events_, programmable_counters_num + fixed_events_.size());
+  solver.set_conflicts(conflicts);
+  std::vector<std::vector<PMUEvent>> groups;
+  if (!solver.solve(events, groups)) {
+    std::cerr << "Adaptive grouping failed, the original event groups are kept." << std::endl;
+    return;
+  }
+
+  std::cout << "Adaptive grouping: " << event_groups_.size() << " -> " << groups.size() << " event groups (lower bound "
+            << solver.get_lower_bound() << ", " << (solver.is_optimal() ? "optimal" : "search stopped at the node limit")
+            << ", " << solver.get_node_num() << " search nodes)" << std::endl;
+  event_groups_ = std::move(groups);
+}
+
+void PMUConfig::metric_aware_grouping(size_t programmable_counters_num, const std::vector<CompiledMetric>& metrics,
+                                      const std::vector<std::pair<EventKey, EventKey>>& conflicts) {
+  const auto all_events = get_all_events();
+  const size_t fixed_event_num = fixed_events_.size();
+
+  // The minimal event set: the schedulable events referenced by any metric, in the order of get_all_events()
+  std::vector<bool> referenced(all_events.size(), false);
+  for (const auto& metric : metrics) {
+    for (size_t idx : metric.event_operands) {
+      if (idx < referenced.size()) referenced[idx] = true;
     }
-    return smallest_idx;
-  };
-
-  auto less_by_encoding = [](const PMUEvent& a, const PMUEvent& b) {
-    return a.encoding < b.encoding;
-  };
-
-  auto count_union_by_encoding = [&less_by_encoding](const std::vector<PMUEvent>& a,
-                                                     const std::vector<PMUEvent>& b) {
-    std::vector<PMUEvent> a_sorted = a;
-    std::vector<PMUEvent> b_sorted = b;
-    std::sort(a_sorted.begin(), a_sorted.end(), less_by_encoding);
-    std::sort(b_sorted.begin(), b_sorted.end(), less_by_encoding);
-
-    std::vector<PMUEvent> out;
-    out.reserve(a_sorted.size() + b_sorted.size());
-    std::set_union(a_sorted.begin(), a_sorted.end(), b_sorted.begin(), b_sorted.end(),
-                   std::back_inserter(out), less_by_encoding);
-    return out.size();
-  };
-
-  auto union_by_encoding = [&less_by_encoding](std::vector<PMUEvent> a,
-                                               std::vector<PMUEvent> b) {
-    std::sort(a.begin(), a.end(), less_by_encoding);
-    std::sort(b.begin(), b.end(), less_by_encoding);
-
-    std::vector<PMUEvent> out;
-    out.reserve(a.size() + b.size());
-    std::set_union(a.begin(), a.end(), b.begin(), b.end(),
-                   std::back_inserter(out), less_by_encoding);
-    return out;
-  };
-
-  while (true) {
-    if (event_groups_.size() < 2)
-      break;
-
-    // Find i, G_i = argmin(|G|)
-    size_t i = get_smallest_event_group_idx(event_groups_);
-
-    // Find j, G_j = argmin(|G_i U G|)
-    size_t j = 0;
-    size_t merged_size = std::numeric_limits<size_t>::max();
-    for (size_t k = 0; k < event_groups_.size(); ++k) {
-      if (k != i) {
-        size_t current_merged_size = count_union_by_encoding(event_groups_[i], event_groups_[k]);
-        if (current_merged_size < merged_size) {
-          merged_size = current_merged_size;
-          j = k;
-        }
-      }
+  }
+  std::vector<PMUEvent> events;
+  std::vector<int> position(all_events.size(), -1);  // event index -> position in `events`
+  std::vector<std::string> dropped;
+  for (size_t idx = fixed_event_num; idx < all_events.size(); ++idx) {
+    if (referenced[idx]) {
+      position[idx] = static_cast<int>(events.size());
+      events.push_back(all_events[idx]);
+    } else {
+      dropped.push_back(all_events[idx].name);
     }
+  }
 
-    if (count_union_by_encoding(event_groups_[i], event_groups_[j]) <= programmable_counters_num) {
-      std::vector<PMUEvent> merged = union_by_encoding(event_groups_[i], event_groups_[j]);
-      if (i > j) std::swap(i, j);
-      event_groups_.erase(event_groups_.begin() + j);
-      event_groups_.erase(event_groups_.begin() + i);
-      event_groups_.push_back(merged);
-    } else {
-      break;
+  if (events.empty()) {
+    std::cerr << "Metric-aware grouping: no schedulable event is used by the metrics, the original event groups are kept." << std::endl;
+    return;
+  }
+
+  // The schedulable operands of each metric (the fixed events are counted in every group)
+  std::vector<std::vector<size_t>> affinity_sets;
+  std::vector<const CompiledMetric*> affinity_metrics;
+  for (const auto& metric : metrics) {
+    std::vector<size_t> operands;
+    for (size_t idx : metric.event_operands) {
+      if (idx < position.size() && position[idx] >= 0) operands.push_back(position[idx]);
     }
+    if (operands.size() < 2) continue;
+    affinity_sets.push_back(operands);
+    affinity_metrics.push_back(&metric);
   }
-}
\ No newline at end of file
+
+  EventGroupingSolver solver(fixed_events_, programmable_counters_num + fixed_event_num);
+  solver.set_conflicts(conflicts);
+  std::vector<std::vector<PMUEvent>> groups;
+  if (!solver.solve(events, affinity_sets, groups)) {
+    std::cerr << "Metric-aware grouping failed, the original event groups are kept." << std::endl;
+    return;
+  }
+
+  std::cout << "Metric-aware grouping: " << event_groups_.size() << " -> " << groups.size() << " event groups for "
+            << metrics.size() << " metrics (lower bound " << solver.get_lower_bound() << ", "
+            << (solver.is_optimal() ? "optimal" : "search stopped at the node limit") << ", "
+            << solver.get_node_num() << " search nodes)" << std::endl;
+  if (!dropped.empty()) {
+    std::cout << "Events not used by any metric are dropped:";
+    for (const auto& name : dropped) std::cout << " " << name;
+    std::cout << std::endl;
+  }
+  if (!solver.get_split_sets().empty()) {
+    std::cout << "Metrics with operands in different event groups:";
+    for (size_t s : solver.get_split_sets()) std::cout << " \"" << affinity_metrics[s]->name << "\"";
+    std::cout << std::endl;
+  }
+  event_groups_ = std::move(groups);
+}
+
+void PMUConfig::append_event_groups(const PMUConfig& other) {
+  event_groups_.insert(event_groups_.end(), other.event_groups_.begin(), other.event_groups_.end());
+}
+
+std::vector<std::string> PMUConfig::remove_events(const std::vector<EventKey>& events) {
+  std::vector<std::string> removed;
+  for (auto& event_group : event_groups_) {
+    auto is_removed = [&events](const PMUEvent& e) {
+      return std::find(events.begin(), events.end(), get_event_key(e)) != events.end();
+    };
+    for (const auto& pmu_event : event_group) {
+      if (is_removed(pmu_event) && std::find(removed.begin(), removed.end(), pmu_event.name) == removed.end()) {
+        removed.push_back(pmu_event.name);
+      }
+    }
+    event_group.erase(std::remove_if(event_group.begin(), event_group.end(), is_removed), event_group.end());
+  }
+  event_groups_.erase(std::remove_if(event_groups_.begin(), event_groups_.end(),
+                                     [](const std::vector<PMUEvent>& event_group) { return event_group.empty(); }),
+                      event_groups_.end());
+  return removed;
+}
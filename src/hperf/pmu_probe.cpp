@@ -0,0 +1,404 @@
+#include "hperf/pmu_probe.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#include "hperf/cache_dir.h"
+#include "hperf/counter_detector.h"
+#include "hperf/file_utils.h"
+#include "hperf/read_buffer.h"
+
+// The prefix of the probe database files in the cache directory, a file per hardware fingerprint
+#define PROBE_DB_PREFIX "probe-"
+
+// The time each group probe counts its events, a group that cannot be scheduled never runs
+#define GROUP_PROBE_WINDOW_US 5000
+
+namespace {
+
+/**
+ * @brief The identification fields of each processor in /proc/cpuinfo, for the CPUs without MIDR_EL1 in sysfs
+ */
+std::map<int, std::string> read_cpuinfo_ids() {
+  std::map<int, std::string> ids;
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  int processor = -1;
+  while (std::getline(cpuinfo, line)) {
+    auto colon = line.find(':');
+    if (colon == std::string::npos) continue;
+    std::string key = line.substr(0, colon);
+    key.erase(key.find_last_not_of(" \t") + 1);
+    std::string value = (colon + 2 <= line.size()) ? line.substr(colon + 2) : "";
+    if (key == "processor") {
+      processor = std::atoi(value.c_str());
+    } else if (processor >= 0 && (key == "vendor_id" || key == "cpu family" || key == "model" || key == "stepping" ||
+                                  key == "CPU implementer" || key == "CPU part" || key == "CPU variant" || key == "CPU revision")) {
+      ids[processor] += (ids[processor].empty() ? "" : "/") + value;
+    }
+  }
+  return ids;
+}
+
+/**
+ * @brief Parse a whole token as an unsigned number (decimal, or hexadecimal with 0x)
+ */
+bool parse_number(const std::string &token, uint64_t &value) {
+  if (token.empty() || token[0] == '-') return false;
+  char *end = nullptr;
+  errno = 0;
+  value = strtoull(token.c_str(), &end, 0);
+  return errno == 0 && end == token.c_str() + token.size();
+}
+
+int perf_event_open(struct perf_event_attr *pe, int cpu_id, int group_fd) {
+  return syscall(__NR_perf_event_open, pe, -1, cpu_id, group_fd, 0);
+}
+
+void configure_event(struct perf_event_attr *pe, uint32_t type, uint64_t encoding, bool is_group_leader) {
+  memset(pe, 0, sizeof(struct perf_event_attr));
+  pe->type = type;
+  pe->size = sizeof(struct perf_event_attr);
+  pe->config = encoding;
+  pe->read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING | PERF_FORMAT_ID | PERF_FORMAT_GROUP;
+  pe->disabled = is_group_leader ? 1 : 0;
+}
+
+void close_all(const std::vector<int> &fds) {
+  for (int fd : fds) close(fd);
+}
+
+}  // namespace
+
+std::string read_hardware_fingerprint() {
+  std::ostringstream fingerprint;
+  const long cpu_num = sysconf(_SC_NPROCESSORS_ONLN);
+  std::map<int, std::string> cpuinfo_ids;
+  for (long cpu_id = 0; cpu_id < cpu_num; ++cpu_id) {
+    std::string id = read_first_line("/sys/devices/system/cpu/cpu" + std::to_string(cpu_id) + "/regs/identification/midr_el1");
+    if (id.empty()) {
+      if (cpuinfo_ids.empty()) cpuinfo_ids = read_cpuinfo_ids();
+      id = cpuinfo_ids.count(cpu_id) ? cpuinfo_ids[cpu_id] : "unknown";
+    }
+    fingerprint << "cpu" << cpu_id << "=" << id << ";";
+  }
+
+  struct utsname uts;
+  fingerprint << "kernel=" << (uname(&uts) == 0 ? uts.release : "unknown") << ";";
+
+  std::string watchdog = read_first_line("/proc/sys/kernel/nmi_watchdog");
+  fingerprint << "nmi_watchdog=" << (watchdog.empty() ? "n/a" : watchdog);
+  return fingerprint.str();
+}
+
+PMUProbe::PMUProbe(const PMUConfig &pmu_config)
+    : pmu_config_(pmu_config),
+      fingerprint_(read_hardware_fingerprint()),
+      valid_(false) {
+  const size_t fixed_event_num = pmu_config_.get_fixed_events().size();
+  const auto all_events = pmu_config_.get_all_events();
+  for (size_t i = fixed_event_num; i < all_events.size(); ++i) {
+    const EventKey key = get_event_key(all_events[i]);
+    if (std::find(events_.begin(), events_.end(), key) == events_.end()) events_.push_back(key);
+  }
+}
+
+std::string PMUProbe::get_db_path() const {
+  const std::string cache_dir = get_cache_dir();
+  if (cache_dir.empty()) return "";
+  std::ostringstream path;
+  path << cache_dir << "/" << PROBE_DB_PREFIX << std::hex << fnv1a(fingerprint_);
+  return path.str();
+}
+
+bool PMUProbe::load() {
+  const std::string db_path = get_db_path();
+  if (db_path.empty()) return false;
+  std::ifstream infile(db_path);
+  if (!infile.is_open()) return false;
+
+  // Any malformed line (e.g., a truncated file) makes the whole entry a miss, it is probed and saved again.
+  // An event is written as its type and encoding.
+  std::vector<CpuCapability> capabilities(sysconf(_SC_NPROCESSORS_ONLN));
+  std::vector<EventKey> probed_events;
+  bool fingerprint_matched = false;
+  std::string line;
+  while (std::getline(infile, line)) {
+    std::istringstream fields(line);
+    std::string kind;
+    if (!(fields >> kind)) continue;
+    if (kind == "fingerprint") {
+      fingerprint_matched = (line.size() > kind.size() && line.substr(kind.size() + 1) == fingerprint_);
+      continue;
+    }
+
+    std::vector<uint64_t> numbers;
+    std::string token;
+    while (fields >> token) {
+      uint64_t number;
+      if (!parse_number(token, number)) return false;
+      numbers.push_back(number);
+    }
+    // The events of a line, from the `first`-th number
+    auto events_from = [&numbers](size_t first, std::vector<EventKey> &events) {
+      if (first > numbers.size() || (numbers.size() - first) % 2 != 0) return false;
+      for (size_t i = first; i < numbers.size(); i += 2) {
+        if (numbers[i] > UINT32_MAX) return false;
+        events.emplace_back(static_cast<uint32_t>(numbers[i]), numbers[i + 1]);
+      }
+      return true;
+    };
+    if (kind == "events") {
+      if (!events_from(0, probed_events)) return false;
+      continue;
+    }
+    if (numbers.empty() || numbers[0] >= capabilities.size()) return false;
+    CpuCapability &capability = capabilities[numbers[0]];
+    std::vector<EventKey> events;
+    if (kind == "cpu" && numbers.size() == 2 && numbers[1] <= static_cast<uint64_t>(INT_MAX)) {
+      capability.counter_num = static_cast<int>(numbers[1]);
+    } else if (kind == "unsupported" && numbers.size() == 3 && events_from(1, events)) {
+      capability.unsupported_events.push_back(events[0]);
+    } else if (kind == "conflict" && numbers.size() == 5 && events_from(1, events)) {
+      capability.conflicts.emplace_back(events[0], events[1]);
+    } else {
+      return false;
+    }
+  }
+
+  // Another machine with the same hash, or events probed before they were configured: probe again
+  if (!fingerprint_matched) return false;
+  for (const EventKey &event : events_) {
+    if (std::find(probed_events.begin(), probed_events.end(), event) == probed_events.end()) return false;
+  }
+
+  capabilities_ = std::move(capabilities);
+  valid_ = true;
+  return true;
+}
+
+bool PMUProbe::save() const {
+  const std::string db_path = get_db_path();
+  if (db_path.empty()) {
+    std::cerr << "No private cache directory, the probe result is not saved" << std::endl;
+    return false;
+  }
+  std::ofstream outfile(db_path);
+  if (!outfile.is_open()) {
+    std::cerr << "Failed to create " << db_path << std::endl;
+    return false;
+  }
+
+  auto write_event = [&outfile](const EventKey &event) {
+    outfile << " " << std::dec << event.first << " " << std::hex << event.second;
+  };
+  outfile << "fingerprint " << fingerprint_ << "\n" << std::showbase;
+  outfile << "events";
+  for (const EventKey &event : events_) write_event(event);
+  outfile << "\n";
+  for (size_t cpu_id = 0; cpu_id < capabilities_.size(); ++cpu_id) {
+    const auto &capability = capabilities_[cpu_id];
+    outfile << std::dec << "cpu " << cpu_id << " " << capability.counter_num << "\n";
+    for (const EventKey &event : capability.unsupported_events) {
+      outfile << std::dec << "unsupported " << cpu_id;
+      write_event(event);
+      outfile << "\n";
+    }
+    for (const auto &conflict : capability.conflicts) {
+      outfile << std::dec << "conflict " << cpu_id;
+      write_event(conflict.first);
+      write_event(conflict.second);
+      outfile << "\n";
+    }
+  }
+  return true;
+}
+
+void PMUProbe::run() {
+  if (load()) return;
+
+  // The CPUs are independent, probe them all at the same time
+  capabilities_.assign(sysconf(_SC_NPROCESSORS_ONLN), CpuCapability());
+  std::vector<std::thread> threads;
+  for (size_t cpu_id = 0; cpu_id < capabilities_.size(); ++cpu_id) {
+    threads.emplace_back([this, cpu_id] { capabilities_[cpu_id] = probe_cpu(static_cast<int>(cpu_id)); });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  valid_ = true;
+
+  // A failed probe (e.g., no permission) is not cached, so that it is retried next time
+  bool all_detected = std::all_of(capabilities_.begin(), capabilities_.end(),
+                                  [](const CpuCapability &capability) { return capability.counter_num > 0; });
+  if (all_detected) save();
+}
+
+CpuCapability PMUProbe::probe_cpu(int cpu_id) const {
+  CpuCapability capability;
+  capability.counter_num = CounterDetector::detect_on_cpu(cpu_id);
+  if (capability.counter_num <= 0) return capability;
+
+  // The events that can be opened on their own
+  std::vector<EventKey> supported_events;
+  for (const EventKey &event : events_) {
+    struct perf_event_attr pe;
+    configure_event(&pe, event.first, event.second, true);
+    int fd = perf_event_open(&pe, cpu_id, -1);
+    if (fd == -1) {
+      capability.unsupported_events.push_back(event);
+    } else {
+      close(fd);
+      supported_events.push_back(event);
+    }
+  }
+
+  const size_t fixed_event_num = pmu_config_.get_fixed_events().size();
+  if (capability.counter_num > (int)fixed_event_num) {
+    find_conflicts(cpu_id, capability.counter_num - fixed_event_num, supported_events, capability);
+  }
+  return capability;
+}
+
+bool PMUProbe::test_group(int cpu_id, const std::vector<EventKey> &events) const {
+  std::vector<EventKey> group;
+  for (const auto &pmu_event : pmu_config_.get_fixed_events()) group.push_back(get_event_key(pmu_event));
+  group.insert(group.end(), events.begin(), events.end());
+
+  // Some PMU drivers already reject a group that can never be scheduled when it is created
+  std::vector<int> fds;
+  for (const EventKey &event : group) {
+    struct perf_event_attr pe;
+    configure_event(&pe, event.first, event.second, fds.empty());
+    int fd = perf_event_open(&pe, cpu_id, fds.empty() ? -1 : fds.front());
+    if (fd == -1) {
+      close_all(fds);
+      return false;
+    }
+    fds.push_back(fd);
+  }
+
+  GroupReadBuffer buffer(fds.size());
+  bool scheduled = ioctl(fds.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != -1;
+  usleep(GROUP_PROBE_WINDOW_US);
+  scheduled = scheduled && ioctl(fds.front(), PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP) != -1;
+  scheduled = scheduled && read(fds.front(), buffer.data(), buffer.size()) == static_cast<ssize_t>(buffer.size());
+  scheduled = scheduled && buffer.time_enabled() > 0 && buffer.time_running() == buffer.time_enabled();
+  close_all(fds);
+  return scheduled;
+}
+
+void PMUProbe::find_conflicts(int cpu_id, size_t capacity, const std::vector<EventKey> &events, CpuCapability &capability) const {
+  if (events.size() < 2) return;
+  if (events.size() <= capacity && test_group(cpu_id, events)) return;
+
+  std::vector<EventKey> a(events.begin(), events.begin() + events.size() / 2);
+  std::vector<EventKey> b(events.begin() + events.size() / 2, events.end());
+  find_conflicts(cpu_id, capacity, a, capability);
+  find_conflicts(cpu_id, capacity, b, capability);
+  find_cross_conflicts(cpu_id, capacity, a, b, capability);
+}
+
+void PMUProbe::find_cross_conflicts(int cpu_id, size_t capacity, const std::vector<EventKey> &a, const std::vector<EventKey> &b,
+                                    CpuCapability &capability) const {
+  std::vector<EventKey> both = a;
+  both.insert(both.end(), b.begin(), b.end());
+  if (both.size() <= capacity && test_group(cpu_id, both)) return;
+
+  if (a.size() == 1 && b.size() == 1) {
+    if (capacity >= 2) capability.conflicts.emplace_back(a.front(), b.front());
+    return;
+  }
+
+  // Split the larger side
+  const auto &larger = (a.size() >= b.size()) ? a : b;
+  const auto &other = (a.size() >= b.size()) ? b : a;
+  std::vector<EventKey> first(larger.begin(), larger.begin() + larger.size() / 2);
+  std::vector<EventKey> second(larger.begin() + larger.size() / 2, larger.end());
+  find_cross_conflicts(cpu_id, capacity, first, other, capability);
+  find_cross_conflicts(cpu_id, capacity, second, other, capability);
+}
+
+const CpuCapability &PMUProbe::get_capability(int cpu_id) const {
+  static const CpuCapability undetected{};
+  if (cpu_id < 0 || static_cast<size_t>(cpu_id) >= capabilities_.size()) return undetected;
+  return capabilities_[cpu_id];
+}
+
+std::vector<EventKey> PMUProbe::get_unsupported_events(const std::vector<int> &cpu_ids) const {
+  std::vector<EventKey> unsupported;
+  for (int cpu_id : cpu_ids) {
+    for (const EventKey &event : get_capability(cpu_id).unsupported_events) {
+      if (std::find(unsupported.begin(), unsupported.end(), event) == unsupported.end()) unsupported.push_back(event);
+    }
+  }
+  return unsupported;
+}
+
+std::vector<std::pair<EventKey, EventKey>> PMUProbe::get_conflicts(const std::vector<int> &cpu_ids) const {
+  std::vector<std::pair<EventKey, EventKey>> conflicts;
+  for (int cpu_id : cpu_ids) {
+    for (const auto &conflict : get_capability(cpu_id).conflicts) {
+      if (std::find(conflicts.begin(), conflicts.end(), conflict) == conflicts.end()) conflicts.push_back(conflict);
+    }
+  }
+  return conflicts;
+}
+
+std::vector<int> PMUProbe::get_cpu_ids() const {
+  std::vector<int> cpu_ids(capabilities_.size());
+  for (size_t cpu_id = 0; cpu_id < cpu_ids.size(); ++cpu_id) cpu_ids[cpu_id] = static_cast<int>(cpu_id);
+  return cpu_ids;
+}
+
+void PMUProbe::print_result() const {
+  if (!valid_) {
+    std::cerr << "The PMU capabilities are not probed" << std::endl;
+    return;
+  }
+
+  // Event names for the report
+  auto name_of = [this](const EventKey &event) {
+    for (const auto &pmu_event : pmu_config_.get_all_events()) {
+      if (get_event_key(pmu_event) == event) return pmu_event.name;
+    }
+    std::ostringstream hex;
+    hex << event.first << ":0x" << std::hex << event.second;
+    return hex.str();
+  };
+
+  for (size_t cpu_id = 0; cpu_id < capabilities_.size(); ++cpu_id) {
+    const auto &capability = capabilities_[cpu_id];
+    if (capability.counter_num > 0) {
+      std::cout << capability.counter_num << " available programmable counters on CPU " << cpu_id << std::endl;
+    } else {
+      std::cout << "Undetected on CPU " << cpu_id << std::endl;
+      continue;
+    }
+    if (!capability.unsupported_events.empty()) {
+      std::cout << "  Unsupported events:";
+      for (const EventKey &event : capability.unsupported_events) std::cout << " " << name_of(event);
+      std::cout << std::endl;
+    }
+    if (!capability.conflicts.empty()) {
+      std::cout << "  Conflicting events:";
+      for (const auto &conflict : capability.conflicts) std::cout << " (" << name_of(conflict.first) << ", " << name_of(conflict.second) << ")";
+      std::cout << std::endl;
+    }
+  }
+}
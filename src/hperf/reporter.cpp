@@ -11,68 +11,365 @@
 
 #include "hperf/reporter.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <iomanip>
 #include <ios>
 #include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
 
-static inline uint64_t read_cntfrq_el0(void);
+#include "hperf/interval_metric_writer.h"
+
+// At most this number of phase boundaries are listed in the statistics
+#define MAX_PRINTED_PHASE_BOUNDARIES 10
+
+// At most this number of threads are listed by print_threads(), the rest are only in the raw data
+#define MAX_PRINTED_THREADS 32
 
 Reporter::Reporter(const PMUConfig& pmu_config)
     : pmu_config_(pmu_config),
-      total_time_in_ns_(0),
-      prev_timestamp_(0) {
+      interval_metric_writer_(nullptr),
+      core_type_layouts_(nullptr),
+      thread_names_(nullptr),
+      unmeasured_thread_num_(0),
+      estimator_(EstimatorType::WALL_CLOCK),
+      reference_event_id_(0),
+      interval_start_timestamp_(0) {
   fixed_event_num_ = pmu_config_.get_fixed_events().size();
 
   int event_group_num = pmu_config_.get_event_group_num();
-  enabled_time_in_ns_.resize(event_group_num);
-  stat_.resize(event_group_num);
+  init_stats_(overall_);
+
+  // Resolve the position of each event of each group to its event index once, so that the metrics never look up events by name
+  event_slots_.resize(event_group_num);
+  for (int i = 0; i < event_group_num; ++i) {
+    for (size_t j = 0; j < overall_.stat[i].size(); ++j) {
+      event_slots_[i].push_back(pmu_config_.get_event_index(pmu_config_.get_pmu_event(i, j).name));
+    }
+  }
+
+  std::string error;
+  auto resolver = [this](const std::string& name) { return pmu_config_.get_event_index(name); };
+  if (!metric_engine_.compile(pmu_config_.get_metric_definitions(), resolver, error)) {
+    std::cerr << "Error: Invalid embedded metric definitions, " << error << std::endl;
+  }
+}
+
+Reporter::~Reporter() {}
+
+void Reporter::init_stats_(StatTable& table) {
+  int event_group_num = pmu_config_.get_event_group_num();
+  table.enabled_time_in_ns.resize(event_group_num);
+  table.kernel_time_in_ns.resize(event_group_num);
+  table.stat.resize(event_group_num);
 
   for (int i = 0; i < event_group_num; ++i) {
     const auto& current_event_group = pmu_config_.get_event_group_by_idx(i);
     int in_group_schedulable_event_num = current_event_group.size();
-    stat_[i].resize(fixed_event_num_ + in_group_schedulable_event_num, EventStats());
+    table.stat[i].resize(fixed_event_num_ + in_group_schedulable_event_num, EventStats());
   }
+  table.event_values.assign(pmu_config_.get_all_events().size(), 0.0);
+  table.event_ci_half_widths.assign(table.event_values.size(), 0.0);
+  table.event_coverages.assign(table.event_values.size(), 0.0);
 }
 
-Reporter::~Reporter() {}
+bool Reporter::set_estimator(EstimatorType estimator, const std::string& reference_event) {
+  if (estimator == EstimatorType::REFERENCE_EVENT) {
+    const auto& fixed_events = pmu_config_.get_fixed_events();
+    auto it = std::find_if(fixed_events.begin(), fixed_events.end(),
+                           [&reference_event](const PMUEvent& e) { return e.name == reference_event; });
+    if (it == fixed_events.end()) {
+      std::cerr << "Error: The reference event must be one of the fixed events, got \"" << reference_event << "\"" << std::endl;
+      return false;
+    }
+    reference_event_id_ = it - fixed_events.begin();
+  }
+  estimator_ = estimator;
+  return true;
+}
+
+bool Reporter::load_metrics(const std::string& filename) {
+  MetricEngine metric_engine;
+  std::string error;
+  auto resolver = [this](const std::string& name) { return pmu_config_.get_event_index(name); };
+  if (!metric_engine.load_file(filename, resolver, error)) {
+    std::cerr << "Error: Failed to load metrics, " << error << std::endl;
+    return false;
+  }
+  metric_engine_ = std::move(metric_engine);
+  return true;
+}
 
 void Reporter::process_a_record(const Record& record) {
-  if (record.timestamp > prev_timestamp_) {
-    enabled_time_in_ns_[record.group_id] += (record.timestamp - prev_timestamp_);
-    total_time_in_ns_ += (record.timestamp - prev_timestamp_);
-    prev_timestamp_ = record.timestamp;
+  if (record.group_id == PHASE_BOUNDARY_GROUP_ID) {
+    // The markers of several CPUs at the same boundary count once
+    if (phase_boundaries_.empty() || phase_boundaries_.back() != record.timestamp) {
+      phase_boundaries_.push_back(record.timestamp);
+    }
+    return;
+  }
+
+  if (record.timestamp > overall_.prev_timestamp) {
+    interval_start_timestamp_ = overall_.prev_timestamp;
+  }
+  account_record_(overall_, record);
+
+  if (thread_names_) {
+    StatTable& thread_stats = thread_stats_[record.cpu_id];
+    if (thread_stats.stat.empty()) {
+      // A thread created during the measurement is accounted from the interval it was first read in
+      init_stats_(thread_stats);
+      thread_stats.prev_timestamp = interval_start_timestamp_;
+    }
+    account_record_(thread_stats, record);
+  } else if (record.cpu_id >= 0) {
+    if (static_cast<size_t>(record.cpu_id) >= cpu_stats_.size()) {
+      cpu_stats_.resize(record.cpu_id + 1);
+    }
+    StatTable& cpu_stats = cpu_stats_[record.cpu_id];
+    if (cpu_stats.stat.empty()) {
+      init_stats_(cpu_stats);
+    }
+    account_record_(cpu_stats, record);
   }
 
-  stat_[record.group_id][record.event_id].total_value += record.value;
+  if (interval_metric_writer_) {
+    interval_metric_writer_->process_a_record(record);
+  }
 }
 
-void Reporter::print_a_record(const Record& record, std::ostream& out) {
-  out << record.timestamp << ","
-      << record.cpu_id << ","
-      << record.group_id + 1 << ","
-      << pmu_config_.get_pmu_event(record.group_id, record.event_id).name << ","
-      << record.value << "\n";
+void Reporter::account_record_(StatTable& table, const Record& record) {
+  if (record.timestamp > table.prev_timestamp) {
+    table.enabled_time_in_ns[record.group_id] += (record.timestamp - table.prev_timestamp);
+    table.total_time_in_ns += (record.timestamp - table.prev_timestamp);
+    table.prev_timestamp = record.timestamp;
+  }
+
+  auto& event_stat = table.stat[record.group_id][record.event_id];
+  event_stat.total_value += record.value;
+
+  // A group that was enabled but never ran in this interval carries no information, its time is left uncovered
+  if (record.time_running > 0) {
+    event_stat.scaled_value += (double)record.value * record.time_enabled / record.time_running;
+    event_stat.rate.push((double)record.value / record.time_running);
+    if (record.event_id == 0) {  // The records of a group read share the times, count them once
+      table.kernel_time_in_ns[record.group_id] += record.time_enabled;
+    }
+  }
 }
 
 void Reporter::estimation() {
+  for (auto& cpu_stats : cpu_stats_) {
+    if (!cpu_stats.stat.empty()) {
+      estimate_(cpu_stats);
+    }
+  }
+  for (auto& thread_stats : thread_stats_) {
+    estimate_(thread_stats.second);
+  }
+
+  if (!thread_stats_.empty()) {
+    // The threads rotate their groups independently (an idle thread keeps its group), so the process is always the sum of the threads
+    std::vector<int> tids;
+    std::vector<const StatTable*> tables;
+    for (const auto& thread_stats : thread_stats_) {
+      tids.push_back(thread_stats.first);
+      tables.push_back(&thread_stats.second);
+    }
+    sum_stat_tables_(tids, tables, overall_);
+  } else if ((estimator_ != EstimatorType::WALL_CLOCK || has_core_types_()) && !cpu_stats_.empty()) {
+    // The kernel times and the reference counts are per CPU, and so are the groups with several core types,
+    // so the overall counts are the sum of the per-CPU estimates
+    std::vector<int> cpu_ids;
+    for (size_t cpu_id = 0; cpu_id < cpu_stats_.size(); ++cpu_id) {
+      if (!cpu_stats_[cpu_id].stat.empty()) cpu_ids.push_back(static_cast<int>(cpu_id));
+    }
+    sum_stat_tables_(cpu_ids, get_cpu_stat_tables_(cpu_ids), overall_);
+  } else {
+    estimate_(overall_);
+  }
+}
+
+bool Reporter::counts_group_(int cpu_id, size_t group_id) const {
+  if (!has_core_types_()) return true;
+  const auto& core_type = core_type_layouts_->get_core_type(cpu_id);
+  return group_id >= core_type.group_id_base && group_id < core_type.group_id_base + core_type.pmu_config.get_event_group_num();
+}
+
+std::vector<const Reporter::StatTable*> Reporter::get_cpu_stat_tables_(const std::vector<int>& cpu_ids) const {
+  std::vector<const StatTable*> tables;
+  for (const int cpu_id : cpu_ids) tables.push_back(&cpu_stats_[cpu_id]);
+  return tables;
+}
+
+void Reporter::sum_stat_tables_(const std::vector<int>& unit_ids, const std::vector<const StatTable*>& tables, StatTable& sum) {
+  // The estimates are summed, the confidence intervals of independent CPUs are combined in quadrature,
+  // and the coverage is the mean over the tables. A group is summed over the CPUs that count it,
+  // except the totals of the fixed events, which every CPU keeps in the first group.
+  for (size_t i = 0; i < sum.stat.size(); ++i) {
+    for (size_t j = 0; j < sum.stat[i].size(); ++j) {
+      auto& event_stat = sum.stat[i][j];
+      event_stat.estimated_value = 0;
+      event_stat.rate = RunningStats();
+      event_stat.coverage = 0.0;
+      double ci_square_sum = 0.0;
+      bool ci_known = true;
+      size_t table_num = 0;
+      for (size_t t = 0; t < tables.size(); ++t) {
+        if (!counts_group_(unit_ids[t], i) && !(i == 0 && j < static_cast<size_t>(fixed_event_num_))) continue;
+        const auto& other = tables[t]->stat[i][j];
+        event_stat.estimated_value += other.estimated_value;
+        event_stat.rate.merge(other.rate);
+        event_stat.coverage += other.coverage;
+        ci_square_sum += other.ci_half_width * other.ci_half_width;
+        ci_known = ci_known && other.ci_half_width >= 0.0;
+        ++table_num;
+      }
+      if (table_num > 0) event_stat.coverage /= table_num;
+      event_stat.ci_half_width = ci_known ? std::sqrt(ci_square_sum) : -1.0;
+    }
+  }
+
+  for (size_t idx = 0; idx < sum.event_values.size(); ++idx) {
+    double value = 0.0;
+    double coverage = 0.0;
+    double ci_square_sum = 0.0;
+    bool ci_known = true;
+    for (const auto table : tables) {
+      value += table->event_values[idx];
+      coverage += table->event_coverages[idx] / tables.size();
+      ci_square_sum += table->event_ci_half_widths[idx] * table->event_ci_half_widths[idx];
+      ci_known = ci_known && table->event_ci_half_widths[idx] >= 0.0;
+    }
+    sum.event_values[idx] = value;
+    sum.event_coverages[idx] = coverage;
+    sum.event_ci_half_widths[idx] = ci_known ? std::sqrt(ci_square_sum) : -1.0;
+  }
+}
+
+void Reporter::estimate_(StatTable& table) {
   const auto event_group_num = pmu_config_.get_event_group_num();
+  auto& stat = table.stat;
+  auto& event_values = table.event_values;
+  event_values.assign(pmu_config_.get_all_events().size(), 0.0);
+
+  // The weight of each group is the share of the measurement it represents:
+  // - wall-clock: the residency of the group derived from the timestamps
+  // - kernel time: the sum of time_enabled, and all counts are first corrected by time_enabled / time_running in each interval
+  // - reference event: the count of the fixed reference event while the group was scheduled
+  const bool kernel_time = (estimator_ == EstimatorType::KERNEL_TIME);
+  std::vector<uint64_t> group_weight(event_group_num, 0);
+  uint64_t total_weight = 0;
+  for (size_t i = 0; i < event_group_num; i++) {
+    switch (estimator_) {
+      case EstimatorType::WALL_CLOCK:
+        group_weight[i] = table.enabled_time_in_ns[i];
+        break;
+      case EstimatorType::KERNEL_TIME:
+        group_weight[i] = table.kernel_time_in_ns[i];
+        break;
+      case EstimatorType::REFERENCE_EVENT:
+        group_weight[i] = stat[i][reference_event_id_].total_value;
+        break;
+    }
+    total_weight += group_weight[i];
+  }
+  if (estimator_ == EstimatorType::WALL_CLOCK) {
+    total_weight = table.total_time_in_ns;
+  }
+  auto value_of = [kernel_time](const EventStats& event_stat) {
+    return kernel_time ? event_stat.scaled_value : (double)event_stat.total_value;
+  };
 
   for (int j = 0; j < fixed_event_num_; j++) {
-    uint64_t fixed_event_total = 0;
+    double fixed_event_total = 0;
     for (int i = 0; i < event_group_num; i++) {
-      fixed_event_total += stat_[i][j].total_value;
+      fixed_event_total += value_of(stat[i][j]);
     }
-    stat_[0][j].estimated_value = fixed_event_total;
+    stat[0][j].estimated_value = (uint64_t)fixed_event_total;
+    stat[0][j].coverage = 1.0;
+    stat[0][j].ci_half_width = 0.0;
+    event_values[j] = fixed_event_total;
+    table.event_coverages[j] = 1.0;
+    table.event_ci_half_widths[j] = 0.0;
   }
 
+  // The relative half-width of the 95% confidence interval of an extrapolated count: the standard error of the mean rate
+  // over the intervals, with the finite population correction, since a fraction `coverage` of the run is actually observed
+  auto relative_ci_half_width = [](const RunningStats& rate, double coverage) {
+    if (coverage >= 1.0) return 0.0;
+    if (rate.n < 2) return -1.0;  // unknown
+    if (rate.mean <= 0.0) return 0.0;
+    return 1.96 * std::sqrt(rate.variance() / rate.n) / rate.mean * std::sqrt(1.0 - coverage);
+  };
+  std::vector<RunningStats> rate_sum(event_values.size());
+
+  // An event scheduled in multiple groups is estimated from all of them
+  std::vector<double> raw_sum(event_values.size(), 0.0);
+  std::vector<uint64_t> weight_sum(event_values.size(), 0);
+
   for (int i = 0; i < event_group_num; i++) {
     for (int j = 0; j < pmu_config_.get_event_group_by_idx(i).size(); j++) {
-      double ratio = (double)total_time_in_ns_ / enabled_time_in_ns_[i];
-      stat_[i][fixed_event_num_ + j].estimated_value = (uint64_t)(stat_[i][fixed_event_num_ + j].total_value * ratio);
+      auto& event_stat = stat[i][fixed_event_num_ + j];
+      double ratio = (group_weight[i] > 0) ? (double)total_weight / group_weight[i] : 0.0;
+      event_stat.estimated_value = (uint64_t)(value_of(event_stat) * ratio);
+      event_stat.coverage = (total_weight > 0) ? std::min(1.0, (double)group_weight[i] / total_weight) : 0.0;
+      double relative_ci = relative_ci_half_width(event_stat.rate, event_stat.coverage);
+      event_stat.ci_half_width = (relative_ci >= 0.0) ? relative_ci * event_stat.estimated_value : -1.0;
+
+      size_t idx = event_slots_[i][fixed_event_num_ + j];
+      raw_sum[idx] += value_of(event_stat);
+      weight_sum[idx] += group_weight[i];
+      rate_sum[idx].merge(event_stat.rate);
     }
   }
+
+  for (size_t idx = fixed_event_num_; idx < event_values.size(); ++idx) {
+    event_values[idx] = (weight_sum[idx] > 0) ? raw_sum[idx] * total_weight / weight_sum[idx] : 0.0;
+    table.event_coverages[idx] = (total_weight > 0) ? std::min(1.0, (double)weight_sum[idx] / total_weight) : 0.0;
+    double relative_ci = relative_ci_half_width(rate_sum[idx], table.event_coverages[idx]);
+    table.event_ci_half_widths[idx] = (relative_ci >= 0.0) ? relative_ci * event_values[idx] : -1.0;
+  }
+}
+
+uint64_t Reporter::get_kernel_covered_time_(const StatTable& table) const {
+  uint64_t covered_time_in_ns = 0;
+  for (const auto t : table.kernel_time_in_ns) {
+    covered_time_in_ns += t;
+  }
+  return covered_time_in_ns;
+}
+
+void Reporter::print_uncovered_time_() {
+  auto print_line = [this](const std::string& name, uint64_t wall_time_in_ns, uint64_t covered_time_in_ns) {
+    uint64_t uncovered_time_in_ns = (wall_time_in_ns > covered_time_in_ns) ? wall_time_in_ns - covered_time_in_ns : 0;
+    double percentage = (wall_time_in_ns > 0) ? (double)uncovered_time_in_ns * 100.0 / wall_time_in_ns : 0.0;
+    std::cout << "  " << std::left << std::setw(10) << name << std::right
+              << std::setw(12) << covered_time_in_ns / 1e6 << " ms of " << std::setw(12) << wall_time_in_ns / 1e6
+              << " ms, not covered: " << std::setw(10) << uncovered_time_in_ns / 1e6 << " ms (" << percentage << " %)\n";
+  };
+
+  std::cout << "Kernel-reported group time (time_enabled) vs. wall-clock time:\n";
+  if (cpu_stats_.empty()) {
+    print_line("Process", overall_.prev_timestamp, get_kernel_covered_time_(overall_));
+    std::cout << "  (for a process, the time it is not running is not covered either)\n";
+    return;
+  }
+
+  uint64_t wall_sum = 0;
+  uint64_t covered_sum = 0;
+  for (size_t cpu_id = 0; cpu_id < cpu_stats_.size(); ++cpu_id) {
+    if (cpu_stats_[cpu_id].stat.empty()) continue;
+    uint64_t covered = get_kernel_covered_time_(cpu_stats_[cpu_id]);
+    print_line("CPU " + std::to_string(cpu_id), cpu_stats_[cpu_id].prev_timestamp, covered);
+    wall_sum += cpu_stats_[cpu_id].prev_timestamp;
+    covered_sum += covered;
+  }
+  print_line("All CPUs", wall_sum, covered_sum);
 }
 
 std::string Reporter::format_with_commas_(uint64_t value) {
@@ -89,94 +386,279 @@ void Reporter::print_stats() {
   std::cout << "========== Performance Statistics ==========\n";
   std::cout << std::fixed << std::setprecision(2);
 
+  if (unmeasured_thread_num_ > 0) {
+    std::cout << "Partial process totals: " << unmeasured_thread_num_
+              << " threads not measured for the limit of open files are not counted in the statistics and metrics\n";
+  }
+
+  if (estimator_ == EstimatorType::KERNEL_TIME) {
+    print_uncovered_time_();
+  }
+
+  // In kernel-time mode the group times are the sums of time_enabled, over all CPUs for system-wide
+  const bool kernel_time = (estimator_ == EstimatorType::KERNEL_TIME);
+  const auto& group_time_in_ns = kernel_time ? overall_.kernel_time_in_ns : overall_.enabled_time_in_ns;
+  const uint64_t total_time_in_ns = kernel_time ? get_kernel_covered_time_(overall_) : overall_.total_time_in_ns;
+
   // fixed events
-  std::cout << "Fixed events (" << total_time_in_ns_ / 1e6 << " ms, 100.00 %)\n";
+  std::cout << "Fixed events (" << total_time_in_ns / 1e6 << " ms, 100.00 %)\n";
   for (size_t event_id = 0; event_id < fixed_event_num_; ++event_id) {
-    const auto& event_stat = stat_[0][event_id];
+    const auto& event_stat = overall_.stat[0][event_id];
     const auto& pmu_event = pmu_config_.get_fixed_events()[event_id];
-    print_event_count_(event_stat.estimated_value, pmu_event.name);
+    uint64_t interval_num = 0;
+    for (const auto& group_stat : overall_.stat) interval_num += group_stat[event_id].rate.n;
+    print_event_count_(event_stat.estimated_value, pmu_event.name, event_stat.ci_half_width, event_stat.coverage, interval_num);
   }
 
   // other events
-  for (size_t group_id = 0; group_id < pmu_config_.get_event_group_num(); ++group_id) {
-    double percentage = (double)enabled_time_in_ns_[group_id] * 100.0 / total_time_in_ns_;
-    std::cout << "Group " << (group_id + 1) << " (" << enabled_time_in_ns_[group_id] / 1e6 << " ms, "
-              << percentage << " %)\n";
+  // With several core types, the groups are listed by core type, and the time of a group is relative to the CPUs of its core type:
+  // the mean over them of the wall-clock residency, or the sum of time_enabled in kernel-time mode
+  const size_t event_group_num = pmu_config_.get_event_group_num();
+  std::vector<uint64_t> core_type_group_time_in_ns(group_time_in_ns.begin(), group_time_in_ns.end());
+  std::vector<uint64_t> core_type_total_time_in_ns(event_group_num, total_time_in_ns);
+  std::vector<size_t> group_core_type(event_group_num, 0);
+  if (has_core_types_()) {
+    const auto& core_types = core_type_layouts_->get_core_types();
+    for (size_t k = 0; k < core_types.size(); ++k) {
+      const size_t first = core_types[k].group_id_base;
+      const size_t last = first + core_types[k].pmu_config.get_event_group_num();
+      uint64_t total_sum = 0;
+      size_t cpu_num = 0;
+      std::fill(core_type_group_time_in_ns.begin() + first, core_type_group_time_in_ns.begin() + last, 0);
+      for (const int cpu_id : core_types[k].cpu_ids) {
+        if (cpu_id < 0 || static_cast<size_t>(cpu_id) >= cpu_stats_.size() || cpu_stats_[cpu_id].stat.empty()) continue;
+        const auto& table = cpu_stats_[cpu_id];
+        for (size_t group_id = first; group_id < last; ++group_id) {
+          core_type_group_time_in_ns[group_id] += kernel_time ? table.kernel_time_in_ns[group_id] : table.enabled_time_in_ns[group_id];
+        }
+        total_sum += kernel_time ? get_kernel_covered_time_(table) : table.total_time_in_ns;
+        ++cpu_num;
+      }
+      for (size_t group_id = first; group_id < last; ++group_id) {
+        if (!kernel_time && cpu_num > 0) core_type_group_time_in_ns[group_id] /= cpu_num;
+        core_type_total_time_in_ns[group_id] = (!kernel_time && cpu_num > 0) ? total_sum / cpu_num : total_sum;
+        group_core_type[group_id] = k;
+      }
+    }
+  }
+
+  for (size_t group_id = 0; group_id < event_group_num; ++group_id) {
+    if (has_core_types_() && (group_id == 0 || group_core_type[group_id] != group_core_type[group_id - 1])) {
+      const auto& core_type = core_type_layouts_->get_core_types()[group_core_type[group_id]];
+      std::cout << "Core type " << group_core_type[group_id] + 1 << " (" << core_type.counter_num << " programmable counters, CPU ";
+      for (size_t i = 0; i < core_type.cpu_ids.size(); ++i) {
+        std::cout << core_type.cpu_ids[i] << (i + 1 < core_type.cpu_ids.size() ? ", " : ")\n");
+      }
+    }
+
+    double percentage = (core_type_total_time_in_ns[group_id] > 0) ? (double)core_type_group_time_in_ns[group_id] * 100.0 / core_type_total_time_in_ns[group_id] : 0.0;
+    std::cout << "Group " << (group_id + 1) << " (" << core_type_group_time_in_ns[group_id] / 1e6 << " ms, "
+              << percentage << " %";
+    if (estimator_ == EstimatorType::REFERENCE_EVENT) {
+      uint64_t reference_total = 0;
+      for (size_t i = 0; i < event_group_num; ++i) {
+        if (group_core_type[i] == group_core_type[group_id]) reference_total += overall_.stat[i][reference_event_id_].total_value;
+      }
+      double reference_percentage = (reference_total > 0) ? (double)overall_.stat[group_id][reference_event_id_].total_value * 100.0 / reference_total : 0.0;
+      std::cout << ", " << reference_percentage << " % of " << pmu_config_.get_fixed_events()[reference_event_id_].name;
+    }
+    std::cout << ")\n";
 
     const auto& current_group = pmu_config_.get_event_group_by_idx(group_id);
 
-    for (size_t event_id = fixed_event_num_; event_id < stat_[group_id].size(); ++event_id) {
-      const auto& event_stat = stat_[group_id][event_id];
+    for (size_t event_id = fixed_event_num_; event_id < overall_.stat[group_id].size(); ++event_id) {
+      const auto& event_stat = overall_.stat[group_id][event_id];
       const auto& pmu_event = current_group[event_id - fixed_event_num_];
-      print_event_count_(event_stat.estimated_value, pmu_event.name);
+      print_event_count_(event_stat.estimated_value, pmu_event.name, event_stat.ci_half_width, event_stat.coverage, event_stat.rate.n);
     }
   }
+
+  if (!phase_boundaries_.empty()) {
+    std::cout << "Phase changes: " << phase_boundaries_.size() << " (at";
+    for (size_t i = 0; i < phase_boundaries_.size() && i < MAX_PRINTED_PHASE_BOUNDARIES; ++i) {
+      std::cout << " " << phase_boundaries_[i] / 1e9 << " s";
+    }
+    if (phase_boundaries_.size() > MAX_PRINTED_PHASE_BOUNDARIES) std::cout << " ...";
+    std::cout << ")\n";
+  }
 }
 
 void Reporter::print_metrics() {
   std::cout << "=========== Performance Metrics ============\n";
-
-#if defined(CPU_ORYON)
-  print_metrics_oryon_();
-#elif defined(CPU_CORTEX_X4)
-  print_metrics_cortex_x4_();
-#endif
-
+  print_metric_list_(overall_, overall_.total_time_in_ns);
   std::cout << "============================================\n";
 }
 
-EventStats Reporter::get_event_stat_by_name(std::string name, size_t group_id) {
-  if (group_id >= pmu_config_.get_event_group_num()) {
-    return EventStats();
+void Reporter::print_rollup(TopologyLevel level) {
+  // Group the measured CPUs by (package, cluster, core, cpu), with the components finer than `level` left as -1
+  std::map<std::tuple<int, int, int, int>, std::vector<int>> units;
+  for (size_t idx = 0; idx < cpu_stats_.size(); ++idx) {
+    if (cpu_stats_[idx].stat.empty()) continue;
+
+    const int cpu_id = static_cast<int>(idx);
+    CpuTopology topology = read_cpu_topology(cpu_id);
+    std::tuple<int, int, int, int> key;
+    switch (level) {
+      case TopologyLevel::CPU:
+        key = std::make_tuple(-1, -1, -1, cpu_id);
+        break;
+      case TopologyLevel::CORE:
+        key = std::make_tuple(topology.package_id, topology.cluster_id, topology.core_id, -1);
+        break;
+      case TopologyLevel::CLUSTER:
+        key = std::make_tuple(topology.package_id, topology.cluster_id, -1, -1);
+        break;
+      case TopologyLevel::PACKAGE:
+        key = std::make_tuple(topology.package_id, -1, -1, -1);
+        break;
+    }
+    units[key].push_back(cpu_id);
   }
 
-  const auto& fixed_events = pmu_config_.get_fixed_events();
-  const auto& schedulable_events = pmu_config_.get_event_group_by_idx(group_id);
-  
-  for (size_t event_id = 0; event_id < fixed_events.size(); ++event_id) {
-    if (fixed_events[event_id].name == name) {
-      return stat_[group_id][event_id];
+  for (const auto& unit : units) {
+    int package_id, cluster_id, core_id, cpu_id;
+    std::tie(package_id, cluster_id, core_id, cpu_id) = unit.first;
+    const auto& cpu_ids = unit.second;
+
+    // The events are summed over the CPUs, and so is the duration (the CPU time), so that the rate metrics (e.g., a frequency)
+    // are per CPU like those of a single CPU
+    StatTable unit_stats;
+    init_stats_(unit_stats);
+    uint64_t duration_sum = 0;
+    for (int id : cpu_ids) {
+      duration_sum += cpu_stats_[id].total_time_in_ns;
     }
-  }
-  for (size_t event_id = 0; event_id < schedulable_events.size(); ++event_id) {
-    if (schedulable_events[event_id].name == name) {
-      return stat_[group_id][fixed_event_num_ + event_id];
+    sum_stat_tables_(cpu_ids, get_cpu_stat_tables_(cpu_ids), unit_stats);
+
+    std::cout << "=============== ";
+    if (level == TopologyLevel::CPU) {
+      std::cout << "CPU " << cpu_id;
+    } else {
+      std::cout << "Package " << package_id;
+      if (level == TopologyLevel::CLUSTER || level == TopologyLevel::CORE) std::cout << ", cluster " << cluster_id;
+      if (level == TopologyLevel::CORE) std::cout << ", core " << core_id;
+      std::cout << " (CPU ";
+      for (size_t i = 0; i < cpu_ids.size(); ++i) {
+        std::cout << cpu_ids[i] << (i + 1 < cpu_ids.size() ? ", " : ")");
+      }
     }
+    std::cout << " ===============\n";
+    print_stat_table_(unit_stats, duration_sum);
+  }
+  if (!units.empty()) {
+    std::cout << "============================================\n";
   }
+}
+
+void Reporter::print_threads() {
+  if (!thread_names_ || thread_stats_.empty()) return;
 
-  // if not found, return default EventStats
-  return EventStats();
+  // The busiest threads first, by the first fixed event (e.g., cpu_cycles)
+  std::vector<int> tids;
+  for (const auto& thread_stats : thread_stats_) tids.push_back(thread_stats.first);
+  if (fixed_event_num_ > 0) {
+    std::stable_sort(tids.begin(), tids.end(), [this](int a, int b) {
+      return thread_stats_.at(a).event_values[0] > thread_stats_.at(b).event_values[0];
+    });
+  }
+
+  for (size_t i = 0; i < tids.size() && i < MAX_PRINTED_THREADS; ++i) {
+    const auto& table = thread_stats_.at(tids[i]);
+    auto name = thread_names_->find(tids[i]);
+    std::cout << "=============== Thread " << tids[i] << " (" << (name != thread_names_->end() ? name->second : "?")
+              << ") ===============\n";
+    print_stat_table_(table, table.total_time_in_ns);
+  }
+  if (tids.size() > MAX_PRINTED_THREADS) {
+    std::cout << "... " << tids.size() - MAX_PRINTED_THREADS << " more threads, see the raw data (the cpu column is the TID)\n";
+  }
+  std::cout << "============================================\n";
 }
 
-EventStats Reporter::get_schedulable_event_stat_by_name(std::string name, size_t& group_id) {
-  for (size_t group_id = 0; group_id < pmu_config_.get_event_group_num(); ++group_id) {
-    const auto& schedulable_events = pmu_config_.get_event_group_by_idx(group_id);
-    for (size_t event_id = 0; event_id < schedulable_events.size(); ++event_id) {
-      if (schedulable_events[event_id].name == name) {
-        return stat_[group_id][fixed_event_num_ + event_id];
-      }
+void Reporter::print_metric_comparison(const std::vector<std::string>& labels, const std::vector<const Reporter*>& reporters) {
+  if (reporters.empty()) return;
+  double variables[MetricEngine::VARIABLE_NUM];
+  variables[MetricEngine::CNT_FREQ] = read_cntfrq_el0();
+
+  std::cout << "=========== Metrics Comparison =============\n";
+  std::cout << "  " << std::left << std::setw(30) << "" << std::right;
+  for (auto label : labels) {
+    // A long cgroup path is shortened to its last component
+    if (label.size() > 16) label = label.substr(label.find_last_of('/') + 1).substr(0, 16);
+    std::cout << "  " << std::setw(16) << label;
+  }
+  std::cout << "\n";
+
+  const auto& metrics = reporters[0]->metric_engine_.get_metrics();
+  for (size_t m = 0; m < metrics.size(); ++m) {
+    const double scale = (metrics[m].unit == MetricUnit::PERCENT) ? 100.0 : 1.0;
+    std::cout << "  " << std::left << std::setw(30) << metrics[m].name << std::right;
+    for (const auto reporter : reporters) {
+      variables[MetricEngine::DURATION_NS] = reporter->overall_.total_time_in_ns;
+      double value = MetricEngine::evaluate(reporter->metric_engine_.get_metrics()[m], reporter->overall_.event_values, variables);
+      std::cout << "  " << std::setw(16) << std::fixed << std::setprecision(metrics[m].unit == MetricUnit::PERCENT ? 2 : 4) << value * scale;
     }
+    std::cout << (metrics[m].unit == MetricUnit::PERCENT ? "  %" : "") << "\n";
   }
-
-  // if not found, return default EventStats
-  return EventStats();
+  std::cout << "============================================\n";
 }
 
-EventStats Reporter::get_fixed_event_stat_by_name(std::string name, size_t group_id) {
-  if (group_id >= pmu_config_.get_event_group_num()) {
-    return EventStats();
+void Reporter::print_stat_table_(const StatTable& table, uint64_t duration_in_ns) {
+  const auto all_events = pmu_config_.get_all_events();
+  std::cout << std::fixed << std::setprecision(2) << "Events (" << duration_in_ns / 1e6 << " ms)\n";
+  for (size_t idx = 0; idx < all_events.size(); ++idx) {
+    uint64_t interval_num = 0;
+    for (size_t i = 0; i < table.stat.size(); ++i) {
+      for (size_t j = 0; j < table.stat[i].size(); ++j) {
+        if (event_slots_[i][j] == idx) interval_num += table.stat[i][j].rate.n;
+      }
+    }
+    print_event_count_((uint64_t)table.event_values[idx], all_events[idx].name,
+                       table.event_ci_half_widths[idx], table.event_coverages[idx], interval_num);
   }
+  std::cout << "Metrics:\n";
+  print_metric_list_(table, duration_in_ns);
+}
 
-  const auto& fixed_events = pmu_config_.get_fixed_events();
+void Reporter::print_metric_list_(const StatTable& table, uint64_t duration_in_ns) {
+  double variables[MetricEngine::VARIABLE_NUM];
+  variables[MetricEngine::CNT_FREQ] = read_cntfrq_el0();
+  variables[MetricEngine::DURATION_NS] = duration_in_ns;
 
-  for (size_t event_id = 0; event_id < fixed_events.size(); ++event_id) {
-    if (fixed_events[event_id].name == name) {
-      return stat_[group_id][event_id];
+  std::vector<double> shifted_values = table.event_values;
+
+  const std::string* section = nullptr;
+  const std::string* subsection = nullptr;
+  for (const auto& metric : metric_engine_.get_metrics()) {
+    if (!section || *section != metric.section) {
+      section = &metric.section;
+      subsection = nullptr;
+      if (!section->empty()) std::cout << *section << ":\n";
     }
-  }
+    if (!subsection || *subsection != metric.subsection) {
+      subsection = &metric.subsection;
+      if (!subsection->empty()) std::cout << " " << *subsection << ":\n";
+    }
+
+    double value = MetricEngine::evaluate(metric, table.event_values, variables);
 
-  // if not found, return default EventStats
-  return EventStats();
+    // First-order propagation of the confidence intervals of the operands, assumed independent:
+    // the effect of shifting each operand by its half-width, combined in quadrature
+    double ci_square_sum = 0.0;
+    bool ci_known = true;
+    for (size_t idx : metric.event_operands) {
+      if (table.event_ci_half_widths[idx] < 0.0) {
+        ci_known = false;
+        break;
+      }
+      shifted_values[idx] += table.event_ci_half_widths[idx];
+      double delta = MetricEngine::evaluate(metric, shifted_values, variables) - value;
+      shifted_values[idx] = table.event_values[idx];
+      ci_square_sum += delta * delta;
+    }
+
+    print_metric_(metric, value, ci_known ? std::sqrt(ci_square_sum) : -1.0);
+  }
 }
 
 /**
@@ -185,8 +667,11 @@ EventStats Reporter::get_fixed_event_stat_by_name(std::string name, size_t group
  *
  * CNTFRQ_EL0 is a 64-bit register that holds the frequency of the system
  * counter. We use inline assembly to read this register.
+ * On other architectures there is no such register and 0 is returned,
+ * so the metrics depending on `$cnt_freq` evaluate to 0.
  */
-static inline uint64_t read_cntfrq_el0(void) {
+uint64_t read_cntfrq_el0(void) {
+#if defined(__aarch64__)
   uint64_t freq;
 
   /*
@@ -202,159 +687,9 @@ static inline uint64_t read_cntfrq_el0(void) {
       : "memory");
 
   return freq;
-}
-
-void Reporter::print_metrics_oryon_() {
-  std::cout << "Pipeline basic metrics:\n";
-  uint64_t cpu_cycles = get_fixed_event_stat_by_name("cpu_cycles", 0).estimated_value;
-  uint64_t inst_retired = get_fixed_event_stat_by_name("inst_retired", 0).estimated_value;
-  uint64_t cnt_cycles = get_fixed_event_stat_by_name("cnt_cycles", 0).estimated_value;
-  uint64_t cnt_freq = read_cntfrq_el0();
-
-  print_decimal_(cpu_cycles, inst_retired, "CPI");
-  print_percentage_(cnt_cycles * 1e9, cnt_freq * total_time_in_ns_, "CPU utilization");
-  print_GHz_(cpu_cycles * cnt_freq, cnt_cycles * 1e9, "Average frequency");
-
-  std::cout << "Breakdown based on instruction mix:\n";
-  uint64_t group_id = 0;
-  uint64_t inst_spec = get_schedulable_event_stat_by_name("inst_spec", group_id).total_value;
-  uint64_t ld_spec = get_schedulable_event_stat_by_name("ld_spec", group_id).total_value;
-  uint64_t st_spec = get_schedulable_event_stat_by_name("st_spec", group_id).total_value;
-  uint64_t dp_spec = get_schedulable_event_stat_by_name("dp_spec", group_id).total_value;
-  uint64_t vfp_spec = get_schedulable_event_stat_by_name("vfp_spec", group_id).total_value;
-  uint64_t ase_spec = get_schedulable_event_stat_by_name("ase_spec", group_id).total_value;
-  uint64_t br_immed_spec = get_schedulable_event_stat_by_name("br_immed_spec", group_id).total_value;
-  uint64_t br_indirect_spec = get_schedulable_event_stat_by_name("br_indirect_spec", group_id).total_value;
-  uint64_t br_return_spec = get_schedulable_event_stat_by_name("br_return_spec", group_id).total_value;
-
-  print_percentage_(ld_spec, inst_spec, "Load");
-  print_percentage_(st_spec, inst_spec, "Store");
-  print_percentage_(dp_spec, inst_spec, "Integer data processing");
-  print_percentage_(vfp_spec, inst_spec, "Floating point");
-  print_percentage_(ase_spec, inst_spec, "Advanced SIMD");
-  print_percentage_(br_immed_spec, inst_spec, "Immediate branch");
-  print_percentage_(br_indirect_spec, inst_spec, "Indirect branch");
-  print_percentage_(br_return_spec, inst_spec, "Return branch");
-
-  std::cout << "Breakdown based on misses:\n";
-  uint64_t l1d_cache_refill = get_schedulable_event_stat_by_name("l1d_cache_refill", group_id).total_value;
-  uint64_t l1i_cache_refill = get_schedulable_event_stat_by_name("l1i_cache_refill", group_id).total_value;
-  uint64_t l2d_cache_refill = get_schedulable_event_stat_by_name("l2d_cache_refill", group_id).total_value;
-  uint64_t l1d_tlb_refill = get_schedulable_event_stat_by_name("l1d_tlb_refill", group_id).total_value;
-  uint64_t l1i_tlb_refill = get_schedulable_event_stat_by_name("l1i_tlb_refill", group_id).total_value;
-  uint64_t dtlb_walk = get_schedulable_event_stat_by_name("dtlb_walk", group_id).total_value;
-  uint64_t itlb_walk = get_schedulable_event_stat_by_name("itlb_walk", group_id).total_value;
-
-  uint64_t denominator = get_fixed_event_stat_by_name("inst_retired", group_id).total_value;
-
-  std::cout << " Cache:\n";
-  print_decimal_(l1d_cache_refill * 1000, denominator, "L1D cache MPKI");
-  print_decimal_(l1i_cache_refill * 1000, denominator, "L1I cache MPKI");
-  print_decimal_(l2d_cache_refill * 1000, denominator, "L2 cache MPKI");
-
-  std::cout << " TLB:\n";
-  print_decimal_(l1d_tlb_refill * 1000, denominator, "L1D TLB MPKI");
-  print_decimal_(l1i_tlb_refill * 1000, denominator, "L1I TLB MPKI");
-  print_decimal_(dtlb_walk * 1000, denominator, "DTLB walk PKI");
-  print_decimal_(itlb_walk * 1000, denominator, "ITLB walk PKI");
-
-  uint64_t br_mis_pred_retired = get_schedulable_event_stat_by_name("br_mis_pred_retired", group_id).total_value;
-  denominator = get_fixed_event_stat_by_name("inst_retired", group_id).total_value;
-
-  std::cout << " Branch predictor:\n";
-  print_decimal_(br_mis_pred_retired * 1000, denominator, "Branch MPKI");
-
-  std::cout << "Memory access latency:\n";
-  uint64_t bus_access_rd = get_schedulable_event_stat_by_name("bus_access_rd", group_id).total_value;
-  uint64_t bus_access_wr = get_schedulable_event_stat_by_name("bus_access_wr", group_id).total_value;
-  uint64_t mem_access_rd = get_schedulable_event_stat_by_name("mem_access_rd", group_id).total_value;
-  uint64_t bus_access_rd_cycles = get_schedulable_event_stat_by_name("bus_access_rd_cycles", group_id).total_value;
-  uint64_t bus_access_wr_cycles = get_schedulable_event_stat_by_name("bus_access_wr_cycles", group_id).total_value;
-  uint64_t mem_access_rd_cycles = get_schedulable_event_stat_by_name("mem_access_rd_cycles", group_id).total_value;
-
-  uint64_t dtlb_walk_cycles = get_schedulable_event_stat_by_name("dtlb_walk_cycles", group_id).total_value;
-  uint64_t itlb_walk_cycles = get_schedulable_event_stat_by_name("itlb_walk_cycles", group_id).total_value;
-
-  print_cycles_(bus_access_rd_cycles, bus_access_rd, "Bus read latency");
-  print_cycles_(bus_access_wr_cycles, bus_access_wr, "Bus write latency");
-  print_cycles_(mem_access_rd_cycles, mem_access_rd, "Memory read latency");
-  print_cycles_(dtlb_walk_cycles, dtlb_walk, "DTLB walk latency");
-  print_cycles_(itlb_walk_cycles, itlb_walk, "ITLB walk latency");
-}
-
-void Reporter::print_metrics_cortex_x4_() {
-  std::cout << "Pipeline basic metrics:\n";
-  uint64_t cpu_cycles = get_fixed_event_stat_by_name("cpu_cycles", 0).estimated_value;
-  uint64_t inst_retired = get_fixed_event_stat_by_name("inst_retired", 0).estimated_value;
-  uint64_t cnt_cycles = get_fixed_event_stat_by_name("cnt_cycles", 0).estimated_value;
-  uint64_t cnt_freq = read_cntfrq_el0();
-
-  print_decimal_(cpu_cycles, inst_retired, "CPI");
-  print_percentage_(cnt_cycles * 1e9, cnt_freq * total_time_in_ns_, "CPU utilization");
-  print_GHz_(cpu_cycles * cnt_freq, cnt_cycles * 1e9, "Average frequency");
-
-  std::cout << "Breakdown based on instruction mix:\n";
-  uint64_t group_id = 0;
-  uint64_t inst_spec = get_schedulable_event_stat_by_name("inst_spec", group_id).total_value;
-  uint64_t ld_spec = get_schedulable_event_stat_by_name("ld_spec", group_id).total_value;
-  uint64_t st_spec = get_schedulable_event_stat_by_name("st_spec", group_id).total_value;
-  uint64_t dp_spec = get_schedulable_event_stat_by_name("dp_spec", group_id).total_value;
-  uint64_t vfp_spec = get_schedulable_event_stat_by_name("vfp_spec", group_id).total_value;
-  uint64_t ase_spec = get_schedulable_event_stat_by_name("ase_spec", group_id).total_value;
-  uint64_t br_immed_spec = get_schedulable_event_stat_by_name("br_immed_spec", group_id).total_value;
-  uint64_t br_indirect_spec = get_schedulable_event_stat_by_name("br_indirect_spec", group_id).total_value;
-  uint64_t br_return_spec = get_schedulable_event_stat_by_name("br_return_spec", group_id).total_value;
-
-  print_percentage_(ld_spec, inst_spec, "Load");
-  print_percentage_(st_spec, inst_spec, "Store");
-  print_percentage_(dp_spec, inst_spec, "Integer data processing");
-  print_percentage_(vfp_spec, inst_spec, "Floating point");
-  print_percentage_(ase_spec, inst_spec, "Advanced SIMD");
-  print_percentage_(br_immed_spec, inst_spec, "Immediate branch");
-  print_percentage_(br_indirect_spec, inst_spec, "Indirect branch");
-  print_percentage_(br_return_spec, inst_spec, "Return branch");
-
-  std::cout << "Breakdown based on misses:\n";
-  uint64_t l1d_cache_refill = get_schedulable_event_stat_by_name("l1d_cache_refill", group_id).total_value;
-  uint64_t l1i_cache_refill = get_schedulable_event_stat_by_name("l1i_cache_refill", group_id).total_value;
-  uint64_t l2d_cache_refill = get_schedulable_event_stat_by_name("l2d_cache_refill", group_id).total_value;
-  uint64_t l3d_cache_refill = get_schedulable_event_stat_by_name("l3d_cache_refill", group_id).total_value;
-  uint64_t l1d_tlb_refill = get_schedulable_event_stat_by_name("l1d_tlb_refill", group_id).total_value;
-  uint64_t l1i_tlb_refill = get_schedulable_event_stat_by_name("l1i_tlb_refill", group_id).total_value;
-  uint64_t denominator = get_fixed_event_stat_by_name("inst_retired", group_id).total_value;
-
-  std::cout << " Cache:\n";
-  print_decimal_(l1d_cache_refill * 1000, denominator, "L1D cache MPKI");
-  print_decimal_(l1i_cache_refill * 1000, denominator, "L1I cache MPKI");
-  print_decimal_(l2d_cache_refill * 1000, denominator, "L2 cache MPKI");
-  print_decimal_(l3d_cache_refill * 1000, denominator, "L3 cache MPKI");
-
-  std::cout << " TLB:\n";
-  print_decimal_(l1d_tlb_refill * 1000, denominator, "L1D TLB MPKI");
-  print_decimal_(l1i_tlb_refill * 1000, denominator, "L1I TLB MPKI");
-
-  uint64_t dtlb_walk = get_schedulable_event_stat_by_name("dtlb_walk", group_id).total_value;
-  uint64_t itlb_walk = get_schedulable_event_stat_by_name("itlb_walk", group_id).total_value;
-  denominator = get_fixed_event_stat_by_name("inst_retired", group_id).total_value;
-
-  print_decimal_(dtlb_walk * 1000, denominator, "DTLB walk PKI");
-  print_decimal_(itlb_walk * 1000, denominator, "ITLB walk PKI");
-
-  std::cout << " Branch predictor:\n";
-  uint64_t br_mis_pred_retired = get_schedulable_event_stat_by_name("br_mis_pred_retired", group_id).total_value;
-  denominator = get_fixed_event_stat_by_name("inst_retired", group_id).total_value;
-
-  print_decimal_(br_mis_pred_retired * 1000, denominator, "Branch MPKI");
-
-  std::cout << "Memory access latency:\n";
-  uint64_t mem_access_rd = get_schedulable_event_stat_by_name("mem_access_rd", group_id).total_value;
-  uint64_t mem_access_rd_percyc = get_schedulable_event_stat_by_name("mem_access_rd_percyc", group_id).total_value;
-  uint64_t dtlb_walk_percyc = get_schedulable_event_stat_by_name("dtlb_walk_percyc", group_id).total_value;
-  uint64_t itlb_walk_percyc = get_schedulable_event_stat_by_name("itlb_walk_percyc", group_id).total_value;
-
-  print_cycles_(mem_access_rd_percyc, mem_access_rd, "Memory read latency");
-  print_cycles_(dtlb_walk_percyc, dtlb_walk, "DTLB walk latency");
-  print_cycles_(itlb_walk_percyc, itlb_walk, "ITLB walk latency");
+#else
+  return 0;
+#endif
 }
 
 void Reporter::print_event_count_(uint64_t c, std::string event_name) {
@@ -362,26 +697,44 @@ void Reporter::print_event_count_(uint64_t c, std::string event_name) {
             << std::right << std::setw(20) << format_with_commas_(c) << '\n';
 }
 
-void Reporter::print_percentage_(uint64_t a, uint64_t b, std::string metric_name) {
-  double pct = (b > 0) ? (double)a / b * 100 : 0.0;
-  std::cout << "  " << std::left << std::setw(27) << metric_name
-            << std::right << std::setw(13) << std::fixed << std::setprecision(2) << pct << " \%\n";
+void Reporter::print_event_count_(uint64_t c, std::string event_name, double ci_half_width, double coverage, uint64_t interval_num) {
+  std::cout << "  " << std::left << std::setw(22) << event_name
+            << std::right << std::setw(20) << format_with_commas_(c) << "  +- ";
+  if (ci_half_width < 0.0) {
+    std::cout << std::setw(7) << "n/a" << "  ";
+  } else {
+    double relative = (c > 0) ? ci_half_width * 100.0 / c : 0.0;
+    std::cout << std::setw(7) << std::fixed << std::setprecision(2) << relative << " %";
+  }
+  std::cout << "  (" << interval_num << " intervals, " << std::fixed << std::setprecision(2) << coverage * 100.0 << " % coverage)\n";
 }
 
-void Reporter::print_decimal_(uint64_t a, uint64_t b, std::string metric_name) {
-  double dcml = (b > 0) ? (double)a / b : 0.0;
-  std::cout << "  " << std::left << std::setw(30) << metric_name
-            << std::right << std::setw(12) << std::fixed << std::setprecision(4) << dcml << '\n';
-}
+void Reporter::print_metric_(const CompiledMetric& metric, double value, double ci_half_width) {
+  double scale = 1.0;
+  switch (metric.unit) {
+    case MetricUnit::PERCENT:
+      scale = 100.0;
+      std::cout << "  " << std::left << std::setw(27) << metric.name
+                << std::right << std::setw(13) << std::fixed << std::setprecision(2) << value * 100 << " \%";
+      break;
+    case MetricUnit::CYCLES:
+      std::cout << "  " << std::left << std::setw(23) << metric.name
+                << std::right << std::setw(12) << std::fixed << std::setprecision(4) << value << " cycles";
+      break;
+    case MetricUnit::GHZ:
+      std::cout << "  " << std::left << std::setw(22) << metric.name
+                << std::right << std::setw(16) << std::fixed << std::setprecision(4) << value << " GHz";
+      break;
+    default:
+      std::cout << "  " << std::left << std::setw(30) << metric.name
+                << std::right << std::setw(12) << std::fixed << std::setprecision(4) << value << "  ";
+      break;
+  }
 
-void Reporter::print_cycles_(uint64_t a, uint64_t b, std::string metric_name) {
-  double cyc = (b > 0) ? (double)a / b : 0.0;
-  std::cout << "  " << std::left << std::setw(23) << metric_name
-            << std::right << std::setw(12) << std::fixed << std::setprecision(4) << cyc << " cycles\n";
+  std::cout << "  +- ";
+  if (ci_half_width < 0.0) {
+    std::cout << "n/a\n";
+  } else {
+    std::cout << std::fixed << std::setprecision(metric.unit == MetricUnit::PERCENT ? 2 : 4) << ci_half_width * scale << '\n';
+  }
 }
-
-void Reporter::print_GHz_(uint64_t a, uint64_t b, std::string metric_name) {
-  double freq_in_GHz = (b > 0) ? (double)a / b : 0.0;
-  std::cout << "  " << std::left << std::setw(22) << metric_name
-            << std::right << std::setw(16) << std::fixed << std::setprecision(4) << freq_in_GHz << " GHz\n";
-}
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "hperf/sample_profile.h"
+
+#include <sys/types.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// The number of functions listed by print()
+#define MAX_PRINTED_HOT_SPOTS 20
+
+// The width of the symbol column, longer (e.g., demangled C++) names are cut
+#define SYMBOL_COLUMN_WIDTH 60
+
+namespace {
+
+/**
+ * @brief PERF_RECORD_SAMPLE with PERF_SAMPLE_IP | PERF_SAMPLE_TID, followed by the callchain with PERF_SAMPLE_CALLCHAIN
+ */
+struct SampleRecord {
+  struct perf_event_header header;
+  uint64_t ip;
+  uint32_t pid, tid;
+};
+
+/**
+ * @brief PERF_RECORD_MMAP, followed by the file name
+ */
+struct MmapRecord {
+  struct perf_event_header header;
+  uint32_t pid, tid;
+  uint64_t addr;
+  uint64_t len;
+  uint64_t pgoff;
+};
+
+/**
+ * @brief PERF_RECORD_LOST
+ */
+struct LostRecord {
+  struct perf_event_header header;
+  uint64_t id;
+  uint64_t lost;
+};
+
+bool is_kernel(uint16_t misc) {
+  return (misc & PERF_RECORD_MISC_CPUMODE_MASK) == PERF_RECORD_MISC_KERNEL;
+}
+
+}  // namespace
+
+SampleProfile::SampleProfile(const std::string &event_name, uint64_t period, bool callchain)
+    : event_name_(event_name), period_(period), callchain_(callchain), sample_num_(0), lost_sample_num_(0), throttle_num_(0) {}
+
+void SampleProfile::add_process(pid_t pid) {
+  resolver_.add_process(pid);
+}
+
+void SampleProfile::add_record(const struct perf_event_header *record) {
+  switch (record->type) {
+    case PERF_RECORD_SAMPLE:
+      add_sample(record);
+      break;
+    case PERF_RECORD_MMAP:
+      if (record->size > sizeof(MmapRecord)) {
+        const auto *mmap_record = reinterpret_cast<const MmapRecord *>(record);
+        const char *filename = reinterpret_cast<const char *>(mmap_record + 1);
+        const size_t max_len = record->size - sizeof(MmapRecord);
+        resolver_.add_mapping(static_cast<pid_t>(mmap_record->pid), mmap_record->addr, mmap_record->len, mmap_record->pgoff,
+                              std::string(filename, strnlen(filename, max_len)));
+      }
+      break;
+    case PERF_RECORD_LOST:
+      if (record->size >= sizeof(LostRecord)) {
+        lost_sample_num_ += reinterpret_cast<const LostRecord *>(record)->lost;
+      }
+      break;
+    case PERF_RECORD_THROTTLE:
+      ++throttle_num_;
+      break;
+    default:
+      break;
+  }
+}
+
+void SampleProfile::add_sample(const struct perf_event_header *record) {
+  if (record->size < sizeof(SampleRecord)) return;
+  const auto *sample = reinterpret_cast<const SampleRecord *>(record);
+  const pid_t pid = static_cast<pid_t>(sample->pid);
+  const bool kernel = is_kernel(record->misc);
+  ++sample_num_;
+
+  CodeLocation self = resolver_.resolve(pid, sample->ip, kernel);
+  Count &self_count = counts_[{self.binary, self.symbol}];
+  ++self_count.self;
+
+  std::vector<Key> callers{{self.binary, self.symbol}};
+  const auto *chain = reinterpret_cast<const uint64_t *>(sample + 1);
+  const size_t chain_capacity = (record->size - sizeof(SampleRecord)) / sizeof(uint64_t);
+  if (callchain_ && chain_capacity > 0) {
+    const uint64_t nr = std::min<uint64_t>(chain[0], chain_capacity - 1);
+    bool in_kernel = kernel;
+    bool first = true;
+    for (uint64_t i = 1; i <= nr; ++i) {
+      const uint64_t ip = chain[i];
+      if (ip >= PERF_CONTEXT_MAX) {  // A context marker, e.g., the user part follows the kernel part
+        in_kernel = (ip == PERF_CONTEXT_KERNEL);
+        continue;
+      }
+      if (first) {  // The sampled IP itself
+        first = false;
+        continue;
+      }
+      // A return address, the call is just before it
+      CodeLocation caller = resolver_.resolve(pid, ip - 1, in_kernel);
+      Key key{caller.binary, caller.symbol};
+      if (std::find(callers.begin(), callers.end(), key) == callers.end()) callers.push_back(key);  // Once for recursion
+    }
+  }
+  for (const auto &key : callers) ++counts_[key].total;
+}
+
+void SampleProfile::print() const {
+  std::cout << "=============== Hot Spots (" << event_name_ << ", every " << period_ << ") ===============\n";
+  std::cout << "Samples: " << sample_num_ << ", lost: " << lost_sample_num_ << ", throttled: " << throttle_num_ << "\n";
+  if (lost_sample_num_ > 0) {
+    std::cout << "Samples were lost in full ring buffers, use a longer period or a shorter interval (-i)\n";
+  }
+  if (sample_num_ == 0) {
+    std::cout << "============================================\n";
+    return;
+  }
+
+  // With callchains, the callers of the hot code (with no samples of their own) are listed as well
+  std::vector<std::pair<Key, Count>> hot_spots(counts_.begin(), counts_.end());
+  const bool by_total = callchain_;
+  std::stable_sort(hot_spots.begin(), hot_spots.end(), [by_total](const std::pair<Key, Count> &a, const std::pair<Key, Count> &b) {
+    const uint64_t a_first = by_total ? a.second.total : a.second.self, b_first = by_total ? b.second.total : b.second.self;
+    const uint64_t a_second = by_total ? a.second.self : a.second.total, b_second = by_total ? b.second.self : b.second.total;
+    return a_first != b_first ? a_first > b_first : a_second > b_second;
+  });
+
+  std::cout << std::right << std::setw(8) << "self%";
+  if (callchain_) std::cout << std::setw(8) << "total%";
+  std::cout << "  " << std::left << std::setw(SYMBOL_COLUMN_WIDTH) << "symbol"
+            << "  binary\n";
+  std::cout << std::fixed << std::setprecision(2);
+  for (size_t i = 0; i < hot_spots.size() && i < MAX_PRINTED_HOT_SPOTS; ++i) {
+    const Key &key = hot_spots[i].first;
+    const Count &count = hot_spots[i].second;
+    std::string symbol = key.second ? *key.second : "[unknown]";
+    if (symbol.size() > SYMBOL_COLUMN_WIDTH) symbol = symbol.substr(0, SYMBOL_COLUMN_WIDTH - 3) + "...";
+    std::cout << std::right << std::setw(7) << 100.0 * count.self / sample_num_ << "%";
+    if (callchain_) std::cout << std::setw(7) << 100.0 * count.total / sample_num_ << "%";
+    std::cout << "  " << std::left << std::setw(SYMBOL_COLUMN_WIDTH) << symbol << "  " << *key.first << "\n";
+  }
+  std::cout << std::right << std::defaultfloat;
+  std::cout << "============================================\n";
+}
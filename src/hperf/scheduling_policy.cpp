@@ -0,0 +1,135 @@
+#include "hperf/scheduling_policy.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+RoundRobinPolicy::RoundRobinPolicy(size_t group_num) : group_num_(group_num) {}
+
+size_t RoundRobinPolicy::next_group(size_t current_group) {
+  return (current_group + 1) % group_num_;
+}
+
+StaticWeightPolicy::StaticWeightPolicy(const std::vector<unsigned> &weights)
+    : weights_(weights), current_weights_(weights.size(), 0), total_weight_(0) {
+  for (const auto weight : weights_) {
+    total_weight_ += weight;
+  }
+}
+
+size_t StaticWeightPolicy::next_group(size_t current_group) {
+  // Smooth weighted round-robin: raise every group by its weight, select the highest and lower it by the total
+  size_t selected = 0;
+  for (size_t i = 0; i < weights_.size(); ++i) {
+    current_weights_[i] += weights_[i];
+    if (current_weights_[i] > current_weights_[selected]) selected = i;
+  }
+  current_weights_[selected] -= total_weight_;
+  return selected;
+}
+
+VarianceDrivenPolicy::VarianceDrivenPolicy(const PMUConfig &pmu_config, size_t warmup_rounds, size_t max_age)
+    : group_num_(pmu_config.get_event_group_num()),
+      fixed_event_num_(pmu_config.get_fixed_events().size()),
+      warmup_intervals_(warmup_rounds * pmu_config.get_event_group_num()),
+      max_age_(max_age > 0 ? max_age : pmu_config.get_event_group_num() * 4),
+      interval_count_(0),
+      last_counted_(pmu_config.get_event_group_num(), 0) {
+  stats_.resize(group_num_);
+  for (size_t i = 0; i < group_num_; ++i) {
+    stats_[i].assign(pmu_config.get_event_group_by_idx(i).size(), RateStats{0, 0.0, 0.0});
+  }
+}
+
+void VarianceDrivenPolicy::observe(size_t group_idx, const GroupReadBuffer &buffer) {
+  if (group_idx >= group_num_ || buffer.time_running() == 0) return;  // The group was not scheduled by the kernel
+
+  auto &group_stats = stats_[group_idx];
+  for (size_t j = 0; j < group_stats.size(); ++j) {
+    auto entry = buffer.entry(fixed_event_num_ + j);
+    if (!entry) break;
+    double rate = (double)entry->value / buffer.time_running();
+
+    RateStats &s = group_stats[j];
+    ++s.n;
+    double delta = rate - s.mean;
+    s.mean += delta / s.n;
+    s.m2 += delta * (rate - s.mean);
+  }
+}
+
+double VarianceDrivenPolicy::variance_reduction(size_t group_idx) const {
+  double max_reduction = 0.0;
+  for (const auto &s : stats_[group_idx]) {
+    if (s.n < 2) return std::numeric_limits<double>::infinity();  // The variance is unknown yet
+    if (s.mean <= 0.0) continue;                                   // An event that never counts has no relative error
+    double cv2 = s.m2 / (s.n - 1) / (s.mean * s.mean);
+    double reduction = cv2 / ((double)s.n * (s.n + 1));
+    if (reduction > max_reduction) max_reduction = reduction;
+  }
+  return max_reduction;
+}
+
+size_t VarianceDrivenPolicy::next_group(size_t current_group) {
+  ++interval_count_;
+  if (current_group < group_num_) last_counted_[current_group] = interval_count_;
+
+  if (interval_count_ < warmup_intervals_) {
+    return (current_group + 1) % group_num_;
+  }
+
+  // The group that has waited the longest, if it reaches the maximum age
+  size_t oldest = 0;
+  for (size_t i = 1; i < group_num_; ++i) {
+    if (last_counted_[i] < last_counted_[oldest]) oldest = i;
+  }
+  if (interval_count_ - last_counted_[oldest] >= max_age_) {
+    return oldest;
+  }
+
+  size_t selected = 0;
+  double max_reduction = -1.0;
+  for (size_t i = 0; i < group_num_; ++i) {
+    double reduction = variance_reduction(i);
+    if (reduction > max_reduction) {
+      max_reduction = reduction;
+      selected = i;
+    }
+  }
+  return selected;
+}
+
+std::unique_ptr<SchedulingPolicy> create_scheduling_policy(const std::string &spec, const PMUConfig &pmu_config) {
+  const size_t group_num = pmu_config.get_event_group_num();
+
+  if (spec == "rr") {
+    return std::make_unique<RoundRobinPolicy>(group_num);
+  }
+  if (spec == "variance") {
+    return std::make_unique<VarianceDrivenPolicy>(pmu_config);
+  }
+  if (spec.compare(0, 8, "weights:") == 0) {
+    std::vector<unsigned> weights;
+    std::stringstream ss(spec.substr(8));
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      char *end = nullptr;
+      long weight = std::strtol(item.c_str(), &end, 10);
+      if (item.empty() || *end != '\0' || weight <= 0) {
+        std::cerr << "Error: Invalid weight (" << item << ") in --schedule, it should be a positive integer.\n";
+        return nullptr;
+      }
+      weights.push_back(static_cast<unsigned>(weight));
+    }
+    if (weights.size() != group_num) {
+      std::cerr << "Error: --schedule has " << weights.size() << " weights, but there are "
+                << group_num << " event groups.\n";
+      return nullptr;
+    }
+    return std::make_unique<StaticWeightPolicy>(weights);
+  }
+
+  std::cerr << "Error: Unknown scheduling policy (" << spec << ").\n";
+  return nullptr;
+}
@@ -0,0 +1,309 @@
+#include "hperf/symbol_index.h"
+
+#include <cxxabi.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "hperf/cache_dir.h"
+#include "hperf/file_utils.h"
+
+// The symbol files in the cache directory (see get_cache_dir()), a file per binary (path, size and modification time)
+#define SYMBOL_CACHE_PREFIX "symbols-"
+
+namespace {
+
+std::string demangle(const char *name) {
+  int status = 0;
+  char *demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (status != 0 || demangled == nullptr) return name;
+  std::string result(demangled);
+  free(demangled);
+  return result;
+}
+
+/**
+ * @brief A read-only mapping of a whole file
+ */
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string &path) : base_(nullptr), size_(0) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      void *base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (base != MAP_FAILED) {
+        base_ = static_cast<const uint8_t *>(base);
+        size_ = st.st_size;
+      }
+    }
+    close(fd);
+  }
+
+  ~MappedFile() {
+    if (base_) munmap(const_cast<uint8_t *>(base_), size_);
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /**
+   * @brief The `count` objects at `offset`, or nullptr if they are not in the file
+   */
+  template <typename T>
+  const T *at(uint64_t offset, uint64_t count = 1) const {
+    if (base_ == nullptr || offset > size_ || count > (size_ - offset) / sizeof(T)) return nullptr;
+    return reinterpret_cast<const T *>(base_ + offset);
+  }
+
+ private:
+  const uint8_t *base_;
+  size_t size_;
+};
+
+}  // namespace
+
+bool SymbolTable::load_elf(const std::string &path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) return false;
+
+  std::ostringstream key;
+  key << path << ";size=" << st.st_size << ";mtime=" << st.st_mtim.tv_sec << "." << st.st_mtim.tv_nsec;
+  const std::string cache_dir = get_cache_dir();
+  std::ostringstream cache_path;
+  cache_path << cache_dir << "/" << SYMBOL_CACHE_PREFIX << std::hex << fnv1a(key.str());
+
+  if (!cache_dir.empty() && load_cache(cache_path.str(), key.str())) return true;
+  if (!parse_elf(path)) return false;
+  if (!cache_dir.empty()) save_cache(cache_path.str(), key.str());
+  return true;
+}
+
+bool SymbolTable::parse_elf(const std::string &path) {
+  MappedFile file(path);
+  const Elf64_Ehdr *ehdr = file.at<Elf64_Ehdr>(0);
+  if (ehdr == nullptr || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 || ehdr->e_ident[EI_CLASS] != ELFCLASS64) {
+    return false;
+  }
+
+  segments_.clear();
+  symbols_.clear();
+  if (const Elf64_Phdr *phdrs = file.at<Elf64_Phdr>(ehdr->e_phoff, ehdr->e_phnum)) {
+    for (int i = 0; i < ehdr->e_phnum; ++i) {
+      if (phdrs[i].p_type == PT_LOAD) segments_.push_back({phdrs[i].p_offset, phdrs[i].p_vaddr, phdrs[i].p_filesz});
+    }
+  }
+
+  const Elf64_Shdr *shdrs = file.at<Elf64_Shdr>(ehdr->e_shoff, ehdr->e_shnum);
+  if (shdrs == nullptr) return !segments_.empty();
+  // .symtab first, so that its entries are kept over the ones of .dynsym of the same address
+  for (uint32_t type : {SHT_SYMTAB, SHT_DYNSYM}) {
+    for (int i = 0; i < ehdr->e_shnum; ++i) {
+      const Elf64_Shdr &shdr = shdrs[i];
+      if (shdr.sh_type != type || shdr.sh_entsize != sizeof(Elf64_Sym) || shdr.sh_link >= ehdr->e_shnum) continue;
+      const Elf64_Sym *syms = file.at<Elf64_Sym>(shdr.sh_offset, shdr.sh_size / sizeof(Elf64_Sym));
+      const Elf64_Shdr &strtab = shdrs[shdr.sh_link];
+      const char *strings = file.at<char>(strtab.sh_offset, strtab.sh_size);
+      if (syms == nullptr || strings == nullptr || strtab.sh_size == 0) continue;
+
+      for (uint64_t j = 0; j < shdr.sh_size / sizeof(Elf64_Sym); ++j) {
+        const Elf64_Sym &sym = syms[j];
+        const int sym_type = ELF64_ST_TYPE(sym.st_info);
+        if ((sym_type != STT_FUNC && sym_type != STT_GNU_IFUNC) || sym.st_shndx == SHN_UNDEF || sym.st_value == 0 ||
+            sym.st_name >= strtab.sh_size) {
+          continue;
+        }
+        const char *name = strings + sym.st_name;
+        if (memchr(name, '\0', strtab.sh_size - sym.st_name) == nullptr || *name == '\0') continue;
+        symbols_.push_back({sym.st_value, sym.st_size, demangle(name)});
+      }
+    }
+  }
+  finalize();
+  return true;
+}
+
+bool SymbolTable::load_kallsyms(const std::string &path) {
+  std::ifstream infile(path);
+  if (!infile.is_open()) return false;
+
+  symbols_.clear();
+  segments_.clear();
+  bool has_address = false;
+  std::string line;
+  while (std::getline(infile, line)) {
+    std::istringstream fields(line);
+    std::string address, type, name;
+    if (!(fields >> address >> type >> name) || type.size() != 1) continue;
+    const char t = type[0];
+    if (t != 't' && t != 'T' && t != 'w' && t != 'W') continue;  // Text symbols only
+    uint64_t value = std::strtoull(address.c_str(), nullptr, 16);
+    has_address |= value != 0;
+    symbols_.push_back({value, 0, name});
+  }
+  if (!has_address) {  // All zeros without the privilege (kptr_restrict)
+    symbols_.clear();
+    return false;
+  }
+  finalize();
+  return true;
+}
+
+void SymbolTable::finalize() {
+  std::stable_sort(symbols_.begin(), symbols_.end(), [](const Symbol &a, const Symbol &b) { return a.address < b.address; });
+  symbols_.erase(std::unique(symbols_.begin(), symbols_.end(), [](const Symbol &a, const Symbol &b) { return a.address == b.address; }),
+                 symbols_.end());
+  for (size_t i = 0; i + 1 < symbols_.size(); ++i) {
+    if (symbols_[i].size == 0) symbols_[i].size = symbols_[i + 1].address - symbols_[i].address;
+  }
+}
+
+const Symbol *SymbolTable::find(uint64_t address) const {
+  auto it = std::upper_bound(symbols_.begin(), symbols_.end(), address,
+                             [](uint64_t value, const Symbol &symbol) { return value < symbol.address; });
+  if (it == symbols_.begin()) return nullptr;
+  --it;
+  // The last symbol without size takes the rest of the space
+  if (it->size != 0 && address - it->address >= it->size) return nullptr;
+  return &*it;
+}
+
+const Symbol *SymbolTable::find_by_file_offset(uint64_t offset) const {
+  for (const auto &segment : segments_) {
+    if (offset >= segment.offset && offset - segment.offset < segment.size) {
+      return find(offset - segment.offset + segment.address);
+    }
+  }
+  return nullptr;
+}
+
+bool SymbolTable::load_cache(const std::string &path, const std::string &key) {
+  std::ifstream infile(path);
+  std::string line;
+  if (!infile.is_open() || !std::getline(infile, line) || line != "key " + key) return false;
+
+  std::vector<Segment> segments;
+  std::vector<Symbol> symbols;
+  while (std::getline(infile, line)) {
+    std::istringstream fields(line);
+    std::string tag;
+    fields >> tag >> std::hex;
+    if (tag == "segment") {
+      Segment segment;
+      if (!(fields >> segment.offset >> segment.address >> segment.size)) return false;
+      segments.push_back(segment);
+    } else if (tag == "symbol") {
+      Symbol symbol;
+      if (!(fields >> symbol.address >> symbol.size)) return false;
+      std::getline(fields >> std::ws, symbol.name);  // A demangled name may have spaces
+      symbols.push_back(std::move(symbol));
+    } else {
+      return false;  // Not written by save_cache(), parse the file again
+    }
+  }
+  segments_ = std::move(segments);
+  symbols_ = std::move(symbols);
+  return true;
+}
+
+void SymbolTable::save_cache(const std::string &path, const std::string &key) const {
+  std::ofstream outfile(path);
+  if (!outfile.is_open()) return;  // Only the next run is slower
+
+  outfile << "key " << key << "\n" << std::hex;
+  for (const auto &segment : segments_) {
+    outfile << "segment " << segment.offset << " " << segment.address << " " << segment.size << "\n";
+  }
+  for (const auto &symbol : symbols_) {
+    outfile << "symbol " << symbol.address << " " << symbol.size << " " << symbol.name << "\n";
+  }
+}
+
+SymbolResolver::SymbolResolver() : kernel_symbols_loaded_(false) {
+  kernel_name_ = intern("[kernel]");
+  unknown_name_ = intern("[unknown]");
+}
+
+const std::string *SymbolResolver::intern(const std::string &name) {
+  return &*names_.insert(name).first;
+}
+
+const SymbolTable *SymbolResolver::get_symbols(const std::string &path) {
+  if (path.empty() || path[0] != '/') return nullptr;  // e.g., [vdso], [anon]
+  auto it = binaries_.find(path);
+  if (it == binaries_.end()) {
+    auto symbols = std::make_unique<SymbolTable>();
+    if (!symbols->load_elf(path)) symbols.reset();  // e.g., deleted, or not ELF
+    it = binaries_.emplace(path, std::move(symbols)).first;
+  }
+  return it->second.get();
+}
+
+void SymbolResolver::insert_mapping(std::map<uint64_t, Mapping> &mappings, uint64_t start, uint64_t end, uint64_t file_offset,
+                                    const std::string &path) {
+  // Remove the overlapped mappings
+  auto it = mappings.lower_bound(start);
+  if (it != mappings.begin() && std::prev(it)->second.end > start) --it;
+  while (it != mappings.end() && it->first < end) it = mappings.erase(it);
+
+  const std::string name = path.empty() ? "[anon]" : path;
+  mappings[start] = Mapping{end, file_offset, intern(name), get_symbols(name)};
+}
+
+std::map<uint64_t, SymbolResolver::Mapping> &SymbolResolver::get_mappings(pid_t pid) {
+  auto it = processes_.find(pid);
+  if (it != processes_.end()) return it->second;
+
+  std::map<uint64_t, Mapping> &mappings = processes_[pid];
+  // e.g., "55d0c1a00000-55d0c1a20000 r-xp 00002000 fd:01 1234 /usr/bin/cat"
+  std::ifstream infile("/proc/" + std::to_string(pid) + "/maps");
+  std::string line;
+  while (std::getline(infile, line)) {
+    std::istringstream fields(line);
+    std::string range, perms, offset, device, inode, path;
+    if (!(fields >> range >> perms >> offset >> device >> inode) || perms.size() < 3 || perms[2] != 'x') continue;
+    std::getline(fields >> std::ws, path);
+    const std::string deleted = " (deleted)";
+    if (path.size() > deleted.size() && path.compare(path.size() - deleted.size(), deleted.size(), deleted) == 0) {
+      path.erase(path.size() - deleted.size());
+    }
+    size_t dash = range.find('-');
+    if (dash == std::string::npos) continue;
+    insert_mapping(mappings, std::strtoull(range.c_str(), nullptr, 16), std::strtoull(range.c_str() + dash + 1, nullptr, 16),
+                   std::strtoull(offset.c_str(), nullptr, 16), path);
+  }
+  return mappings;
+}
+
+void SymbolResolver::add_mapping(pid_t pid, uint64_t start, uint64_t length, uint64_t file_offset, const std::string &path) {
+  insert_mapping(get_mappings(pid), start, start + length, file_offset, path);
+}
+
+CodeLocation SymbolResolver::resolve(pid_t pid, uint64_t ip, bool kernel) {
+  if (kernel) {
+    if (!kernel_symbols_loaded_) {
+      kernel_symbols_.load_kallsyms();
+      kernel_symbols_loaded_ = true;
+    }
+    const Symbol *symbol = kernel_symbols_.find(ip);
+    return {symbol ? &symbol->name : nullptr, kernel_name_};
+  }
+
+  const std::map<uint64_t, Mapping> &mappings = get_mappings(pid);
+  auto it = mappings.upper_bound(ip);
+  if (it == mappings.begin() || ip >= std::prev(it)->second.end) return {nullptr, unknown_name_};
+  --it;
+  const Mapping &mapping = it->second;
+  const Symbol *symbol = mapping.symbols ? mapping.symbols->find_by_file_offset(ip - it->first + mapping.file_offset) : nullptr;
+  return {symbol ? &symbol->name : nullptr, mapping.binary};
+}
@@ -0,0 +1,194 @@
+#include "hperf/task_follower.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <iterator>
+
+// The data pages of the ring buffer of each tracking event (a power of 2), FORK and EXIT records are 40 bytes each
+#define TRACKING_RING_PAGES 8
+
+// The CPU time the child of the inherit probe spends, which the group read of the parent must include
+#define INHERIT_PROBE_SPIN_NS 20000000ULL
+
+namespace {
+
+int perf_event_open(struct perf_event_attr *pe, pid_t pid, int cpu) {
+  return syscall(__NR_perf_event_open, pe, pid, cpu, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+uint64_t thread_cpu_time_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief PERF_RECORD_FORK and PERF_RECORD_EXIT
+ */
+struct TaskRecord {
+  struct perf_event_header header;
+  uint32_t pid, ppid;
+  uint32_t tid, ptid;
+  uint64_t time;
+};
+
+/**
+ * @brief PERF_RECORD_LOST
+ */
+struct LostRecord {
+  struct perf_event_header header;
+  uint64_t id;
+  uint64_t lost;
+};
+
+}  // namespace
+
+TaskFollower::TaskFollower(const PMUConfig &pmu_config, pid_t root_pid, bool delta_mode)
+    : pmu_config_(pmu_config),
+      root_pid_(root_pid),
+      delta_mode_(delta_mode),
+      followed_task_num_(0),
+      missed_task_num_(0),
+      lost_record_num_(0) {}
+
+TaskFollower::~TaskFollower() {
+  for (auto &ring : rings_) {
+    int fd = ring.get_fd();
+    ring.unmap();
+    close(fd);
+  }
+}
+
+bool TaskFollower::inherit_group_read_supported() {
+  struct perf_event_attr pe;
+  memset(&pe, 0, sizeof(struct perf_event_attr));
+  pe.type = PERF_TYPE_SOFTWARE;
+  pe.size = sizeof(struct perf_event_attr);
+  pe.config = PERF_COUNT_SW_TASK_CLOCK;
+  pe.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING | PERF_FORMAT_ID | PERF_FORMAT_GROUP;
+  pe.disabled = 1;
+  pe.inherit = 1;
+  int fd = perf_event_open(&pe, 0, -1);
+  if (fd == -1) return false;  // EINVAL: inherit is rejected with PERF_FORMAT_GROUP
+
+  ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  pid_t child_pid = fork();
+  if (child_pid == 0) {
+    uint64_t start = thread_cpu_time_ns();
+    while (thread_cpu_time_ns() - start < INHERIT_PROBE_SPIN_NS) {
+    }
+    _exit(0);
+  }
+  if (child_pid > 0) waitpid(child_pid, nullptr, 0);  // The child's counts are added to the parent's event when it exits
+  ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+  GroupReadBuffer buffer(1);
+  bool counted = child_pid > 0 && read(fd, buffer.data(), buffer.size()) == static_cast<ssize_t>(buffer.size()) &&
+                 buffer.entry(0) && buffer.entry(0)->value >= INHERIT_PROBE_SPIN_NS / 2;
+  close(fd);
+  return counted;
+}
+
+bool TaskFollower::start() {
+  const long cpu_num = sysconf(_SC_NPROCESSORS_CONF);
+  for (long cpu_id = 0; cpu_id < cpu_num; ++cpu_id) {
+    // An mmap'ed event with inherit must be bound to a CPU, so there is a tracking event per CPU
+    struct perf_event_attr pe;
+    memset(&pe, 0, sizeof(struct perf_event_attr));
+    pe.type = PERF_TYPE_SOFTWARE;
+    pe.size = sizeof(struct perf_event_attr);
+    pe.config = PERF_COUNT_SW_DUMMY;
+    pe.task = 1;  // PERF_RECORD_FORK and PERF_RECORD_EXIT
+    pe.inherit = 1;
+    pe.exclude_kernel = 1;
+    int fd = perf_event_open(&pe, root_pid_, cpu_id);
+    if (fd == -1) {
+      if (errno == ENODEV) continue;  // Offline CPU
+      std::cerr << "Failed to open the task tracking event on CPU " << cpu_id << ": " << strerror(errno) << std::endl;
+      return false;
+    }
+
+    PerfRingBuffer ring;
+    if (!ring.map(fd, TRACKING_RING_PAGES)) {
+      close(fd);
+      return false;
+    }
+    rings_.push_back(std::move(ring));
+  }
+  return true;
+}
+
+void TaskFollower::poll(int active_group_idx) {
+  std::vector<TaskRecord> fork_records, exit_records;
+  for (auto &ring : rings_) {
+    ring.drain([&](const struct perf_event_header *header) {
+      if (header->type == PERF_RECORD_LOST && header->size >= sizeof(LostRecord)) {
+        lost_record_num_ += reinterpret_cast<const LostRecord *>(header)->lost;
+      } else if (header->type == PERF_RECORD_FORK && header->size >= sizeof(TaskRecord)) {
+        fork_records.push_back(*reinterpret_cast<const TaskRecord *>(header));
+      } else if (header->type == PERF_RECORD_EXIT && header->size >= sizeof(TaskRecord)) {
+        exit_records.push_back(*reinterpret_cast<const TaskRecord *>(header));
+      }
+    });
+  }
+
+  auto has_exited = [&exit_records](pid_t tid) {
+    return std::any_of(exit_records.begin(), exit_records.end(),
+                       [tid](const TaskRecord &exit_record) { return static_cast<pid_t>(exit_record.tid) == tid; });
+  };
+  for (const auto &fork_record : fork_records) {
+    const pid_t tid = static_cast<pid_t>(fork_record.tid);
+    if (tid == root_pid_ || tasks_.count(tid)) continue;
+    // Forked and exited within an interval, it cannot be attached any more
+    if (has_exited(tid) || !attach(tid, active_group_idx)) {
+      ++missed_task_num_;
+    }
+  }
+  for (const auto &exit_record : exit_records) {
+    auto it = tasks_.find(static_cast<pid_t>(exit_record.tid));
+    if (it != tasks_.end()) it->second.exited = true;
+  }
+}
+
+bool TaskFollower::attach(pid_t tid, int active_group_idx) {
+  EventScheduler scheduler(pmu_config_, tid, -1);
+  scheduler.set_delta_mode(delta_mode_);
+  if (!scheduler.initialize() || !scheduler.reset_all_groups()) return false;
+  bool enabled = (active_group_idx == 0) ? scheduler.enable_active_group() : scheduler.switch_to_group(active_group_idx);
+  if (!enabled) return false;
+  tasks_.emplace(tid, Task{std::move(scheduler), false});
+  ++followed_task_num_;
+  return true;
+}
+
+void TaskFollower::fold_into(GroupReadBuffer &buffer) {
+  for (auto it = tasks_.begin(); it != tasks_.end();) {
+    EventScheduler &scheduler = it->second.scheduler;
+    if (scheduler.read_active_group_data() > 0) {
+      buffer.add(scheduler.get_active_group_read_buffer());
+    }
+    // The counts of an exited task are final after this read
+    it = it->second.exited ? tasks_.erase(it) : std::next(it);
+  }
+}
+
+void TaskFollower::switch_to_group(int group_idx) {
+  for (auto &task : tasks_) {
+    task.second.scheduler.switch_to_group(group_idx);
+  }
+}
+
+void TaskFollower::stop() {
+  for (auto &task : tasks_) {
+    task.second.scheduler.disable_active_group();
+  }
+}
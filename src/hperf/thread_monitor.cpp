@@ -0,0 +1,119 @@
+#include "hperf/thread_monitor.h"
+
+#include <dirent.h>
+#include <sys/resource.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "hperf/scheduling_policy.h"
+
+// The open files kept for everything else than the event groups (the output files, /proc, the standard streams)
+#define RESERVED_FD_NUM 64
+
+ThreadMonitor::ThreadMonitor(const PMUConfig &pmu_config, pid_t pid, bool delta_mode, const std::string &schedule)
+    : pmu_config_(pmu_config),
+      pid_(pid),
+      delta_mode_(delta_mode),
+      schedule_(schedule),
+      fd_num_per_thread_(0),
+      fd_limit_(0),
+      opened_fd_num_(0),
+      measured_thread_num_(0),
+      skipped_switch_num_(0) {
+  for (size_t i = 0; i < pmu_config_.get_event_group_num(); ++i) {
+    fd_num_per_thread_ += pmu_config_.get_fixed_events().size() + pmu_config_.get_event_group_by_idx(i).size();
+  }
+  size_t limit = raise_open_file_limit();
+  fd_limit_ = (limit > RESERVED_FD_NUM) ? limit - RESERVED_FD_NUM : 0;
+}
+
+size_t ThreadMonitor::raise_open_file_limit() {
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return 1024;
+  if (limit.rlim_cur < limit.rlim_max) {
+    rlim_t soft = limit.rlim_cur;
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) != 0) limit.rlim_cur = soft;
+  }
+  return limit.rlim_cur == RLIM_INFINITY ? SIZE_MAX : static_cast<size_t>(limit.rlim_cur);
+}
+
+std::vector<pid_t> ThreadMonitor::scan() {
+  std::vector<pid_t> attached;
+  const std::string task_dir = "/proc/" + std::to_string(pid_) + "/task";
+  DIR *dir = opendir(task_dir.c_str());
+  if (!dir) {  // The process has exited, all its threads are gone
+    for (auto &thread : threads_) thread.second.gone = true;
+    return attached;
+  }
+
+  std::set<pid_t> listed;
+  while (struct dirent *entry = readdir(dir)) {
+    char *end = nullptr;
+    long tid = std::strtol(entry->d_name, &end, 10);
+    if (end == entry->d_name || *end != '\0') continue;  // "." and ".."
+    listed.insert(static_cast<pid_t>(tid));
+  }
+  closedir(dir);
+
+  for (auto &thread : threads_) {
+    thread.second.gone = listed.count(thread.first) == 0;
+  }
+  for (const pid_t tid : listed) {
+    if (threads_.count(tid) || unmeasured_threads_.count(tid)) continue;
+    if (opened_fd_num_ + fd_num_per_thread_ > fd_limit_) {
+      if (unmeasured_threads_.empty()) {
+        std::cerr << "Warning: Not enough open files for " << fd_num_per_thread_ << " events of thread " << tid
+                  << " (" << opened_fd_num_ << " of " << fd_limit_ << " in use), the new threads are not measured" << std::endl;
+      }
+      unmeasured_threads_.insert(tid);
+      continue;
+    }
+    if (attach(tid)) attached.push_back(tid);
+  }
+  return attached;
+}
+
+bool ThreadMonitor::attach(pid_t tid) {
+  EventScheduler scheduler(pmu_config_, tid, -1);
+  scheduler.set_delta_mode(delta_mode_);
+  scheduler.set_scheduling_policy(create_scheduling_policy(schedule_, pmu_config_));
+  if (!scheduler.initialize() || !scheduler.reset_all_groups() || !scheduler.enable_active_group()) return false;
+
+  std::ifstream comm("/proc/" + std::to_string(pid_) + "/task/" + std::to_string(tid) + "/comm");
+  std::string name;
+  if (!std::getline(comm, name)) name = "?";
+
+  threads_.emplace(tid, Thread{std::move(scheduler), true, false});
+  names_[tid] = name;
+  opened_fd_num_ += fd_num_per_thread_;
+  ++measured_thread_num_;
+  return true;
+}
+
+void ThreadMonitor::switch_to_next_group() {
+  for (auto &thread : threads_) {
+    if (!thread.second.ran) {
+      ++skipped_switch_num_;  // Nothing was counted, the group is kept for the next interval
+      continue;
+    }
+    EventScheduler &scheduler = thread.second.scheduler;
+    if (!scheduler.switch_to_next_group() && scheduler.get_num_event_groups() > 1) {
+      std::cerr << "Warning: Failed to properly switch event group for TID " << thread.first << std::endl;
+    }
+  }
+}
+
+void ThreadMonitor::stop() {
+  for (auto &thread : threads_) {
+    thread.second.scheduler.disable_active_group();
+  }
+}
+
+const std::string &ThreadMonitor::get_thread_name(pid_t tid) const {
+  static const std::string unknown = "?";
+  auto it = names_.find(tid);
+  return it != names_.end() ? it->second : unknown;
+}
@@ -0,0 +1,82 @@
+#include "hperf/trace_codec.h"
+
+#include <utility>
+
+using namespace trace_codec;
+
+// The encoded group of a marker block (group -1), which has no values
+static constexpr uint64_t kMarkerGroupCode = 0xffffffff;
+
+void TraceEncoder::encode(const TraceBlock &block, std::vector<char> &out) {
+  StreamState &state = states_[{block.cpu_id, block.group_id}];
+  if (state.prev_values.size() != block.values.size()) {
+    state.prev_values.assign(block.values.size(), 0);
+  }
+
+  put_varint(out, static_cast<uint64_t>(block.cpu_id + 1));  // -1 for per-process mode
+  put_varint(out, static_cast<uint32_t>(block.group_id));  // -1 (a marker) is 0xffffffff
+
+  int64_t timestamp_delta = static_cast<int64_t>(block.timestamp - state.prev_timestamp);
+  put_varint(out, zigzag_encode(timestamp_delta - state.prev_timestamp_delta));
+  state.prev_timestamp = block.timestamp;
+  state.prev_timestamp_delta = timestamp_delta;
+
+  put_varint(out, zigzag_encode(static_cast<int64_t>(block.time_enabled - state.prev_time_enabled)));
+  put_varint(out, zigzag_encode(static_cast<int64_t>(block.time_running - state.prev_time_running)));
+  state.prev_time_enabled = block.time_enabled;
+  state.prev_time_running = block.time_running;
+
+  for (size_t i = 0; i < block.values.size(); ++i) {
+    put_varint(out, zigzag_encode(static_cast<int64_t>(block.values[i] - state.prev_values[i])));
+    state.prev_values[i] = block.values[i];
+  }
+}
+
+TraceDecoder::TraceDecoder(std::vector<size_t> group_sizes)
+    : group_sizes_(std::move(group_sizes)) {}
+
+bool TraceDecoder::decode(const char *&p, const char *end, TraceBlock &block) {
+  const char *cursor = p;
+  uint64_t cpu_plus_one, group_id, v;
+
+  if (!get_varint(cursor, end, cpu_plus_one) || !get_varint(cursor, end, group_id)) return false;
+  const bool is_marker = (group_id == kMarkerGroupCode);
+  if (!is_marker && group_id >= group_sizes_.size()) return false;
+
+  block.cpu_id = static_cast<int>(cpu_plus_one) - 1;
+  block.group_id = is_marker ? -1 : static_cast<int>(group_id);
+
+  StreamState &state = states_[{block.cpu_id, block.group_id}];
+  const size_t nr = is_marker ? 0 : group_sizes_[group_id];
+  if (state.prev_values.size() != nr) {
+    state.prev_values.assign(nr, 0);
+  }
+
+  // Decode into locals first, so that the state is untouched if the block is truncated
+  if (!get_varint(cursor, end, v)) return false;
+  int64_t timestamp_delta = state.prev_timestamp_delta + zigzag_decode(v);
+  uint64_t timestamp = state.prev_timestamp + static_cast<uint64_t>(timestamp_delta);
+
+  if (!get_varint(cursor, end, v)) return false;
+  uint64_t time_enabled = state.prev_time_enabled + static_cast<uint64_t>(zigzag_decode(v));
+  if (!get_varint(cursor, end, v)) return false;
+  uint64_t time_running = state.prev_time_running + static_cast<uint64_t>(zigzag_decode(v));
+
+  block.values.resize(nr);
+  for (size_t i = 0; i < nr; ++i) {
+    if (!get_varint(cursor, end, v)) return false;
+    block.values[i] = state.prev_values[i] + static_cast<uint64_t>(zigzag_decode(v));
+  }
+
+  block.timestamp = timestamp;
+  block.time_enabled = time_enabled;
+  block.time_running = time_running;
+  state.prev_timestamp = timestamp;
+  state.prev_timestamp_delta = timestamp_delta;
+  state.prev_time_enabled = time_enabled;
+  state.prev_time_running = time_running;
+  state.prev_values = block.values;
+
+  p = cursor;
+  return true;
+}
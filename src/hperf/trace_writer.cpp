@@ -0,0 +1,253 @@
+#include "hperf/trace_writer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+// A new index entry is started every INDEX_STRIDE_BLOCKS blocks
+#define INDEX_STRIDE_BLOCKS 256
+
+// The encoded bytes are written out in chunks of about this size
+#define COMPRESSED_FLUSH_THRESHOLD 65536
+
+using namespace trace_encoding;
+
+namespace trace_encoding {
+
+std::string read_cpu_model() {
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  if (!cpuinfo.is_open()) {
+    return "unknown";
+  }
+
+  std::string line;
+  std::string implementer;
+  std::string part;
+  while (std::getline(cpuinfo, line)) {
+    size_t colon_pos = line.find(':');
+    if (colon_pos == std::string::npos || colon_pos == 0) continue;
+    std::string key = line.substr(0, line.find_last_not_of(" \t", colon_pos - 1) + 1);
+    std::string value = colon_pos + 2 <= line.size() ? line.substr(colon_pos + 2) : "";
+
+    if (key == "model name") {
+      return value;
+    } else if (key == "CPU implementer" && implementer.empty()) {
+      implementer = value;
+    } else if (key == "CPU part" && part.empty()) {
+      part = value;
+    }
+  }
+
+  if (!implementer.empty() || !part.empty()) {
+    return "implementer " + implementer + ", part " + part;
+  }
+  return "unknown";
+}
+
+void put_file_header(std::vector<char> &buf, const std::string &magic, uint32_t version,
+                     uint64_t interval_in_ns, const PMUConfig &pmu_config) {
+  buf.insert(buf.end(), magic.begin(), magic.end());
+  put_u32(buf, version);
+  put_u64(buf, interval_in_ns);
+  put_str(buf, read_cpu_model());
+
+  const auto &fixed_events = pmu_config.get_fixed_events();
+  put_u32(buf, static_cast<uint32_t>(fixed_events.size()));
+  for (const auto &pmu_event : fixed_events) {
+    put_str(buf, pmu_event.name);
+    put_u64(buf, pmu_event.encoding);
+  }
+
+  put_u32(buf, static_cast<uint32_t>(pmu_config.get_event_group_num()));
+  for (size_t i = 0; i < pmu_config.get_event_group_num(); ++i) {
+    const auto &event_group = pmu_config.get_event_group_by_idx(i);
+    put_u32(buf, static_cast<uint32_t>(event_group.size()));
+    for (const auto &pmu_event : event_group) {
+      put_str(buf, pmu_event.name);
+      put_u64(buf, pmu_event.encoding);
+    }
+  }
+}
+
+}  // namespace trace_encoding
+
+CsvTraceWriter::CsvTraceWriter(const PMUConfig &pmu_config, std::ostream &out, bool with_header)
+    : pmu_config_(pmu_config), out_(out), with_header_(with_header) {}
+
+void CsvTraceWriter::write_header() {
+  if (with_header_) {
+    out_ << "timestamp,cpu,group,event,value\n";
+  }
+}
+
+void CsvTraceWriter::write_record(const Record &record) {
+  if (record.group_id == PHASE_BOUNDARY_GROUP_ID) {
+    out_ << record.timestamp << "," << record.cpu_id << ",0,phase_boundary," << record.value << "\n";
+    return;
+  }
+  out_ << record.timestamp << ","
+       << record.cpu_id << ","
+       << record.group_id + 1 << ","
+       << pmu_config_.get_pmu_event(record.group_id, record.event_id).name << ","
+       << record.value << "\n";
+}
+
+void CsvTraceWriter::finish() {
+  out_.flush();
+}
+
+BinaryTraceWriter::BinaryTraceWriter(const PMUConfig &pmu_config, std::ostream &out, uint64_t interval_in_ns)
+    : pmu_config_(pmu_config),
+      out_(out),
+      interval_in_ns_(interval_in_ns),
+      offset_(0) {}
+
+void BinaryTraceWriter::write_header() {
+  std::vector<char> header;
+  put_file_header(header, "HPERFBIN", kVersion, interval_in_ns_, pmu_config_);
+  write_bytes(header);
+}
+
+void BinaryTraceWriter::write_record(const Record &record) {
+  if (record.group_id == PHASE_BOUNDARY_GROUP_ID) {
+    std::vector<char> marker;
+    put_u64(marker, record.timestamp);
+    put_u32(marker, static_cast<uint32_t>(record.cpu_id));
+    put_u32(marker, static_cast<uint32_t>(PHASE_BOUNDARY_GROUP_ID));
+    put_u64(marker, 0);  // nr
+    put_u64(marker, record.value);
+    put_u64(marker, 0);
+    write_block(marker, record.timestamp);
+    return;
+  }
+
+  const uint64_t nr = pmu_config_.get_fixed_events().size() +
+                      pmu_config_.get_event_group_by_idx(record.group_id).size();
+
+  std::vector<char> &block = pending_blocks_[record.cpu_id];
+  if (record.event_id == 0) {
+    block.clear();
+    put_u64(block, record.timestamp);
+    put_u32(block, static_cast<uint32_t>(record.cpu_id));
+    put_u32(block, static_cast<uint32_t>(record.group_id));
+    put_u64(block, nr);
+    put_u64(block, record.time_enabled);
+    put_u64(block, record.time_running);
+  } else if (block.empty()) {
+    return;  // The beginning of this group read is missing, drop it
+  }
+
+  put_u64(block, record.value);
+
+  if (record.event_id + 1 == nr) {
+    write_block(block, record.timestamp);
+    block.clear();
+  }
+}
+
+void BinaryTraceWriter::write_block(const std::vector<char> &block, uint64_t timestamp) {
+  if (index_.empty() || index_.back().block_num >= INDEX_STRIDE_BLOCKS) {
+    index_.push_back({timestamp, timestamp, offset_, 0});
+  }
+  IndexEntry &entry = index_.back();
+  // Blocks of different CPUs may arrive slightly out of order, so keep the min/max
+  entry.first_timestamp = std::min(entry.first_timestamp, timestamp);
+  entry.last_timestamp = std::max(entry.last_timestamp, timestamp);
+  ++entry.block_num;
+
+  write_bytes(block);
+}
+
+void BinaryTraceWriter::finish() {
+  const uint64_t index_offset = offset_;
+
+  std::vector<char> footer;
+  const std::string index_magic = "HPERFIDX";
+  footer.insert(footer.end(), index_magic.begin(), index_magic.end());
+  put_u64(footer, index_.size());
+  for (const auto &entry : index_) {
+    put_u64(footer, entry.first_timestamp);
+    put_u64(footer, entry.last_timestamp);
+    put_u64(footer, entry.offset);
+    put_u64(footer, entry.block_num);
+  }
+  put_u64(footer, index_offset);
+  const std::string end_magic = "HPERFEND";
+  footer.insert(footer.end(), end_magic.begin(), end_magic.end());
+
+  write_bytes(footer);
+  out_.flush();
+}
+
+void BinaryTraceWriter::write_bytes(const std::vector<char> &bytes) {
+  out_.write(bytes.data(), bytes.size());
+  offset_ += bytes.size();
+}
+
+CompressedTraceWriter::CompressedTraceWriter(const PMUConfig &pmu_config, std::ostream &out, uint64_t interval_in_ns)
+    : pmu_config_(pmu_config),
+      out_(out),
+      interval_in_ns_(interval_in_ns),
+      raw_size_(0),
+      compressed_size_(0) {
+  buf_.reserve(COMPRESSED_FLUSH_THRESHOLD + 1024);
+}
+
+void CompressedTraceWriter::write_header() {
+  std::vector<char> header;
+  put_file_header(header, "HPERFCMP", kVersion, interval_in_ns_, pmu_config_);
+  out_.write(header.data(), header.size());
+}
+
+void CompressedTraceWriter::write_record(const Record &record) {
+  if (record.group_id == PHASE_BOUNDARY_GROUP_ID) {
+    TraceBlock marker = {record.timestamp, record.cpu_id, PHASE_BOUNDARY_GROUP_ID, record.value, 0, {}};
+    encoder_.encode(marker, buf_);
+    return;
+  }
+
+  const uint64_t nr = pmu_config_.get_fixed_events().size() +
+                      pmu_config_.get_event_group_by_idx(record.group_id).size();
+
+  auto &pending = pending_blocks_[record.cpu_id];
+  TraceBlock &block = pending.first;
+  bool &valid = pending.second;
+  if (record.event_id == 0) {
+    block.timestamp = record.timestamp;
+    block.cpu_id = record.cpu_id;
+    block.group_id = record.group_id;
+    block.time_enabled = record.time_enabled;
+    block.time_running = record.time_running;
+    block.values.clear();
+    valid = true;
+  } else if (!valid) {
+    return;  // The beginning of this group read is missing, drop it
+  }
+
+  block.values.push_back(record.value);
+
+  if (record.event_id + 1 == nr) {
+    size_t before = buf_.size();
+    encoder_.encode(block, buf_);
+    compressed_size_ += buf_.size() - before;
+    raw_size_ += 40 + 8 * nr;  // The size of the same block in the uncompressed binary trace
+    valid = false;
+    if (buf_.size() >= COMPRESSED_FLUSH_THRESHOLD) {
+      out_.write(buf_.data(), buf_.size());
+      buf_.clear();
+    }
+  }
+}
+
+void CompressedTraceWriter::finish() {
+  out_.write(buf_.data(), buf_.size());
+  buf_.clear();
+  out_.flush();
+
+  if (raw_size_ > 0) {
+    std::cout << "Compressed trace: " << compressed_size_ << " bytes of blocks ("
+              << std::fixed << std::setprecision(2) << (double)compressed_size_ * 100.0 / raw_size_
+              << " % of the uncompressed binary trace)\n";
+  }
+}
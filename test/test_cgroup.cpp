@@ -0,0 +1,59 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "hperf/cgroup.h"
+
+static std::string find_mount(const std::string& mounts_file, const std::string& content) {
+  std::ofstream(mounts_file) << content;
+  return find_perf_cgroup_mount(mounts_file);
+}
+
+int main() {
+  std::cout << "Test the perf_event cgroup mount lookup" << std::endl;
+
+  char mounts_template[] = "/tmp/hperf_mounts_XXXXXX";
+  const int fd = mkstemp(mounts_template);
+  if (fd == -1) {
+    std::cout << "FAIL: cannot create the mounts file" << std::endl;
+    return 1;
+  }
+  close(fd);
+  const std::string mounts_file = mounts_template;
+
+  // Hybrid: the cgroup v1 perf_event hierarchy is preferred over the unified one listed before it
+  std::string mount = find_mount(mounts_file,
+                                 "sysfs /sys sysfs rw,nosuid,nodev,noexec,relatime 0 0\n"
+                                 "cgroup2 /sys/fs/cgroup/unified cgroup2 rw,nosuid,nodev,noexec,relatime 0 0\n"
+                                 "cgroup /sys/fs/cgroup/cpu,cpuacct cgroup rw,nosuid,nodev,noexec,relatime,cpu,cpuacct 0 0\n"
+                                 "cgroup /sys/fs/cgroup/perf_event cgroup rw,nosuid,nodev,noexec,relatime,perf_event 0 0\n");
+  if (mount != "/sys/fs/cgroup/perf_event") {
+    std::cout << "FAIL: expected the perf_event hierarchy, got \"" << mount << "\"" << std::endl;
+    return 1;
+  }
+
+  // Unified only: the first cgroup2 mount, a v1 hierarchy without perf_event and malformed lines are ignored
+  mount = find_mount(mounts_file,
+                     "malformed\n"
+                     "cgroup /sys/fs/cgroup/cpuset cgroup rw,cpuset,noperf_event 0 0\n"
+                     "cgroup2 /sys/fs/cgroup cgroup2 rw,nosuid,nodev,noexec,relatime,nsdelegate 0 0\n"
+                     "cgroup2 /mnt/cgroup2 cgroup2 rw 0 0\n");
+  if (mount != "/sys/fs/cgroup") {
+    std::cout << "FAIL: expected the unified hierarchy, got \"" << mount << "\"" << std::endl;
+    return 1;
+  }
+
+  // No cgroup mounted
+  mount = find_mount(mounts_file, "proc /proc proc rw,nosuid,nodev,noexec,relatime 0 0\n");
+  unlink(mounts_file.c_str());
+  if (!mount.empty() || !find_perf_cgroup_mount(mounts_file).empty()) {
+    std::cout << "FAIL: unexpected mount point \"" << mount << "\"" << std::endl;
+    return 1;
+  }
+
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "hperf/event_discovery.h"
+#include "hperf/json_parser.h"
+
+static void write_file(const std::string& path, const std::string& content) {
+  std::ofstream(path) << content << "\n";
+}
+
+// A fake sysfs: two Arm core PMUs (big.LITTLE), an x86-style "cpu" PMU and an uncore PMU
+static void make_pmu(const std::string& root, const std::string& pmu, int type, bool core) {
+  const std::string dir = root + "/" + pmu;
+  mkdir(dir.c_str(), 0755);
+  mkdir((dir + "/format").c_str(), 0755);
+  mkdir((dir + "/events").c_str(), 0755);
+  write_file(dir + "/type", std::to_string(type));
+  if (core && pmu != "cpu") write_file(dir + "/cpus", "0-3");
+  if (!core) write_file(dir + "/cpumask", "0");
+}
+
+int main() {
+  std::cout << "Test the JSON parser and the event discovery" << std::endl;
+
+  JsonValue json;
+  std::string error;
+  if (!parse_json(R"({"a": [1, -2.5e1, true, null], "b": {"c": "x\"é\n"}})", json, error) ||
+      json.find("a")->elements.size() != 4 || json.find("a")->elements[1].number != -25 ||
+      json.find("b")->find("c")->string != "x\"\xc3\xa9\n") {
+    std::cout << "FAIL: JSON parsing: " << error << std::endl;
+    return 1;
+  }
+  if (parse_json("{\"a\": 1,\n \"b\" 2}", json, error) || error.rfind("Line 2", 0) != 0) {
+    std::cout << "FAIL: JSON syntax error not reported: " << error << std::endl;
+    return 1;
+  }
+
+  char root_template[] = "/tmp/hperf_sysfs_XXXXXX";
+  const std::string root = mkdtemp(root_template);
+  setenv("XDG_CACHE_HOME", root.c_str(), 1);  // The cache of the test stays in the test directory
+  make_pmu(root, "armv8_big", 10, true);
+  make_pmu(root, "armv8_little", 11, true);
+  make_pmu(root, "cpu", 4, true);
+  make_pmu(root, "arm_cmn_0", 12, false);
+  for (const char* pmu : {"armv8_big", "armv8_little"}) {
+    write_file(root + "/" + pmu + "/format/event", "config:0-15");
+    write_file(root + "/" + pmu + "/events/cpu_cycles", "event=0x11");
+    write_file(root + "/" + pmu + "/events/cpu_cycles.scale", "1");
+  }
+  write_file(root + "/armv8_big/events/inst_retired", "event=0x08");
+  write_file(root + "/armv8_big/events/l2d_refill", "event=0x17");  // The same name with another encoding on each core type
+  write_file(root + "/armv8_little/events/l2d_refill", "event=0x18");
+  write_file(root + "/cpu/format/event", "config:0-7");
+  write_file(root + "/cpu/format/umask", "config:8-15");
+  write_file(root + "/cpu/events/mem_load", "event=0xd0,umask=0x81");
+  write_file(root + "/cpu/events/with_param", "event=0x01,umask=?");
+  write_file(root + "/arm_cmn_0/format/type", "config:0-15");
+  write_file(root + "/arm_cmn_0/events/hnf_cache_miss", "type=0x5");
+
+  std::set<std::string> ambiguous_events;
+  const auto events = read_sysfs_events(root, &ambiguous_events);
+  if (events.size() != 3 || ambiguous_events != std::set<std::string>{"l2d_refill"} || events.count("cpu_cycles") == 0 || events.at("cpu_cycles").type != PERF_TYPE_RAW ||
+      events.at("inst_retired").type != 10 || events.at("mem_load").encoding != 0x81d0 || events.at("mem_load").type != 4) {
+    std::cout << "FAIL: unexpected sysfs events (" << events.size() << ")" << std::endl;
+    return 1;
+  }
+
+  // Names resolved from the file first, then from sysfs, an event of a single core type by its PMU
+  const std::string filename = root + "/events.json";
+  write_file(filename, R"({
+    "events": [
+      {"EventName": "CNT_CYCLES", "EventCode": "0x4004", "BriefDescription": "Constant frequency cycles"},
+      {"EventName": "LD_RETIRED", "EventCode": 208, "UMask": "0x1", "Counter": "0,1"},
+      {"EventName": "LITTLE_L2D_CACHE", "EventCode": "0x16", "PMU": "armv8_little"},
+      {"EventName": "HNF_CACHE_MISS", "EventCode": "0x5", "PMU": "arm_cmn_0"},
+      {"EventName": "L2 REFILL", "EventCode": "0x17", "BriefDescription": "Level 2 refills"}
+    ],
+    "fixed_events": ["cpu_cycles", "cnt_cycles", "inst_retired"],
+    "event_groups": [["ld_retired", "MEM_LOAD"], ["little_l2d_cache", "L2 REFILL"]],
+    "metrics": ["CPI = cpu_cycles / inst_retired"]
+  })");
+  for (int run = 0; run < 2; ++run) {  // The second run reads the cache
+    EventFileConfig config;
+    if (!load_event_file(filename, config, root) || config.fixed_events.size() != 3 || config.event_groups.size() != 2 ||
+        config.fixed_events[1].encoding != 0x4004 || config.fixed_events[1].description != "Constant frequency cycles" ||
+        config.event_groups[0][0].encoding != 0x1d0 || config.event_groups[0][0].counter_mask != 0x3 ||
+        config.event_groups[0][1].name != "MEM_LOAD" || config.event_groups[0][1].encoding != 0x81d0 ||
+        config.event_groups[1][0].type != 11 || config.event_groups[1][1].name != "L2 REFILL" ||
+        config.event_groups[1][1].description != "Level 2 refills" || config.metric_definitions != "CPI = cpu_cycles / inst_retired\n") {
+      std::cout << "FAIL: unexpected event file config (run " << run << ")" << std::endl;
+      return 1;
+    }
+    unlink((root + "/armv8_little/type").c_str());  // The PMU of little_l2d_cache is only found through the cache from now on
+  }
+
+  write_file(filename, R"({"fixed_events": ["cpu_cycles"], "event_groups": [["no_such_event"]]})");
+  EventFileConfig config;
+  if (load_event_file(filename, config, root)) {
+    std::cout << "FAIL: unknown event accepted" << std::endl;
+    return 1;
+  }
+
+  write_file(root + "/armv8_little/type", "11");
+  write_file(filename, R"({"fixed_events": ["cpu_cycles"], "event_groups": [["l2d_refill"]]})");
+  if (load_event_file(filename, config, root)) {
+    std::cout << "FAIL: an event of different encodings on the core PMUs accepted" << std::endl;
+    return 1;
+  }
+
+  // An uncore event cannot join a group led by a core event
+  write_file(filename, R"({
+    "events": [{"EventName": "HNF_CACHE_MISS", "EventCode": "0x5", "PMU": "arm_cmn_0"}],
+    "fixed_events": ["cpu_cycles"],
+    "event_groups": [["hnf_cache_miss"]]
+  })");
+  if (load_event_file(filename, config, root)) {
+    std::cout << "FAIL: uncore event accepted in an event group" << std::endl;
+    return 1;
+  }
+  system(("rm -rf " + root).c_str());
+
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
@@ -0,0 +1,126 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "hperf/event_grouping.h"
+
+static PMUEvent make_event(const std::string& name, uint64_t encoding, uint64_t counter_mask = 0) {
+  PMUEvent event = {name, "", encoding};
+  event.counter_mask = counter_mask;
+  return event;
+}
+
+static std::string to_string(const std::vector<std::vector<PMUEvent>>& groups) {
+  std::string s;
+  for (const auto& group : groups) {
+    s += "{";
+    for (const auto& event : group) s += " " + event.name;
+    s += " }";
+  }
+  return s;
+}
+
+int main() {
+  std::cout << "Test the event grouping solver" << std::endl;
+
+  // 2 fixed events + 4 free counters
+  const std::vector<PMUEvent> fixed_events = {make_event("cycles", 0x11), make_event("inst", 0x08)};
+
+  // 11 distinct events (one is duplicated) on 4 free counters
+  std::vector<PMUEvent> events;
+  for (uint64_t i = 0; i < 11; ++i) events.push_back(make_event("e" + std::to_string(i), 0x100 + i));
+  events.push_back(make_event("e0_again", 0x100));
+
+  EventGroupingSolver solver(fixed_events, 6);
+  std::vector<std::vector<PMUEvent>> groups;
+  if (!solver.solve(events, groups) || groups.size() != 3 || !solver.is_optimal()) {
+    std::cout << "FAIL: expected 3 groups, got " << to_string(groups) << std::endl;
+    return 1;
+  }
+
+  // The same encoding on another PMU is another event
+  std::vector<PMUEvent> typed = {make_event("raw", 0x100), make_event("other_pmu", 0x100)};
+  typed[1].type = 10;
+  std::vector<std::vector<PMUEvent>> typed_groups;
+  if (!EventGroupingSolver(fixed_events, 6).solve(typed, typed_groups) || to_string(typed_groups) != "{ raw other_pmu }") {
+    std::cout << "FAIL: events of different PMUs merged, got " << to_string(typed_groups) << std::endl;
+    return 1;
+  }
+
+  // Counter constraints: e0..e2 only run on counter 2, so each of them needs its own group
+  std::vector<PMUEvent> constrained = events;
+  for (int i = 0; i < 3; ++i) constrained[i].counter_mask = 1ULL << 2;
+  // ... and a fixed event restricted to counter 0 leaves counters 1..5 to the others
+  std::vector<PMUEvent> constrained_fixed = fixed_events;
+  constrained_fixed[0].counter_mask = 1ULL << 0;
+
+  EventGroupingSolver constrained_solver(constrained_fixed, 6);
+  std::vector<std::vector<PMUEvent>> constrained_groups;
+  if (!constrained_solver.solve(constrained, constrained_groups) || constrained_groups.size() != 3) {
+    std::cout << "FAIL: expected 3 constrained groups, got " << to_string(constrained_groups) << std::endl;
+    return 1;
+  }
+  for (const auto& group : constrained_groups) {
+    int pinned = 0;
+    for (const auto& event : group) pinned += (event.counter_mask != 0);
+    if (pinned > 1 || group.size() > 4) {
+      std::cout << "FAIL: infeasible group " << to_string({group}) << std::endl;
+      return 1;
+    }
+  }
+
+  // Reproducible: the same input gives the same groups
+  std::vector<std::vector<PMUEvent>> again;
+  EventGroupingSolver(constrained_fixed, 6).solve(constrained, again);
+  if (to_string(again) != to_string(constrained_groups)) {
+    std::cout << "FAIL: different result on the same input" << std::endl;
+    return 1;
+  }
+
+  // An event that conflicts with a fixed event on its only counter cannot be grouped
+  std::vector<PMUEvent> conflicting = {make_event("bad", 0x200, 1ULL << 0)};
+  if (EventGroupingSolver(constrained_fixed, 6).solve(conflicting, again)) {
+    std::cout << "FAIL: infeasible event accepted" << std::endl;
+    return 1;
+  }
+
+  // Probed conflicts: 8 events fit in 2 groups, but e0 conflicts with e1..e5, which do not fit in a single group without it
+  std::vector<PMUEvent> eight(events.begin(), events.begin() + 8);
+  EventGroupingSolver conflict_solver(fixed_events, 6);
+  auto raw = [](uint64_t encoding) { return EventKey(PERF_TYPE_RAW, encoding); };
+  conflict_solver.set_conflicts({{raw(0x100), raw(0x101)}, {raw(0x102), raw(0x100)}, {raw(0x100), raw(0x103)},
+                                 {raw(0x100), raw(0x104)}, {raw(0x105), raw(0x100)}});
+  std::vector<std::vector<PMUEvent>> conflict_groups;
+  if (!conflict_solver.solve(eight, conflict_groups) || conflict_groups.size() != 3) {
+    std::cout << "FAIL: expected 3 groups with the conflicts, got " << to_string(conflict_groups) << std::endl;
+    return 1;
+  }
+  for (const auto& group : conflict_groups) {
+    bool has_e0 = false, has_conflicting = false;
+    for (const auto& event : group) {
+      has_e0 = has_e0 || event.encoding == 0x100;
+      has_conflicting = has_conflicting || (event.encoding >= 0x101 && event.encoding <= 0x105);
+    }
+    if (has_e0 && has_conflicting) {
+      std::cout << "FAIL: conflicting events in a group " << to_string({group}) << std::endl;
+      return 1;
+    }
+  }
+
+  // Affinity sets sharing a denominator (d / a, d / b, ...): the denominator is counted in every group that needs it
+  std::vector<PMUEvent> ratio_events = {make_event("d", 0x300), make_event("a", 0x301), make_event("b", 0x302),
+                                        make_event("c", 0x303), make_event("e", 0x304), make_event("f", 0x305),
+                                        make_event("unpaired", 0x306)};
+  std::vector<std::vector<size_t>> ratio_sets = {{1, 0}, {2, 0}, {3, 0}, {4, 0}, {5, 0}};
+  EventGroupingSolver ratio_solver(fixed_events, 6);
+  std::vector<std::vector<PMUEvent>> ratio_groups;
+  if (!ratio_solver.solve(ratio_events, ratio_sets, ratio_groups) || !ratio_solver.get_split_sets().empty() ||
+      ratio_groups.size() != 2) {
+    std::cout << "FAIL: expected 2 groups keeping every ratio whole, got " << to_string(ratio_groups) << std::endl;
+    return 1;
+  }
+
+  std::cout << to_string(constrained_groups) << to_string(ratio_groups) << std::endl;
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
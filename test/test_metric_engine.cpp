@@ -0,0 +1,76 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "hperf/metric_engine.h"
+
+static bool near(double a, double b) {
+  return std::fabs(a - b) <= 1e-9 * std::fmax(1.0, std::fabs(b));
+}
+
+int main() {
+  std::cout << "Test the compilation and evaluation of metric definitions" << std::endl;
+
+  const std::vector<std::string> event_names = {"cpu_cycles", "inst_retired", "ld_spec", "inst_spec"};
+  auto resolver = [&event_names](const std::string& name) {
+    for (size_t i = 0; i < event_names.size(); ++i) {
+      if (event_names[i] == name) return (int)i;
+    }
+    return -1;
+  };
+
+  const std::string text = R"(
+# comment
+section Basic
+CPI = cpu_cycles / inst_retired
+Load [%] = ld_spec / inst_spec   # trailing comment
+subsection Misc
+Expr = -(cpu_cycles - 2 * inst_retired) / 4 + 1e3
+Zero division = cpu_cycles / (inst_retired - inst_retired)
+Seconds = $duration_ns / 1e9
+Unknown = cpu_cycles / l9_cache_refill
+)";
+
+  MetricEngine engine;
+  std::string error;
+  if (!engine.compile(text, resolver, error)) {
+    std::cerr << "Compile error: " << error << std::endl;
+    return 1;
+  }
+
+  const auto& metrics = engine.get_metrics();
+  if (metrics.size() != 5) {  // "Unknown" is skipped
+    std::cerr << "Expected 5 metrics, got " << metrics.size() << std::endl;
+    return 1;
+  }
+
+  std::vector<double> event_values = {3000.0, 1000.0, 250.0, 1250.0};
+  double variables[MetricEngine::VARIABLE_NUM] = {0.0, 2e9};
+  const double expected[] = {3.0, 0.2, (-(3000.0 - 2000.0) / 4) + 1e3, 0.0, 2.0};
+
+  for (size_t i = 0; i < metrics.size(); ++i) {
+    double value = MetricEngine::evaluate(metrics[i], event_values, variables);
+    if (!near(value, expected[i])) {
+      std::cerr << metrics[i].name << ": expected " << expected[i] << ", got " << value << std::endl;
+      return 1;
+    }
+  }
+
+  if (metrics[0].section != "Basic" || !metrics[0].subsection.empty() || metrics[2].subsection != "Misc" ||
+      metrics[1].unit != MetricUnit::PERCENT || metrics[0].event_operands.size() != 2) {
+    std::cerr << "Unexpected metric attributes" << std::endl;
+    return 1;
+  }
+
+  // A syntax error fails the whole text and reports the line number
+  MetricEngine bad_engine;
+  if (bad_engine.compile("A = cpu_cycles /\nB = (inst_retired", resolver, error) || error.compare(0, 6, "line 1") != 0 ||
+      !bad_engine.get_metrics().empty()) {
+    std::cerr << "Syntax error is not reported" << std::endl;
+    return 1;
+  }
+
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
@@ -0,0 +1,129 @@
+#include <cstdint>
+#include <iostream>
+
+#include "hperf/interval_timer.h"
+#include "hperf/phase_detector.h"
+#include "hperf/read_buffer.h"
+
+/**
+ * @brief Fill a group read buffer with the two fixed events only: cpu_cycles and inst_retired = cycles * ipc
+ */
+static void fill_buffer(GroupReadBuffer &buffer, uint64_t cycles, double ipc) {
+  auto *header = static_cast<GroupReadBuffer::Header *>(buffer.data());
+  header->nr = 2;
+  header->time_enabled = 1000;
+  header->time_running = 1000;
+  auto *entries = reinterpret_cast<GroupReadBuffer::Entry *>(header + 1);
+  entries[0].value = cycles;
+  entries[0].id = 0;
+  entries[1].value = static_cast<uint64_t>(cycles * ipc);
+  entries[1].id = 1;
+}
+
+int main() {
+  std::cout << "Test the phase detector and the fast rotation window" << std::endl;
+
+  // EWMA trigger and hysteresis
+  {
+    PhaseDetector detector(2, 0.25);
+    GroupReadBuffer buffer(2);
+    const double steady[] = {1.00, 1.02, 0.98, 1.01, 0.99, 1.00, 1.10};  // The last one is within the threshold
+    for (double ipc : steady) {
+      fill_buffer(buffer, 1000000, ipc);
+      if (detector.observe(buffer)) {
+        std::cerr << "FAIL: a phase change is reported for IPC " << ipc << " in a steady phase" << std::endl;
+        return 1;
+      }
+    }
+
+    fill_buffer(buffer, 100, 2.0);  // Too few cycles (e.g., an idle CPU), ignored
+    if (detector.observe(buffer)) {
+      std::cerr << "FAIL: a phase change is reported for an idle interval" << std::endl;
+      return 1;
+    }
+
+    fill_buffer(buffer, 1000000, 2.0);
+    if (!detector.observe(buffer)) {
+      std::cerr << "FAIL: the IPC change from 1.0 to 2.0 is not detected" << std::endl;
+      return 1;
+    }
+
+    // The baseline restarts from the new phase: neither the same values nor a jump back during the warmup trigger again
+    const double after[] = {2.0, 1.0, 2.0};
+    for (double ipc : after) {
+      fill_buffer(buffer, 1000000, ipc);
+      if (detector.observe(buffer)) {
+        std::cerr << "FAIL: a phase change is reported for IPC " << ipc << " right after a change" << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  // The fast rotation lasts until every group has been read, in any order
+  {
+    const uint64_t period = 100000000;
+    IntervalTimer timer(period);
+    FastRotationWindow window(timer, 2);
+
+    window.mark_read(0, 0, 2);
+    window.update(false);
+    if (window.is_fast() || timer.get_period() != period) {
+      std::cerr << "FAIL: the interval is shortened without a phase change" << std::endl;
+      return 1;
+    }
+
+    window.mark_read(0, 1, 2);
+    window.update(true);
+    if (!window.is_fast() || timer.get_period() != period / 2) {
+      std::cerr << "FAIL: the interval is " << timer.get_period() << " ns after a phase change, expected " << period / 2 << std::endl;
+      return 1;
+    }
+
+    // e.g., weights 2,1: group 0 twice before group 1
+    const size_t order[] = {0, 0, 1};
+    for (size_t i = 0; i < 3; ++i) {
+      window.mark_read(0, order[i], 2);
+      window.update(false);
+      const bool expected_fast = (i < 2);
+      if (window.is_fast() != expected_fast) {
+        std::cerr << "FAIL: the fast rotation is " << (window.is_fast() ? "on" : "off") << " after " << i + 1 << " reads" << std::endl;
+        return 1;
+      }
+    }
+    if (timer.get_period() != period) {
+      std::cerr << "FAIL: the interval is not restored after the fast rotation" << std::endl;
+      return 1;
+    }
+  }
+
+  // Without any reader, one fast interval per group; with one reader (e.g., a per-CPU collector), until it has read every group
+  for (const bool has_reader : {false, true}) {
+    const uint64_t period = 90000000;
+    IntervalTimer timer(period);
+    FastRotationWindow window(timer, 3);
+    size_t active = 0;
+    auto read_interval = [&](bool phase_changed) {
+      if (has_reader) window.mark_read(0, active, 3);
+      window.update(phase_changed);
+      active = (active + 1) % 3;
+    };
+
+    read_interval(false);
+    read_interval(true);
+    for (size_t i = 0; i < 3; ++i) {
+      if (!window.is_fast() || timer.get_period() != period / 3) {
+        std::cerr << "FAIL: the fast rotation " << (has_reader ? "with" : "without") << " a reader ends after " << i
+                  << " intervals, expected 3" << std::endl;
+        return 1;
+      }
+      read_interval(false);
+    }
+    if (window.is_fast() || timer.get_period() != period) {
+      std::cerr << "FAIL: the fast rotation " << (has_reader ? "with" : "without") << " a reader does not end" << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
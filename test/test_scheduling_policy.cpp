@@ -0,0 +1,87 @@
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "hperf/pmu_config.h"
+#include "hperf/read_buffer.h"
+#include "hperf/scheduling_policy.h"
+
+/**
+ * @brief Fill a group read buffer: fixed events count 1000, each schedulable event counts `value`, time_running = 1000
+ */
+static void fill_buffer(GroupReadBuffer &buffer, size_t event_num, uint64_t value, size_t fixed_event_num) {
+  auto *header = static_cast<GroupReadBuffer::Header *>(buffer.data());
+  header->nr = event_num;
+  header->time_enabled = 1000;
+  header->time_running = 1000;
+  auto *entries = reinterpret_cast<GroupReadBuffer::Entry *>(header + 1);
+  for (size_t i = 0; i < event_num; ++i) {
+    entries[i].value = (i < fixed_event_num) ? 1000 : value;
+    entries[i].id = i;
+  }
+}
+
+int main() {
+  std::cout << "Test the event group scheduling policies" << std::endl;
+
+  // Smooth weighted round-robin
+  {
+    StaticWeightPolicy policy({2, 1, 1});
+    const std::vector<size_t> expected = {0, 1, 2, 0, 0, 1, 2, 0};
+    size_t group = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+      group = policy.next_group(group);
+      if (group != expected[i]) {
+        std::cerr << "FAIL: weighted selection " << i << " is group " << group << ", expected " << expected[i] << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  PMUConfig pmu_config;
+  const size_t group_num = pmu_config.get_event_group_num();
+  const size_t fixed_event_num = pmu_config.get_fixed_events().size();
+  if (group_num < 2) {
+    std::cout << "PASS (skip the variance-driven policy, less than 2 event groups)" << std::endl;
+    return 0;
+  }
+
+  if (create_scheduling_policy("weights:1,2", pmu_config) != nullptr && group_num != 2) {
+    std::cerr << "FAIL: weights that do not match the event groups are accepted" << std::endl;
+    return 1;
+  }
+
+  // Variance-driven: group 0 is noisy, the others are constant
+  {
+    VarianceDrivenPolicy policy(pmu_config);
+    std::vector<GroupReadBuffer> buffers;
+    for (size_t i = 0; i < group_num; ++i) {
+      buffers.emplace_back(fixed_event_num + pmu_config.get_event_group_by_idx(i).size());
+    }
+
+    std::vector<size_t> visits(group_num, 0);
+    size_t group = 0;
+    const size_t interval_num = group_num * 50;
+    for (size_t i = 0; i < interval_num; ++i) {
+      uint64_t value = (group == 0) ? ((visits[0] % 2) ? 100 : 900) : 500;
+      fill_buffer(buffers[group], fixed_event_num + pmu_config.get_event_group_by_idx(group).size(), value, fixed_event_num);
+      policy.observe(group, buffers[group]);
+      ++visits[group];
+      group = policy.next_group(group);
+    }
+
+    for (size_t i = 1; i < group_num; ++i) {
+      if (visits[0] <= visits[i]) {
+        std::cerr << "FAIL: the noisy group is counted " << visits[0] << " times, group " << i << " " << visits[i] << " times" << std::endl;
+        return 1;
+      }
+      if (visits[i] < interval_num / (group_num * 4)) {
+        std::cerr << "FAIL: group " << i << " is starved (" << visits[i] << " intervals)" << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include <dirent.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "hperf/symbol_index.h"
+
+__attribute__((noinline)) int symbol_index_marker(int n) {
+  volatile int sum = 0;
+  for (int i = 0; i < n; ++i) sum += i;
+  return sum;
+}
+
+int main() {
+  std::cout << "Test the symbolization of an IP of this process" << std::endl;
+
+  char root_template[] = "/tmp/hperf_symbols_XXXXXX";
+  const std::string root = mkdtemp(root_template);
+  setenv("XDG_CACHE_HOME", root.c_str(), 1);  // The cache of the test stays in the test directory
+
+  // The IP in the middle of a function of this binary, in a file-backed executable mapping
+  const uint64_t ip = reinterpret_cast<uint64_t>(&symbol_index_marker) + 1;
+  SymbolResolver resolver;
+  CodeLocation location = resolver.resolve(getpid(), ip, false);
+  if (location.symbol == nullptr || location.symbol->find("symbol_index_marker") == std::string::npos) {
+    std::cout << "FAIL: resolved to " << (location.symbol ? *location.symbol : "[unknown]") << " in " << *location.binary << std::endl;
+    return 1;
+  }
+  std::cout << "Resolved to " << *location.symbol << " in " << *location.binary << std::endl;
+
+  // With an empty cache the binary is parsed and cached, then the second load comes from the cache and must give the same symbols
+  const std::string cache_home = root + "/parsed";
+  setenv("XDG_CACHE_HOME", cache_home.c_str(), 1);
+  SymbolTable parsed, cached;
+  if (!parsed.load_elf(*location.binary)) {
+    std::cout << "FAIL: cannot parse " << *location.binary << std::endl;
+    return 1;
+  }
+  size_t cache_file_num = 0;
+  if (DIR *dir = opendir((cache_home + "/hperf").c_str())) {
+    while (const dirent *entry = readdir(dir)) cache_file_num += (entry->d_name[0] != '.');
+    closedir(dir);
+  }
+  if (cache_file_num != 1 || !cached.load_elf(*location.binary) || parsed.get_symbol_num() != cached.get_symbol_num()) {
+    std::cout << "FAIL: the symbols of " << *location.binary << " are not cached (" << cache_file_num << " files)" << std::endl;
+    return 1;
+  }
+  struct stat st;
+  stat(location.binary->c_str(), &st);
+  size_t found_num = 0;
+  for (uint64_t offset = 0; offset < static_cast<uint64_t>(st.st_size); offset += 16) {
+    const Symbol *a = parsed.find_by_file_offset(offset);
+    const Symbol *b = cached.find_by_file_offset(offset);
+    if ((a == nullptr) != (b == nullptr) || (a && (a->name != b->name || a->address != b->address))) {
+      std::cout << "FAIL: the cached symbols of " << *location.binary << " differ at offset 0x" << std::hex << offset << std::endl;
+      return 1;
+    }
+    found_num += (a != nullptr);
+  }
+  if (found_num == 0) {
+    std::cout << "FAIL: no symbol found by file offset in " << *location.binary << std::endl;
+    return 1;
+  }
+  system(("rm -rf " + root).c_str());
+
+  // An address outside any mapping is unknown
+  location = resolver.resolve(getpid(), 8, false);
+  if (location.symbol != nullptr || *location.binary != "[unknown]") {
+    std::cout << "FAIL: a NULL page IP resolved to " << *location.binary << std::endl;
+    return 1;
+  }
+
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "hperf/trace_codec.h"
+
+static bool same_block(const TraceBlock& a, const TraceBlock& b) {
+  return a.timestamp == b.timestamp && a.cpu_id == b.cpu_id && a.group_id == b.group_id &&
+         a.time_enabled == b.time_enabled && a.time_running == b.time_running && a.values == b.values;
+}
+
+int main() {
+  std::cout << "Test the round trip of the compressed trace codec" << std::endl;
+
+  // 2 groups: 3 fixed events + 2 / 3 schedulable events
+  std::vector<size_t> group_sizes = {5, 6};
+
+  // Generate blocks of 2 CPUs (and a per-process stream, CPU -1) rotating over the groups every 100 ms
+  std::vector<TraceBlock> blocks;
+  uint64_t seed = 42;
+  auto next_random = [&seed]() {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return seed >> 33;
+  };
+  for (int interval = 0; interval < 200; ++interval) {
+    for (int cpu = -1; cpu < 2; ++cpu) {
+      TraceBlock block;
+      block.timestamp = (interval + 1) * 100000000ULL + next_random() % 50000;  // jitter < 50 us
+      block.cpu_id = cpu;
+      block.group_id = interval % 2;
+      block.time_enabled = 100000000ULL + next_random() % 50000;
+      block.time_running = block.time_enabled - next_random() % 1000;
+      for (size_t i = 0; i < group_sizes[block.group_id]; ++i) {
+        block.values.push_back(1000000 * (i + 1) + next_random() % 10000);
+      }
+      blocks.push_back(block);
+    }
+  }
+  // A marker block (phase boundary) has no values
+  blocks.push_back({blocks.back().timestamp, 0, -1, 25000000ULL, 0, {}});
+  // Extreme values must survive the zig-zag deltas
+  blocks.push_back({blocks.back().timestamp + 1, 1, 0, UINT64_MAX, 0, {UINT64_MAX, 0, 1, UINT64_MAX - 1, 0}});
+
+  TraceEncoder encoder;
+  std::vector<char> bytes;
+  for (const auto& block : blocks) {
+    encoder.encode(block, bytes);
+  }
+
+  TraceDecoder decoder(group_sizes);
+  const char* p = bytes.data();
+  const char* end = bytes.data() + bytes.size();
+  size_t decoded_num = 0;
+  TraceBlock decoded;
+  while (decoder.decode(p, end, decoded)) {
+    if (decoded_num >= blocks.size() || !same_block(decoded, blocks[decoded_num])) {
+      std::cout << "FAIL: block " << decoded_num << " mismatch" << std::endl;
+      return 1;
+    }
+    ++decoded_num;
+  }
+  if (decoded_num != blocks.size() || p != end) {
+    std::cout << "FAIL: decoded " << decoded_num << " of " << blocks.size() << " blocks" << std::endl;
+    return 1;
+  }
+
+  // The uncompressed binary trace takes 40 bytes + 8 bytes per value for each block
+  size_t raw_size = 0;
+  for (const auto& block : blocks) raw_size += 40 + 8 * block.values.size();
+  std::cout << "Encoded " << blocks.size() << " blocks: " << bytes.size() << " bytes (uncompressed " << raw_size << " bytes)" << std::endl;
+
+  // A truncated stream must be rejected, not misread
+  TraceDecoder truncated_decoder(group_sizes);
+  const char* q = bytes.data();
+  const char* truncated_end = bytes.data() + bytes.size() - 1;
+  size_t truncated_num = 0;
+  while (truncated_decoder.decode(q, truncated_end, decoded)) ++truncated_num;
+  if (truncated_num != blocks.size() - 1) {
+    std::cout << "FAIL: truncated stream decoded " << truncated_num << " blocks" << std::endl;
+    return 1;
+  }
+
+  std::cout << "PASS" << std::endl;
+  return 0;
+}
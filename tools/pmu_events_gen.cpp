@@ -0,0 +1,334 @@
+// Generate the constexpr model traits of a core (see include/hperf/pmu_model.h) from the Linux pmu-events JSON files
+// (tools/perf/pmu-events/arch/<arch>/<vendor>/<core>/*.json), so a new core needs no hand-maintained PMU config header.
+//
+// Example (the events of the groups can also be given by --group, see model_cortex_x4.h for its command line):
+//   pmu_events_gen --name cortex_a720 --counters 7 --fixed cpu_cycles,cnt_cycles,inst_retired
+//                  --events inst_spec,ld_spec,st_spec,l1d_cache_refill,l2d_cache_refill --metrics a720.metrics
+//                  -o include/hperf/pmu_config/model_cortex_a720.h
+//                  arch/arm64/common-and-microarch.json arch/arm64/arm/cortex-a720/*.json
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "hperf/event_discovery.h"
+#include "hperf/event_grouping.h"
+#include "hperf/json_parser.h"
+
+namespace {
+
+struct Options {
+  std::string name;
+  size_t counter_num = 0;
+  std::vector<std::string> fixed_events;
+  std::vector<std::vector<std::string>> groups;  // --group, kept as given
+  std::vector<std::string> events;               // --events, packed by EventGroupingSolver
+  std::string metrics_filename;
+  std::string output_filename;
+  std::vector<std::string> inputs;
+  std::string command_line;
+};
+
+std::string to_lower(std::string text) {
+  std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+  return text;
+}
+
+std::vector<std::string> split_list(const std::string &text) {
+  std::vector<std::string> items;
+  std::stringstream stream(text);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) items.push_back(to_lower(item));
+  }
+  return items;
+}
+
+bool read_file(const std::string &filename, std::string &text) {
+  std::ifstream infile(filename);
+  if (!infile.is_open()) {
+    std::cerr << "Error: Failed to open " << filename << std::endl;
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << infile.rdbuf();
+  text = buffer.str();
+  return true;
+}
+
+void print_help(const char *program_name) {
+  std::cout << "Usage: " << program_name << " [options] <pmu-events JSON files>\n"
+            << "         Generate the constexpr PMU model traits of a core from the Linux pmu-events JSON files.\n"
+            << "Options:\n"
+            << "      --name <name>           Core name, e.g. cortex_x4 (struct PMUModelCortexX4).\n"
+            << "      --counters <num>        Number of programmable counters, including the ones taken by the fixed events.\n"
+            << "      --fixed <events>        Comma-separated fixed events, counted in every group.\n"
+            << "      --group <events>        Comma-separated events of an event group, can be repeated.\n"
+            << "      --events <events>       Comma-separated events packed into the fewest event groups.\n"
+            << "      --metrics <file>        Metric definitions to embed (see include/hperf/metric_engine.h).\n"
+            << "  -o, --output <file>         Output header (default: standard output).\n"
+            << "  -h, --help                  Show this help message and exit.\n";
+}
+
+bool parse_options(int argc, char **argv, Options &options) {
+  const option long_opts[] = {{"name", required_argument, nullptr, 1},
+                              {"counters", required_argument, nullptr, 2},
+                              {"fixed", required_argument, nullptr, 3},
+                              {"group", required_argument, nullptr, 4},
+                              {"events", required_argument, nullptr, 5},
+                              {"metrics", required_argument, nullptr, 6},
+                              {"output", required_argument, nullptr, 'o'},
+                              {"help", no_argument, nullptr, 'h'},
+                              {nullptr, 0, nullptr, 0}};
+  for (int i = 1; i < argc; ++i) options.command_line += std::string(" ") + argv[i];
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "o:h", long_opts, nullptr)) != -1) {
+    switch (opt) {
+      case 1:
+        options.name = to_lower(optarg);
+        break;
+      case 2:
+        options.counter_num = std::strtoul(optarg, nullptr, 0);
+        break;
+      case 3:
+        options.fixed_events = split_list(optarg);
+        break;
+      case 4:
+        options.groups.push_back(split_list(optarg));
+        break;
+      case 5:
+        options.events = split_list(optarg);
+        break;
+      case 6:
+        options.metrics_filename = optarg;
+        break;
+      case 'o':
+        options.output_filename = optarg;
+        break;
+      case 'h':
+        print_help(argv[0]);
+        exit(0);
+      default:
+        print_help(argv[0]);
+        return false;
+    }
+  }
+  for (int i = optind; i < argc; ++i) options.inputs.push_back(argv[i]);
+
+  if (options.name.empty() || options.counter_num == 0 || options.fixed_events.empty() || options.inputs.empty()) {
+    std::cerr << "Error: --name, --counters, --fixed and the JSON files are required." << std::endl;
+    return false;
+  }
+  if (options.groups.empty() == options.events.empty()) {
+    std::cerr << "Error: Either --group or --events is required." << std::endl;
+    return false;
+  }
+  for (char c : options.name) {
+    if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') {
+      std::cerr << "Error: The name must be an identifier." << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Read the events of all input files by lowercase name. An entry with "ArchStdEvent" (Arm) takes the code of the
+ * architecture standard event of that name in another input (e.g., common-and-microarch.json), and may override its description.
+ */
+bool read_events(const std::vector<std::string> &inputs, std::map<std::string, PMUEvent> &events) {
+  std::vector<std::pair<std::string, std::string>> arch_std_events;  // {name, description}
+  for (const auto &filename : inputs) {
+    std::string text, error;
+    JsonValue json;
+    if (!read_file(filename, text)) return false;
+    if (!parse_json(text, json, error) || json.type != JsonValue::Type::ARRAY) {
+      std::cerr << "Error: " << filename << " is not a JSON array of events. " << error << std::endl;
+      return false;
+    }
+    for (const auto &entry : json.elements) {
+      PMUEvent event;
+      if (parse_pmu_event(entry, event, error)) {
+        events[to_lower(event.name)] = event;
+      } else if (const JsonValue *arch_std_event = entry.find("ArchStdEvent")) {
+        const JsonValue *description = entry.find("BriefDescription");
+        if (description == nullptr) description = entry.find("PublicDescription");
+        arch_std_events.push_back({to_lower(arch_std_event->string), description ? description->string : ""});
+      }  // Otherwise not an event, e.g., a metric
+    }
+  }
+  for (const auto &arch_std_event : arch_std_events) {
+    auto it = events.find(arch_std_event.first);
+    if (it == events.end()) {
+      std::cerr << "Warning: Architecture standard event " << arch_std_event.first << " is not defined by the inputs." << std::endl;
+      continue;
+    }
+    if (!arch_std_event.second.empty()) it->second.description = arch_std_event.second;
+  }
+  return true;
+}
+
+bool lookup(const std::map<std::string, PMUEvent> &events, const std::vector<std::string> &names, std::vector<PMUEvent> &result) {
+  for (const auto &name : names) {
+    auto it = events.find(name);
+    if (it == events.end()) {
+      std::cerr << "Error: Event " << name << " is not defined by the inputs." << std::endl;
+      return false;
+    }
+    result.push_back(it->second);
+    result.back().name = name;  // The metrics use the lowercase names, as perf does
+  }
+  return true;
+}
+
+std::string cpp_string(const std::string &text) {
+  std::string quoted = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (c == '\n' || c == '\t') {
+      quoted += ' ';
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
+std::string struct_name(const std::string &name) {
+  std::string result = "PMUModel";
+  bool upper = true;
+  for (char c : name) {
+    if (c == '_') {
+      upper = true;
+    } else {
+      result += upper ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : c;
+      upper = false;
+    }
+  }
+  return result;
+}
+
+void write_header(std::ostream &out, const Options &options, const std::vector<PMUEvent> &fixed_events,
+                  const std::vector<std::vector<PMUEvent>> &groups, const std::string &metrics) {
+  // The distinct events: the fixed events first, then the events of the groups in order
+  std::vector<PMUEvent> events;
+  auto index_of = [&events](const PMUEvent &event) {
+    for (size_t i = 0; i < events.size(); ++i) {
+      if (events[i].name == event.name) return i;
+    }
+    events.push_back(event);
+    return events.size() - 1;
+  };
+  std::vector<size_t> fixed_idx, group_idx;
+  for (const auto &event : fixed_events) fixed_idx.push_back(index_of(event));
+  for (const auto &group : groups) {
+    for (const auto &event : group) group_idx.push_back(index_of(event));
+  }
+
+  const std::string name = struct_name(options.name);
+  std::string guard = "PMU_MODEL_" + options.name + "_H";
+  std::transform(guard.begin(), guard.end(), guard.begin(), [](unsigned char c) { return std::toupper(c); });
+
+  out << "// Generated by tools/pmu_events_gen.cpp, do not edit.\n"
+      << "//   pmu_events_gen" << options.command_line << "\n"
+      << "// " << options.counter_num << " programmable counters, " << fixed_events.size() << " fixed events, "
+      << groups.size() << " event groups\n\n"
+      << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+      << "#include \"hperf/pmu_model.h\"\n\n"
+      << "struct " << name << " {\n"
+      << "  static constexpr std::string_view name = " << cpp_string(options.name) << ";\n"
+      << "  static constexpr size_t counter_num = " << options.counter_num << ";\n\n"
+      << "  static constexpr std::array<ModelEvent, " << events.size() << "> events = {{\n";
+  for (const auto &event : events) {
+    out << "      {" << cpp_string(event.name) << ", " << cpp_string(event.description) << ", 0x" << std::hex << event.encoding
+        << ", 0x" << event.counter_mask << std::dec << "},\n";
+  }
+  out << "  }};\n\n";
+
+  auto write_indices = [&out](const char *member, const std::vector<size_t> &indices) {
+    out << "  static constexpr std::array<uint16_t, " << indices.size() << "> " << member << " = {";
+    for (size_t i = 0; i < indices.size(); ++i) out << (i ? ", " : "") << indices[i];
+    out << "};\n";
+  };
+  write_indices("fixed_events", fixed_idx);
+  write_indices("group_events", group_idx);
+
+  out << "\n  // {first, size}\n"
+      << "  static constexpr std::array<ModelGroup, " << groups.size() << "> groups = {{\n";
+  size_t first = 0;
+  for (const auto &group : groups) {
+    out << "      {" << first << ", " << group.size() << "},\n";
+    first += group.size();
+  }
+  out << "  }};\n\n";
+
+  out << "  static constexpr std::string_view metric_definitions = R\"(" << metrics << ")\";\n"
+      << "};\n\n"
+      << "static_assert(pmu_model_is_valid<" << name << ">(), \"Invalid PMU model layout\");\n\n"
+      << "#endif\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_options(argc, argv, options)) return 1;
+
+  std::map<std::string, PMUEvent> events;
+  if (!read_events(options.inputs, events)) return 1;
+
+  std::vector<PMUEvent> fixed_events;
+  if (!lookup(events, options.fixed_events, fixed_events)) return 1;
+  if (fixed_events.size() >= options.counter_num) {
+    std::cerr << "Error: No counter is left for the schedulable events." << std::endl;
+    return 1;
+  }
+
+  std::vector<std::vector<PMUEvent>> groups;
+  if (!options.groups.empty()) {
+    for (const auto &names : options.groups) {
+      groups.emplace_back();
+      if (!lookup(events, names, groups.back())) return 1;
+      if (fixed_events.size() + groups.back().size() > options.counter_num) {
+        std::cerr << "Error: Event group " << groups.size() << " does not fit in " << options.counter_num << " counters." << std::endl;
+        return 1;
+      }
+    }
+  } else {
+    std::vector<PMUEvent> schedulable_events;
+    if (!lookup(events, options.events, schedulable_events)) return 1;
+    EventGroupingSolver solver(fixed_events, options.counter_num);
+    if (!solver.solve(schedulable_events, groups)) return 1;
+  }
+
+  std::string metrics;
+  if (!options.metrics_filename.empty()) {
+    if (!read_file(options.metrics_filename, metrics)) return 1;
+    if (metrics.find(")\"") != std::string::npos) {
+      std::cerr << "Error: The metric definitions cannot contain )\" in a raw string literal." << std::endl;
+      return 1;
+    }
+  }
+
+  if (options.output_filename.empty()) {
+    write_header(std::cout, options, fixed_events, groups, metrics);
+  } else {
+    std::ofstream outfile(options.output_filename);
+    if (!outfile.is_open()) {
+      std::cerr << "Error: Failed to create " << options.output_filename << std::endl;
+      return 1;
+    }
+    write_header(outfile, options, fixed_events, groups, metrics);
+  }
+  return 0;
+}